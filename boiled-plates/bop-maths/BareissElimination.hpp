@@ -0,0 +1,171 @@
+#ifndef BOP_BAREISS_ELIMINATION_HPP
+#define BOP_BAREISS_ELIMINATION_HPP
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "../bop-defaults/types.hpp"
+#include "MatrixView.hpp"
+
+/*
+    bop::maths::BareissElimination class file
+
+    Fraction-free (Bareiss) Gaussian elimination for matrices of integers.
+    Each step cross-multiplies by the pivot and divides by the previous
+    pivot, a division that is always exact, so every intermediate value is
+    itself a minor of the matrix and no fractions or floating point are
+    ever formed. That gives the exact determinant, rank and reduced row
+    echelon form in O(n^3) operations. The intermediates are minors, so
+    they are bounded by the Hadamard bound of the matrix, and the products
+    formed in each step by its square: T must be wide enough for both.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        namespace kernel {
+
+            template<class T>
+            uint_type bareiss(uint_type m, uint_type n, T* a, uint_type ld, bool reduce, int& sign, uint_type* pivot_columns = nullptr) {
+                /*
+                    Fraction-free elimination of the m by n matrix at a, in
+                    place. Returns the rank, sets sign to -1 for an odd number
+                    of row swaps and writes the column of each pivot to
+                    pivot_columns if given. Without reduce, a is left in a row
+                    echelon form whose last pivot is the determinant of the
+                    permuted matrix when it is square and of full rank. With
+                    reduce, the rows above each pivot are eliminated too and
+                    every pivot ends up equal to the last one, d, with the
+                    reduced row echelon form being a / d.
+                */
+                T previous = T(1);
+                uint_type rank = 0;
+                sign = 1;
+                for (uint_type col = 0; col < n && rank < m; col++) {
+                    uint_type pivot_row = rank;
+                    while (pivot_row < m && a[(pivot_row * ld) + col] == T(0)) pivot_row++;
+                    if (pivot_row == m) continue;
+                    T* pivot_data = a + (rank * ld);
+                    if (pivot_row != rank) {
+                        std::swap_ranges(pivot_data, pivot_data + n, a + (pivot_row * ld));
+                        sign = -sign;
+                    }
+                    const T pivot = pivot_data[col];
+                    for (uint_type row = (reduce ? 0 : rank + 1); row < m; row++) {
+                        if (row == rank) continue;
+                        T* row_data = a + (row * ld);
+                        const T factor = row_data[col];
+                        /*
+                            Below the pivot everything left of col is already
+                            zero, above it every column has to be updated.
+                        */
+                        for (uint_type elem = (row > rank ? col + 1 : 0); elem < n; elem++) {
+                            if (elem == col) continue;
+                            row_data[elem] = ((pivot * row_data[elem]) - (factor * pivot_data[elem])) / previous;
+                        }
+                        row_data[col] = T(0);
+                    }
+                    previous = pivot;
+                    if (pivot_columns != nullptr) pivot_columns[rank] = col;
+                    rank++;
+                }
+                return rank;
+            }
+
+            template<class T>
+            T bareissDet(uint_type n, T* a, uint_type ld) {
+                /*
+                    The exact determinant of the n by n matrix at a, which is
+                    overwritten.
+                */
+                if (n == 0) return T(1);
+                int sign = 1;
+                if (bareiss(n, n, a, ld, false, sign) < n) return T(0);
+                return (sign < 0) ? -a[((n - 1) * ld) + n - 1] : a[((n - 1) * ld) + n - 1];
+            }
+        }
+
+        template<class T>
+        class BareissElimination {
+            static_assert(std::is_integral<T>::value && std::is_signed<T>::value, "bop::maths::BareissElimination relies on exact division and is only for signed integral types.");
+            protected:
+                Matrix<T> reduced;
+                std::vector<uint_type> pivots;
+                uint_type matrix_rank;
+                int pivot_sign;
+
+                void eliminate() {
+                    this->pivots.resize(std::min(this->reduced.width(), this->reduced.height()));
+                    this->matrix_rank = kernel::bareiss(this->reduced.height(), this->reduced.width(),
+                                                        this->reduced.rowData(0), this->reduced.stride(),
+                                                        true, this->pivot_sign, this->pivots.data());
+                    this->pivots.resize(this->matrix_rank);
+                }
+
+            public:
+                BareissElimination(const Matrix<T>& mat) : reduced(mat), matrix_rank(0), pivot_sign(1) {
+                    this->eliminate();
+                }
+
+                BareissElimination(const MatrixView<T>& view) : reduced(view), matrix_rank(0), pivot_sign(1) {
+                    this->eliminate();
+                }
+
+                //Information functions
+
+                inline uint_type rank() const {
+                    return this->matrix_rank;
+                }
+
+                inline bool fullRank() const {
+                    return this->matrix_rank == std::min(this->reduced.width(), this->reduced.height());
+                }
+
+                inline const std::vector<uint_type>& pivotColumns() const {
+                    /*
+                        The column of the leading entry of each nonzero row of
+                        the echelon form.
+                    */
+                    return this->pivots;
+                }
+
+                inline T denominator() const {
+                    /*
+                        The value every pivot of reducedEchelon() shares, the
+                        determinant of the minor made of the pivot rows and
+                        columns up to sign.
+                    */
+                    if (this->matrix_rank == 0) return T(1);
+                    return this->reduced.element(this->matrix_rank - 1, this->pivots[this->matrix_rank - 1]);
+                }
+
+                inline const Matrix<T>& reducedEchelon() const {
+                    /*
+                        The reduced row echelon form scaled by denominator(),
+                        so that it stays integral: dividing it by
+                        denominator() gives the usual form with unit pivots.
+                    */
+                    return this->reduced;
+                }
+
+                T det() const {
+                    /*
+                        Exact determinant, zero for a singular or non-square
+                        matrix.
+                    */
+                    if (!this->reduced.square()) return T(0);
+                    if (this->reduced.width() == 0) return T(1);
+                    if (this->matrix_rank < this->reduced.width()) return T(0);
+                    return (this->pivot_sign < 0) ? -this->denominator() : this->denominator();
+                }
+        };
+    }
+}
+
+#endif
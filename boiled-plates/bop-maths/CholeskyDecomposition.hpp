@@ -0,0 +1,243 @@
+#ifndef BOP_CHOLESKY_DECOMPOSITION_HPP
+#define BOP_CHOLESKY_DECOMPOSITION_HPP
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "MatrixView.hpp"
+#include "TriangularSolve.hpp"
+
+/*
+    bop::maths::CholeskyDecomposition class file
+
+    Cholesky factorization A = LL^T of a symmetric positive definite
+    matrix, done in place in the storage of a Matrix<T>. Only the lower
+    triangle of A is read, and the factor is left in it with zeros above
+    the diagonal. It takes about half the work of LU and needs no
+    pivoting.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        template<class T>
+        class CholeskyDecomposition {
+            protected:
+                Matrix<T> factor;
+                bool is_positive_definite;
+
+                inline T& at(uint_type row, uint_type col) const {
+                    return this->factor.rowData(row)[col];
+                }
+
+                bool factorizePanel(uint_type start, uint_type panel_width) {
+                    /*
+                        Unblocked factorization of the columns [start, start +
+                        panel_width) from the diagonal down, row by row so
+                        every dot product runs along contiguous rows. Earlier
+                        panels have already been subtracted by the trailing
+                        updates. Returns false on a non-positive pivot.
+                    */
+                    const uint_type n = this->size();
+                    const uint_type end = start + panel_width;
+                    for (uint_type row = start; row < n; row++) {
+                        const T* row_data = &this->at(row,0);
+                        for (uint_type col = start; col < std::min(row, end); col++) {
+                            const T* col_data = &this->at(col,0);
+                            T sum = row_data[col];
+                            for (uint_type iter = start; iter < col; iter++) sum -= row_data[iter] * col_data[iter];
+                            this->at(row,col) = sum / col_data[col];
+                        }
+                        if (row < end) {
+                            T pivot = row_data[row];
+                            for (uint_type iter = start; iter < row; iter++) pivot -= row_data[iter] * row_data[iter];
+                            if (!(pivot > T(0))) return false;
+                            this->at(row,row) = std::sqrt(pivot);
+                        }
+                    }
+                    return true;
+                }
+
+                void factorize() {
+                    /*
+                        Blocked right-looking factorization: each panel of
+                        block_size columns is factored, then the lower triangle
+                        of the trailing matrix is updated by GEMMs on block
+                        columns, A22 -= L21 * L21^T, so only about half of the
+                        trailing update is computed. A non-square matrix is
+                        reported as not positive definite.
+                    */
+                    if (!this->factor.square()) {
+                        this->is_positive_definite = false;
+                        return;
+                    }
+                    const uint_type n = this->size();
+                    const uint_type nb = block_size;
+                    const uint_type ld = this->factor.stride();
+                    this->is_positive_definite = true;
+                    for (uint_type start = 0; start < n; start += nb) {
+                        const uint_type panel_width = std::min(nb, n - start);
+                        if (!this->factorizePanel(start, panel_width)) {
+                            this->is_positive_definite = false;
+                            return;
+                        }
+                        const uint_type right = start + panel_width;
+                        for (uint_type col = right; col < n; col += nb) {
+                            const uint_type col_width = std::min(nb, n - col);
+                            kernel::gemm<T>(n - col, col_width, panel_width, T(-1),
+                                            &this->at(col,start), ld, 1,
+                                            &this->at(col,start), 1, ld,
+                                            T(1), &this->at(col,col), ld);
+                        }
+                    }
+                    for (uint_type row = 0; row + 1 < n; row++) {
+                        std::fill(&this->at(row,row + 1), &this->at(row,0) + n, T(0));
+                    }
+                }
+
+            public:
+                /*
+                    Width of the column panels factored between trailing GEMM
+                    updates.
+                */
+                static const uint_type block_size = 64;
+
+                CholeskyDecomposition() : is_positive_definite(false) {
+                }
+
+                CholeskyDecomposition(const Matrix<T>& mat) : factor(mat), is_positive_definite(false) {
+                    this->factorize();
+                }
+
+                CholeskyDecomposition(Matrix<T>&& mat) : factor(std::move(mat)), is_positive_definite(false) {
+                    /*
+                        Factors an expiring matrix in its own storage.
+                    */
+                    this->factorize();
+                }
+
+                CholeskyDecomposition(const MatrixView<T>& view) : factor(view), is_positive_definite(false) {
+                    this->factorize();
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->factor.height();
+                }
+
+                inline bool positiveDefinite() const {
+                    /*
+                        False if a pivot was not positive, in which case the
+                        factor is incomplete and must not be used.
+                    */
+                    return this->is_positive_definite;
+                }
+
+                inline const Matrix<T>& lower() const {
+                    return this->factor;
+                }
+
+                Matrix<T> upper() const {
+                    return this->factor.transposed();
+                }
+
+                T det() const {
+                    /*
+                        The square of the product of the diagonal of L, or 0
+                        if the matrix was not positive definite.
+                    */
+                    if (!this->is_positive_definite) return T(0);
+                    T deter = T(1);
+                    for (uint_type elem = 0; elem < this->size(); elem++) deter *= this->at(elem,elem);
+                    return deter * deter;
+                }
+
+                //Solving
+
+                void solveInPlace(T* b, uint_type columns, uint_type ldb) const {
+                    /*
+                        Overwrites the size by columns right hand side at b with
+                        the solution X of AX = B, by solving with L and then
+                        with L^T, read as an upper triangle by swapping its
+                        strides.
+                    */
+                    const uint_type n = this->size();
+                    const uint_type ld = this->factor.stride();
+                    if (columns == 1) {
+                        for (uint_type row = 0; row < n; row++) {
+                            T sum = b[row * ldb];
+                            for (uint_type iter = 0; iter < row; iter++) sum -= this->at(row,iter) * b[iter * ldb];
+                            b[row * ldb] = sum / this->at(row,row);
+                        }
+                        for (uint_type row = n; row-- > 0;) {
+                            b[row * ldb] /= this->at(row,row);
+                            for (uint_type iter = 0; iter < row; iter++) b[iter * ldb] -= this->at(row,iter) * b[row * ldb];
+                        }
+                        return;
+                    }
+                    kernel::trsmLower<T>(n, columns, this->factor.rowData(0), ld, 1, false, b, ldb);
+                    kernel::trsmUpper<T>(n, columns, this->factor.rowData(0), 1, ld, false, b, ldb);
+                }
+
+                void solveInPlace(const MatrixView<T>& b) const {
+                    /*
+                        b is left unchanged if it does not have size() rows or
+                        the matrix was not positive definite.
+                    */
+                    if (b.height() != this->size() || !this->is_positive_definite) return;
+                    this->solveInPlace(b.data(), b.width(), b.stride());
+                }
+
+                Matrix<T> solve(const Matrix<T>& b) const {
+                    /*
+                        b is returned unchanged if it does not have size() rows
+                        or the matrix was not positive definite.
+                    */
+                    if (b.height() != this->size() || !this->is_positive_definite) return b;
+                    Matrix<T> x(b);
+                    this->solveInPlace(x.rowData(0), x.width(), x.stride());
+                    return x;
+                }
+
+                Matrix<T> solve(const MatrixView<T>& b) const {
+                    Matrix<T> x(b);
+                    if (b.height() != this->size() || !this->is_positive_definite) return x;
+                    this->solveInPlace(x.rowData(0), x.width(), x.stride());
+                    return x;
+                }
+
+                Matrix<T> inverse() const {
+                    /*
+                        The identity is returned if the matrix was not positive
+                        definite, as solve() would return it unchanged.
+                    */
+                    Matrix<T> inv(this->size(), this->size(), 0);
+                    for (uint_type elem = 0; elem < this->size(); elem++) inv.element(elem,elem) = 1;
+                    if (!this->is_positive_definite) return inv;
+                    this->solveInPlace(inv.rowData(0), this->size(), inv.stride());
+                    return inv;
+                }
+        };
+
+        template<class T>
+        Matrix<T> solve(const CholeskyDecomposition<T>& cholesky, const Matrix<T>& b) {
+            return cholesky.solve(b);
+        }
+
+        template<class T>
+        Matrix<T> solve(const CholeskyDecomposition<T>& cholesky, const MatrixView<T>& b) {
+            return cholesky.solve(b);
+        }
+    }
+}
+
+#endif
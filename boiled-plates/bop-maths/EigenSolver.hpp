@@ -0,0 +1,762 @@
+#ifndef BOP_EIGEN_SOLVER_HPP
+#define BOP_EIGEN_SOLVER_HPP
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <algorithm>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "SIMD.hpp"
+#include "Matrix.hpp"
+#include "SparseMatrix.hpp"
+
+/*
+    bop::maths eigen solver file
+
+    Matrix-free Krylov solvers for a few eigenpairs of a large operator,
+    Lanczos for symmetric operators and Arnoldi for general ones. The
+    operator is only ever applied to vectors, so anything that can compute
+    y = Ax will do: a dense Matrix, a SparseMatrix, or any callable taking
+    (const T* x, T* y) over vectors of the operator's size.
+
+    Both solvers keep a Krylov decomposition AV = VH + fe^T with an
+    orthonormal basis V of at most basis_size vectors. When the basis is
+    full, the wanted Ritz vectors are kept and the rest discarded (a thick,
+    or Krylov-Schur style, restart), so memory stays at about
+    (basis_size + 1) * n elements, 2k*n by default.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        enum class EigenTarget {
+            largest_magnitude,
+            largest_real,
+            smallest_real
+        };
+
+        template<class T>
+        struct SymmetricEigenPairs {
+            /*
+                Eigenvalues in the order asked for, with eigenvector i in
+                column i of vectors.
+            */
+            std::vector<T> values;
+            Matrix<T> vectors;
+            bool converged;
+            uint_type restarts;
+        };
+
+        template<class T>
+        struct EigenPairs {
+            /*
+                As SymmetricEigenPairs, with the eigenvectors of complex
+                eigenvalues split into their real and imaginary parts.
+            */
+            std::vector<std::complex<T> > values;
+            Matrix<T> vectors;
+            Matrix<T> imaginary_vectors;
+            bool converged;
+            uint_type restarts;
+        };
+
+        namespace kernel {
+
+            template<class T>
+            void symmetricEigen(uint_type n, T* a, uint_type lda, T* values, T* vectors, uint_type ldv) {
+                /*
+                    Eigenvalues and orthonormal eigenvectors (as columns) of the
+                    small symmetric matrix at a, by cyclic Jacobi rotations.
+                    The matrix is destroyed.
+                */
+                for (uint_type row = 0; row < n; row++) {
+                    for (uint_type col = 0; col < n; col++) vectors[(row * ldv) + col] = (row == col) ? T(1) : T(0);
+                }
+                const T eps = std::numeric_limits<T>::epsilon();
+                for (uint_type sweep = 0; sweep < 64; sweep++) {
+                    T off = T(0), total = T(0);
+                    for (uint_type row = 0; row < n; row++) {
+                        for (uint_type col = 0; col < n; col++) {
+                            const T elem = a[(row * lda) + col];
+                            total += elem * elem;
+                            if (row != col) off += elem * elem;
+                        }
+                    }
+                    if (off <= eps * eps * total) break;
+                    for (uint_type p = 0; p + 1 < n; p++) {
+                        for (uint_type q = p + 1; q < n; q++) {
+                            const T apq = a[(p * lda) + q];
+                            if (apq == T(0)) continue;
+                            const T theta = (a[(q * lda) + q] - a[(p * lda) + p]) / (2 * apq);
+                            const T t = ((theta >= T(0)) ? T(1) : T(-1)) / (std::abs(theta) + std::sqrt((theta * theta) + 1));
+                            const T c = T(1) / std::sqrt((t * t) + 1);
+                            const T s = t * c;
+                            for (uint_type iter = 0; iter < n; iter++) {
+                                T& akp = a[(iter * lda) + p];
+                                T& akq = a[(iter * lda) + q];
+                                const T kp = akp, kq = akq;
+                                akp = (c * kp) - (s * kq);
+                                akq = (s * kp) + (c * kq);
+                            }
+                            for (uint_type iter = 0; iter < n; iter++) {
+                                T& apk = a[(p * lda) + iter];
+                                T& aqk = a[(q * lda) + iter];
+                                const T pk = apk, qk = aqk;
+                                apk = (c * pk) - (s * qk);
+                                aqk = (s * pk) + (c * qk);
+                            }
+                            for (uint_type iter = 0; iter < n; iter++) {
+                                T& vkp = vectors[(iter * ldv) + p];
+                                T& vkq = vectors[(iter * ldv) + q];
+                                const T kp = vkp, kq = vkq;
+                                vkp = (c * kp) - (s * kq);
+                                vkq = (s * kp) + (c * kq);
+                            }
+                        }
+                    }
+                }
+                for (uint_type elem = 0; elem < n; elem++) values[elem] = a[(elem * lda) + elem];
+            }
+
+            template<class T>
+            void hessenbergReduce(uint_type n, T* a, uint_type lda) {
+                /*
+                    Reduces the small matrix at a to upper Hessenberg form by
+                    Householder similarity transforms, keeping its eigenvalues.
+                */
+                std::vector<T> v(n);
+                for (uint_type col = 0; col + 2 < n; col++) {
+                    const T alpha = a[((col + 1) * lda) + col];
+                    T sigma = T(0);
+                    for (uint_type row = col + 2; row < n; row++) sigma += a[(row * lda) + col] * a[(row * lda) + col];
+                    if (sigma == T(0)) continue;
+                    const T norm = std::sqrt((alpha * alpha) + sigma);
+                    const T beta = (alpha >= T(0)) ? -norm : norm;
+                    v[col + 1] = alpha - beta;
+                    for (uint_type row = col + 2; row < n; row++) v[row] = a[(row * lda) + col];
+                    const T vtv = (v[col + 1] * v[col + 1]) + sigma;
+                    for (uint_type iter = col; iter < n; iter++) {
+                        T sum = T(0);
+                        for (uint_type row = col + 1; row < n; row++) sum += v[row] * a[(row * lda) + iter];
+                        const T factor = 2 * sum / vtv;
+                        for (uint_type row = col + 1; row < n; row++) a[(row * lda) + iter] -= factor * v[row];
+                    }
+                    for (uint_type row = 0; row < n; row++) {
+                        T* a_row = a + (row * lda);
+                        T sum = T(0);
+                        for (uint_type iter = col + 1; iter < n; iter++) sum += a_row[iter] * v[iter];
+                        const T factor = 2 * sum / vtv;
+                        for (uint_type iter = col + 1; iter < n; iter++) a_row[iter] -= factor * v[iter];
+                    }
+                }
+            }
+
+            template<class T>
+            bool hessenbergEigenvalues(uint_type n, T* a, uint_type lda, std::complex<T>* values) {
+                /*
+                    Eigenvalues of the upper Hessenberg matrix at a by the
+                    Francis double shift QR algorithm, as EISPACK's hqr.
+                    Complex eigenvalues come out in conjugate pairs. The
+                    matrix is destroyed, and false is returned if an
+                    eigenvalue fails to converge.
+                */
+                auto at = [&](int_type row, int_type col) -> T& {return a[(row * lda) + col];};
+                auto sign = [](T mag, T of) -> T {return (of >= T(0)) ? std::abs(mag) : -std::abs(mag);};
+                T norm = T(0);
+                for (int_type row = 0; row < int_type(n); row++) {
+                    for (int_type col = std::max(row - 1, int_type(0)); col < int_type(n); col++) norm += std::abs(at(row,col));
+                }
+                int_type nn = int_type(n) - 1;
+                int_type its = 0;
+                T shift = T(0);
+                while (nn >= 0) {
+                    int_type l = nn;
+                    for (; l >= 1; l--) {
+                        T s = std::abs(at(l - 1,l - 1)) + std::abs(at(l,l));
+                        if (s == T(0)) s = norm;
+                        if (std::abs(at(l,l - 1)) + s == s) {
+                            at(l,l - 1) = T(0);
+                            break;
+                        }
+                    }
+                    T x = at(nn,nn);
+                    if (l == nn) {
+                        values[nn] = std::complex<T>(x + shift, T(0));
+                        nn--;
+                        its = 0;
+                        continue;
+                    }
+                    T y = at(nn - 1,nn - 1);
+                    T w = at(nn,nn - 1) * at(nn - 1,nn);
+                    if (l == nn - 1) {
+                        /*
+                            A 2x2 block has split off.
+                        */
+                        const T p = T(0.5) * (y - x);
+                        const T q = (p * p) + w;
+                        T z = std::sqrt(std::abs(q));
+                        x += shift;
+                        if (q >= T(0)) {
+                            z = p + sign(z, p);
+                            values[nn - 1] = values[nn] = std::complex<T>(x + z, T(0));
+                            if (z != T(0)) values[nn] = std::complex<T>(x - (w / z), T(0));
+                        }
+                        else {
+                            values[nn - 1] = std::complex<T>(x + p, z);
+                            values[nn] = std::complex<T>(x + p, -z);
+                        }
+                        nn -= 2;
+                        its = 0;
+                        continue;
+                    }
+                    if (its == 60) return false;
+                    if (its % 10 == 9) {
+                        /*
+                            Exceptional shift, to break out of cycles.
+                        */
+                        shift += x;
+                        for (int_type iter = 0; iter <= nn; iter++) at(iter,iter) -= x;
+                        const T s = std::abs(at(nn,nn - 1)) + std::abs(at(nn - 1,nn - 2));
+                        y = x = T(0.75) * s;
+                        w = T(-0.4375) * s * s;
+                    }
+                    its++;
+                    int_type m = nn - 2;
+                    T p = T(0), q = T(0), r = T(0), z = T(0);
+                    for (; m >= l; m--) {
+                        z = at(m,m);
+                        r = x - z;
+                        T s = y - z;
+                        p = (((r * s) - w) / at(m + 1,m)) + at(m,m + 1);
+                        q = at(m + 1,m + 1) - z - r - s;
+                        r = at(m + 2,m + 1);
+                        s = std::abs(p) + std::abs(q) + std::abs(r);
+                        p /= s;
+                        q /= s;
+                        r /= s;
+                        if (m == l) break;
+                        const T u = std::abs(at(m,m - 1)) * (std::abs(q) + std::abs(r));
+                        const T v = std::abs(p) * (std::abs(at(m - 1,m - 1)) + std::abs(z) + std::abs(at(m + 1,m + 1)));
+                        if (u + v == v) break;
+                    }
+                    for (int_type iter = m + 2; iter <= nn; iter++) {
+                        at(iter,iter - 2) = T(0);
+                        if (iter != m + 2) at(iter,iter - 3) = T(0);
+                    }
+                    for (int_type k = m; k <= nn - 1; k++) {
+                        if (k != m) {
+                            p = at(k,k - 1);
+                            q = at(k + 1,k - 1);
+                            r = (k != nn - 1) ? at(k + 2,k - 1) : T(0);
+                            x = std::abs(p) + std::abs(q) + std::abs(r);
+                            if (x != T(0)) {
+                                p /= x;
+                                q /= x;
+                                r /= x;
+                            }
+                        }
+                        const T s = sign(std::sqrt((p * p) + (q * q) + (r * r)), p);
+                        if (s == T(0)) continue;
+                        if (k == m) {
+                            if (l != m) at(k,k - 1) = -at(k,k - 1);
+                        }
+                        else at(k,k - 1) = -s * x;
+                        p += s;
+                        x = p / s;
+                        y = q / s;
+                        z = r / s;
+                        q /= p;
+                        r /= p;
+                        for (int_type col = k; col <= nn; col++) {
+                            p = at(k,col) + (q * at(k + 1,col));
+                            if (k != nn - 1) {
+                                p += r * at(k + 2,col);
+                                at(k + 2,col) -= p * z;
+                            }
+                            at(k + 1,col) -= p * y;
+                            at(k,col) -= p * x;
+                        }
+                        const int_type last = std::min(nn, k + 3);
+                        for (int_type row = l; row <= last; row++) {
+                            p = (x * at(row,k)) + (y * at(row,k + 1));
+                            if (k != nn - 1) {
+                                p += z * at(row,k + 2);
+                                at(row,k + 2) -= p * r;
+                            }
+                            at(row,k + 1) -= p * q;
+                            at(row,k) -= p;
+                        }
+                    }
+                }
+                return true;
+            }
+
+            template<class T>
+            void inverseIteration(uint_type n, const T* a, uint_type lda, std::complex<T> value, std::complex<T>* vector) {
+                /*
+                    Unit eigenvector of the small real matrix at a for a known,
+                    possibly complex, eigenvalue: a few solves with the
+                    factored A - (value)I, nudged off exact singularity.
+                */
+                typedef std::complex<T> complex_type;
+                const T eps = std::numeric_limits<T>::epsilon();
+                T norm = T(0);
+                for (uint_type row = 0; row < n; row++) {
+                    T sum = T(0);
+                    for (uint_type col = 0; col < n; col++) sum += std::abs(a[(row * lda) + col]);
+                    norm = std::max(norm, sum);
+                }
+                if (norm == T(0)) norm = T(1);
+                const complex_type shifted = value + complex_type(norm * eps, T(0));
+                std::vector<complex_type> lu(n * n);
+                std::vector<uint_type> pivots(n);
+                for (uint_type row = 0; row < n; row++) {
+                    for (uint_type col = 0; col < n; col++) lu[(row * n) + col] = complex_type(a[(row * lda) + col], T(0));
+                    lu[(row * n) + row] -= shifted;
+                }
+                for (uint_type col = 0; col < n; col++) {
+                    uint_type pivot_row = col;
+                    for (uint_type row = col + 1; row < n; row++) {
+                        if (std::abs(lu[(row * n) + col]) > std::abs(lu[(pivot_row * n) + col])) pivot_row = row;
+                    }
+                    pivots[col] = pivot_row;
+                    if (pivot_row != col) std::swap_ranges(lu.begin() + (col * n), lu.begin() + ((col + 1) * n), lu.begin() + (pivot_row * n));
+                    if (lu[(col * n) + col] == complex_type(T(0))) lu[(col * n) + col] = complex_type(norm * eps, T(0));
+                    for (uint_type row = col + 1; row < n; row++) {
+                        const complex_type multiplier = lu[(row * n) + col] / lu[(col * n) + col];
+                        lu[(row * n) + col] = multiplier;
+                        for (uint_type iter = col + 1; iter < n; iter++) lu[(row * n) + iter] -= multiplier * lu[(col * n) + iter];
+                    }
+                }
+                std::fill(vector, vector + n, complex_type(T(1)));
+                for (uint_type pass = 0; pass < 3; pass++) {
+                    for (uint_type row = 0; row < n; row++) {
+                        if (pivots[row] != row) std::swap(vector[row], vector[pivots[row]]);
+                    }
+                    for (uint_type row = 1; row < n; row++) {
+                        for (uint_type iter = 0; iter < row; iter++) vector[row] -= lu[(row * n) + iter] * vector[iter];
+                    }
+                    for (uint_type row = n; row-- > 0;) {
+                        for (uint_type iter = row + 1; iter < n; iter++) vector[row] -= lu[(row * n) + iter] * vector[iter];
+                        vector[row] /= lu[(row * n) + row];
+                    }
+                    T length = T(0);
+                    for (uint_type row = 0; row < n; row++) length += std::norm(vector[row]);
+                    length = std::sqrt(length);
+                    for (uint_type row = 0; row < n; row++) vector[row] /= length;
+                }
+            }
+        }
+
+        template<class T>
+        class KrylovDecomposition {
+            /*
+                AV = VH + fe^T, the state shared by the Lanczos and Arnoldi
+                solvers. Basis vector i is row i of basis, the extra row
+                holding the next vector, f normalised. projection is H with
+                the row of f's coefficients below it.
+            */
+            public:
+                uint_type size;
+                uint_type capacity;
+                uint_type kept;
+                Matrix<T> basis;
+                std::vector<T> projection;
+                std::minstd_rand generator;
+
+                KrylovDecomposition(uint_type size, uint_type capacity) :
+                    size(size), capacity(capacity), kept(0), basis(size, capacity + 1, 0),
+                    projection((capacity + 1) * capacity, T(0)), generator(1) {
+                    this->randomVector(0);
+                }
+
+                inline T& h(uint_type row, uint_type col) {
+                    return this->projection[(row * this->capacity) + col];
+                }
+
+                inline T* vector(uint_type index) const {
+                    return this->basis.rowData(index);
+                }
+
+                T dot(const T* x, const T* y) const {
+                    T sum = T(0);
+                    for (uint_type elem = 0; elem < this->size; elem++) sum += x[elem] * y[elem];
+                    return sum;
+                }
+
+                T orthogonalize(T* w, uint_type count, T* coefficients) const {
+                    /*
+                        Classical Gram-Schmidt against the first count basis
+                        vectors, done twice so w stays orthogonal to working
+                        precision. Adds the coefficients removed to those given
+                        and returns the norm left.
+                    */
+                    for (uint_type pass = 0; pass < 2; pass++) {
+                        for (uint_type index = 0; index < count; index++) {
+                            const T coefficient = this->dot(this->vector(index), w);
+                            kernel::axpy<T>(this->size, -coefficient, this->vector(index), w);
+                            coefficients[index] += coefficient;
+                        }
+                    }
+                    return std::sqrt(this->dot(w, w));
+                }
+
+                void randomVector(uint_type index) {
+                    /*
+                        A random unit vector orthogonal to the first index
+                        basis vectors, or zero if they already span the space.
+                    */
+                    std::uniform_real_distribution<T> distribution(T(-1), T(1));
+                    std::vector<T> ignored(index + 1);
+                    T* w = this->vector(index);
+                    for (uint_type attempt = 0; attempt < 3; attempt++) {
+                        for (uint_type elem = 0; elem < this->size; elem++) w[elem] = distribution(this->generator);
+                        const T length = this->orthogonalize(w, index, ignored.data());
+                        if (length > std::sqrt(std::numeric_limits<T>::epsilon())) {
+                            kernel::scal<T>(this->size, T(1) / length, w);
+                            return;
+                        }
+                    }
+                    std::fill(w, w + this->size, T(0));
+                }
+
+                template<class Operator>
+                void expand(Operator& op, bool symmetric) {
+                    /*
+                        Extends the decomposition from the kept vectors to a full
+                        basis. For the symmetric (Lanczos) case only the
+                        tridiagonal part of the coefficients is kept, the rest
+                        being rounding error removed by the reorthogonalisation.
+                    */
+                    std::vector<T> coefficients(this->capacity);
+                    for (uint_type col = this->kept; col < this->capacity; col++) {
+                        T* w = this->vector(col + 1);
+                        op(static_cast<const T*>(this->vector(col)), w);
+                        std::fill(coefficients.begin(), coefficients.end(), T(0));
+                        const T length = this->orthogonalize(w, col + 1, coefficients.data());
+                        if (symmetric) {
+                            this->h(col,col) = coefficients[col];
+                            for (uint_type row = 0; row < col; row++) this->h(row,col) = this->h(col,row);
+                        }
+                        else {
+                            for (uint_type row = 0; row <= col; row++) this->h(row,col) = coefficients[row];
+                        }
+                        T scale = length;
+                        for (uint_type row = 0; row <= col; row++) scale = std::max(scale, std::abs(coefficients[row]));
+                        if (length <= scale * std::numeric_limits<T>::epsilon() * 16) {
+                            /*
+                                The basis spans an invariant subspace, carry on
+                                with a fresh direction.
+                            */
+                            this->h(col + 1,col) = T(0);
+                            this->randomVector(col + 1);
+                        }
+                        else {
+                            this->h(col + 1,col) = length;
+                            kernel::scal<T>(this->size, T(1) / length, w);
+                        }
+                        if (symmetric && col + 1 < this->capacity) this->h(col,col + 1) = this->h(col + 1,col);
+                    }
+                }
+
+                void restart(const std::vector<T>& q, uint_type count, const std::vector<T>& reduced) {
+                    /*
+                        Replaces the basis by V Q for the capacity by count
+                        matrix q with orthonormal columns spanning an invariant
+                        subspace of H, and H by the count by count Q^T H Q
+                        given as reduced. The residual vector follows them, its
+                        coefficients becoming the last row of H times Q.
+                    */
+                    const uint_type m = this->capacity;
+                    Matrix<T> compressed(this->size, count);
+                    kernel::gemm<T>(count, this->size, m, T(1),
+                                    q.data(), 1, count,
+                                    this->vector(0), this->basis.stride(), 1,
+                                    T(0), compressed.rowData(0), compressed.stride());
+                    for (uint_type row = 0; row < count; row++) std::copy(compressed.rowData(row), compressed.rowData(row) + this->size, this->vector(row));
+                    std::copy(this->vector(m), this->vector(m) + this->size, this->vector(count));
+                    std::vector<T> residual(count, T(0));
+                    for (uint_type col = 0; col < count; col++) {
+                        for (uint_type row = 0; row < m; row++) residual[col] += this->h(m,row) * q[(row * count) + col];
+                    }
+                    std::fill(this->projection.begin(), this->projection.end(), T(0));
+                    for (uint_type row = 0; row < count; row++) {
+                        for (uint_type col = 0; col < count; col++) this->h(row,col) = reduced[(row * count) + col];
+                        this->h(count,row) = residual[row];
+                    }
+                    this->kept = count;
+                }
+
+                void combine(const T* coefficients, uint_type columns, T* out, uint_type ldo) const {
+                    /*
+                        out = V^T C for the capacity by columns matrix C, the
+                        basis combinations as columns of a size by columns
+                        matrix.
+                    */
+                    kernel::gemm<T>(this->size, columns, this->capacity, T(1),
+                                    this->vector(0), 1, this->basis.stride(),
+                                    coefficients, columns, 1,
+                                    T(0), out, ldo);
+                }
+        };
+
+        namespace kernel {
+
+            template<class T>
+            inline bool eigenBefore(std::complex<T> left, std::complex<T> right, EigenTarget target) {
+                /*
+                    Ordering of eigenvalues by how wanted they are, conjugate
+                    pairs kept together with the positive imaginary part first.
+                */
+                T left_key = left.real(), right_key = right.real();
+                if (target == EigenTarget::largest_magnitude) {
+                    left_key = std::abs(left);
+                    right_key = std::abs(right);
+                }
+                else if (target == EigenTarget::smallest_real) {
+                    left_key = -left_key;
+                    right_key = -right_key;
+                }
+                if (left_key != right_key) return left_key > right_key;
+                if (left.real() != right.real()) return left.real() > right.real();
+                return left.imag() > right.imag();
+            }
+
+            inline uint_type krylovBasisSize(uint_type size, uint_type count, uint_type basis_size) {
+                if (basis_size == 0) basis_size = std::max(2 * count + 1, count + 8);
+                return std::min(size, std::max(basis_size, count + 2));
+            }
+
+            template<class T>
+            inline T krylovTolerance(T tolerance) {
+                return (tolerance > T(0)) ? tolerance : std::pow(std::numeric_limits<T>::epsilon(), T(2) / T(3));
+            }
+        }
+
+        template<class T, class Operator>
+        SymmetricEigenPairs<T> lanczos(Operator&& op, uint_type size, uint_type count, EigenTarget target = EigenTarget::largest_magnitude,
+                                       T tolerance = T(0), uint_type basis_size = 0, uint_type max_restarts = 1000) {
+            /*
+                count eigenpairs of the symmetric size by size operator op,
+                called as op(x, y) to set y = Ax, by thick restart Lanczos
+                with full reorthogonalisation. A pair has converged once
+                ||Ax - lambda x|| <= tolerance * |lambda|, tolerance defaulting
+                to epsilon^(2/3). basis_size defaults to 2 * count + 1.
+            */
+            SymmetricEigenPairs<T> pairs;
+            count = std::min(count, size);
+            pairs.converged = false;
+            pairs.restarts = 0;
+            if (count == 0) return pairs;
+            const uint_type m = kernel::krylovBasisSize(size, count, basis_size);
+            tolerance = kernel::krylovTolerance(tolerance);
+            KrylovDecomposition<T> krylov(size, m);
+            std::vector<T> h(m * m), thetas(m), s(m * m);
+            std::vector<uint_type> order(m);
+            for (;; pairs.restarts++) {
+                krylov.expand(op, true);
+                for (uint_type row = 0; row < m; row++) {
+                    for (uint_type col = 0; col < m; col++) h[(row * m) + col] = krylov.h(row,col);
+                }
+                kernel::symmetricEigen<T>(m, h.data(), m, thetas.data(), s.data(), m);
+                for (uint_type elem = 0; elem < m; elem++) order[elem] = elem;
+                std::sort(order.begin(), order.end(), [&](uint_type left, uint_type right) {
+                    return kernel::eigenBefore(std::complex<T>(thetas[left]), std::complex<T>(thetas[right]), target);
+                });
+                const T beta = krylov.h(m,m - 1);
+                pairs.converged = true;
+                for (uint_type elem = 0; elem < count; elem++) {
+                    const T residual = std::abs(beta * s[((m - 1) * m) + order[elem]]);
+                    pairs.converged = pairs.converged && residual <= tolerance * std::max(std::abs(thetas[order[elem]]), kernel::krylovTolerance(T(0)));
+                }
+                if (pairs.converged || pairs.restarts == max_restarts || m == size) break;
+                /*
+                    Keep the wanted Ritz vectors and as many again of the next
+                    best, whose H is diagonal.
+                */
+                const uint_type keep = std::min(m - 1, count + ((m - count) / 2));
+                std::vector<T> q(m * keep), reduced(keep * keep, T(0));
+                for (uint_type col = 0; col < keep; col++) {
+                    for (uint_type row = 0; row < m; row++) q[(row * keep) + col] = s[(row * m) + order[col]];
+                    reduced[(col * keep) + col] = thetas[order[col]];
+                }
+                krylov.restart(q, keep, reduced);
+            }
+            pairs.values.resize(count);
+            std::vector<T> wanted(m * count);
+            for (uint_type col = 0; col < count; col++) {
+                pairs.values[col] = thetas[order[col]];
+                for (uint_type row = 0; row < m; row++) wanted[(row * count) + col] = s[(row * m) + order[col]];
+            }
+            pairs.vectors = Matrix<T>(count, size);
+            krylov.combine(wanted.data(), count, pairs.vectors.rowData(0), pairs.vectors.stride());
+            return pairs;
+        }
+
+        template<class T, class Operator>
+        EigenPairs<T> arnoldi(Operator&& op, uint_type size, uint_type count, EigenTarget target = EigenTarget::largest_magnitude,
+                              T tolerance = T(0), uint_type basis_size = 0, uint_type max_restarts = 1000) {
+            /*
+                count eigenpairs of the general size by size operator op by
+                restarted Arnoldi. At each restart the real and imaginary
+                parts of the kept Ritz vectors of H are orthonormalised, so
+                the decomposition stays real and the restart is the Krylov-
+                Schur one in a different basis of the same subspace.
+            */
+            typedef std::complex<T> complex_type;
+            EigenPairs<T> pairs;
+            count = std::min(count, size);
+            pairs.converged = false;
+            pairs.restarts = 0;
+            if (count == 0) return pairs;
+            const uint_type m = kernel::krylovBasisSize(size, count, basis_size);
+            tolerance = kernel::krylovTolerance(tolerance);
+            KrylovDecomposition<T> krylov(size, m);
+            std::vector<T> h(m * m), hessenberg(m * m);
+            std::vector<complex_type> thetas(m), y(m * m);
+            std::vector<bool> known(m);
+            auto ritzVector = [&](uint_type index) -> complex_type* {
+                /*
+                    Eigenvector of H for the sorted index, that of a conjugate
+                    pair's second member being the conjugate of the first's.
+                    Pairs are visited in order, so the first is known.
+                */
+                complex_type* vec = &y[index * m];
+                if (known[index]) return vec;
+                known[index] = true;
+                if (index > 0 && thetas[index].imag() < T(0) && thetas[index - 1] == std::conj(thetas[index])) {
+                    for (uint_type row = 0; row < m; row++) vec[row] = std::conj(y[((index - 1) * m) + row]);
+                }
+                else kernel::inverseIteration<T>(m, h.data(), m, thetas[index], vec);
+                return vec;
+            };
+            uint_type wanted = count;
+            for (;; pairs.restarts++) {
+                krylov.expand(op, false);
+                for (uint_type row = 0; row < m; row++) {
+                    for (uint_type col = 0; col < m; col++) h[(row * m) + col] = krylov.h(row,col);
+                }
+                hessenberg = h;
+                std::fill(known.begin(), known.end(), false);
+                kernel::hessenbergReduce<T>(m, hessenberg.data(), m);
+                const bool found = kernel::hessenbergEigenvalues<T>(m, hessenberg.data(), m, thetas.data());
+                std::sort(thetas.begin(), thetas.end(), [&](complex_type left, complex_type right) {
+                    return kernel::eigenBefore(left, right, target);
+                });
+                /*
+                    A conjugate pair is never split between the wanted and
+                    unwanted eigenvalues.
+                */
+                wanted = count;
+                if (wanted < m && thetas[wanted - 1].imag() > T(0)) wanted++;
+                const T beta = krylov.h(m,m - 1);
+                pairs.converged = found;
+                for (uint_type elem = 0; elem < wanted; elem++) {
+                    const T residual = std::abs(beta * ritzVector(elem)[m - 1]);
+                    pairs.converged = pairs.converged && residual <= tolerance * std::max(std::abs(thetas[elem]), kernel::krylovTolerance(T(0)));
+                }
+                if (!found || pairs.converged || pairs.restarts == max_restarts || m == size) break;
+                uint_type keep = std::min(m - 1, count + ((m - count) / 2));
+                if (thetas[keep - 1].imag() > T(0)) keep = (keep + 1 < m) ? keep + 1 : keep - 1;
+                keep = std::max(keep, wanted);
+                /*
+                    Orthonormal basis of the kept Ritz vectors' real and
+                    imaginary parts, by modified Gram-Schmidt twice.
+                */
+                std::vector<T> q;
+                uint_type columns = 0;
+                std::vector<std::vector<T> > parts;
+                for (uint_type elem = 0; elem < keep; elem++) {
+                    const complex_type* vec = ritzVector(elem);
+                    std::vector<T> part(m);
+                    if (thetas[elem].imag() < T(0)) {
+                        for (uint_type row = 0; row < m; row++) part[row] = vec[row].imag();
+                    }
+                    else {
+                        for (uint_type row = 0; row < m; row++) part[row] = vec[row].real();
+                    }
+                    for (uint_type pass = 0; pass < 2; pass++) {
+                        for (const std::vector<T>& other : parts) {
+                            T coefficient = T(0);
+                            for (uint_type row = 0; row < m; row++) coefficient += other[row] * part[row];
+                            for (uint_type row = 0; row < m; row++) part[row] -= coefficient * other[row];
+                        }
+                    }
+                    T length = T(0);
+                    for (uint_type row = 0; row < m; row++) length += part[row] * part[row];
+                    length = std::sqrt(length);
+                    if (length <= std::sqrt(std::numeric_limits<T>::epsilon())) continue;
+                    for (uint_type row = 0; row < m; row++) part[row] /= length;
+                    parts.push_back(part);
+                }
+                columns = parts.size();
+                q.assign(m * columns, T(0));
+                for (uint_type col = 0; col < columns; col++) {
+                    for (uint_type row = 0; row < m; row++) q[(row * columns) + col] = parts[col][row];
+                }
+                std::vector<T> hq(m * columns, T(0)), reduced(columns * columns, T(0));
+                kernel::gemm<T>(m, columns, m, T(1), h.data(), m, 1, q.data(), columns, 1, T(0), hq.data(), columns);
+                kernel::gemm<T>(columns, columns, m, T(1), q.data(), 1, columns, hq.data(), columns, 1, T(0), reduced.data(), columns);
+                krylov.restart(q, columns, reduced);
+            }
+            pairs.values.assign(thetas.begin(), thetas.begin() + count);
+            std::vector<T> real_parts(m * count), imaginary_parts(m * count);
+            for (uint_type col = 0; col < count; col++) {
+                const complex_type* vec = &y[col * m];
+                for (uint_type row = 0; row < m; row++) {
+                    real_parts[(row * count) + col] = vec[row].real();
+                    imaginary_parts[(row * count) + col] = vec[row].imag();
+                }
+            }
+            pairs.vectors = Matrix<T>(count, size);
+            pairs.imaginary_vectors = Matrix<T>(count, size);
+            krylov.combine(real_parts.data(), count, pairs.vectors.rowData(0), pairs.vectors.stride());
+            krylov.combine(imaginary_parts.data(), count, pairs.imaginary_vectors.rowData(0), pairs.imaginary_vectors.stride());
+            return pairs;
+        }
+
+        /*
+            Operators for the dense and sparse matrix types.
+        */
+
+        template<class T>
+        SymmetricEigenPairs<T> lanczos(const Matrix<T>& mat, uint_type count, EigenTarget target = EigenTarget::largest_magnitude, T tolerance = T(0)) {
+            auto op = [&mat](const T* x, T* y) {
+                kernel::gemm<T>(mat.height(), 1, mat.width(), T(1), mat.rowData(0), mat.stride(), 1, x, 1, 1, T(0), y, 1);
+            };
+            return lanczos<T>(op, mat.height(), count, target, tolerance);
+        }
+
+        template<class T>
+        SymmetricEigenPairs<T> lanczos(const SparseMatrix<T>& sparse, uint_type count, EigenTarget target = EigenTarget::largest_magnitude, T tolerance = T(0)) {
+            auto op = [&sparse](const T* x, T* y) {
+                sparse.multiply(x, 1, 1, y, 1);
+            };
+            return lanczos<T>(op, sparse.height(), count, target, tolerance);
+        }
+
+        template<class T>
+        EigenPairs<T> arnoldi(const Matrix<T>& mat, uint_type count, EigenTarget target = EigenTarget::largest_magnitude, T tolerance = T(0)) {
+            auto op = [&mat](const T* x, T* y) {
+                kernel::gemm<T>(mat.height(), 1, mat.width(), T(1), mat.rowData(0), mat.stride(), 1, x, 1, 1, T(0), y, 1);
+            };
+            return arnoldi<T>(op, mat.height(), count, target, tolerance);
+        }
+
+        template<class T>
+        EigenPairs<T> arnoldi(const SparseMatrix<T>& sparse, uint_type count, EigenTarget target = EigenTarget::largest_magnitude, T tolerance = T(0)) {
+            auto op = [&sparse](const T* x, T* y) {
+                sparse.multiply(x, 1, 1, y, 1);
+            };
+            return arnoldi<T>(op, sparse.height(), count, target, tolerance);
+        }
+    }
+}
+
+#endif
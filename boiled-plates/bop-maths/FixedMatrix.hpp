@@ -0,0 +1,433 @@
+#ifndef BOP_FIXED_MATRIX_HPP
+#define BOP_FIXED_MATRIX_HPP
+
+#include <initializer_list>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <utility>
+#include <type_traits>
+#include "../bop-defaults/types.hpp"
+#include "Matrix.hpp"
+
+/*
+    bop::maths::FixedMatrix class file
+
+    Compile-time dimensioned counterpart of bop::maths::Matrix for the small
+    matrices (2x2, 3x3, 4x4) used in geometry. Elements are stored inline in
+    row-major order, so a FixedMatrix never allocates, and every loop has a
+    trip count known at compile time for the compiler to unroll.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T, uint_type R, uint_type C>
+        class FixedMatrix;
+
+        template<class T, uint_type N>
+        struct FixedMatrixSquareOps {
+            /*
+                Determinant and inverse of square fixed matrices with no closed
+                form here, computed through the dynamic Matrix.
+            */
+            static T det(const FixedMatrix<T,N,N>& mat) {
+                return Matrix<T>(mat).det();
+            }
+
+            static bool invert(FixedMatrix<T,N,N>& mat) {
+                Matrix<T> dynamic(mat);
+                if (dynamic.det() == 0) return false;
+                mat = FixedMatrix<T,N,N>(dynamic.invert());
+                return true;
+            }
+        };
+
+        template<class T>
+        struct FixedMatrixSquareOps<T,1> {
+            static T det(const FixedMatrix<T,1,1>& mat) {
+                return mat.element(0);
+            }
+
+            static bool invert(FixedMatrix<T,1,1>& mat) {
+                if (mat.element(0) == 0) return false;
+                mat.element(0) = 1 / mat.element(0);
+                return true;
+            }
+        };
+
+        template<class T>
+        struct FixedMatrixSquareOps<T,2> {
+            static T det(const FixedMatrix<T,2,2>& m) {
+                return (m.element(0) * m.element(3)) - (m.element(1) * m.element(2));
+            }
+
+            static bool invert(FixedMatrix<T,2,2>& m) {
+                const T deter = det(m);
+                if (deter == 0) return false;
+                const T inv = 1 / deter;
+                const T a = m.element(0);
+                m.element(0) = m.element(3) * inv;
+                m.element(1) = -m.element(1) * inv;
+                m.element(2) = -m.element(2) * inv;
+                m.element(3) = a * inv;
+                return true;
+            }
+        };
+
+        template<class T>
+        struct FixedMatrixSquareOps<T,3> {
+            static T det(const FixedMatrix<T,3,3>& m) {
+                return m.element(0) * ((m.element(4) * m.element(8)) - (m.element(5) * m.element(7)))
+                     - m.element(1) * ((m.element(3) * m.element(8)) - (m.element(5) * m.element(6)))
+                     + m.element(2) * ((m.element(3) * m.element(7)) - (m.element(4) * m.element(6)));
+            }
+
+            static bool invert(FixedMatrix<T,3,3>& m) {
+                /*
+                    Adjugate divided by the determinant.
+                */
+                const T deter = det(m);
+                if (deter == 0) return false;
+                const T inv = 1 / deter;
+                const FixedMatrix<T,3,3> s(m);
+                m.element(0) = ((s.element(4) * s.element(8)) - (s.element(5) * s.element(7))) * inv;
+                m.element(1) = ((s.element(2) * s.element(7)) - (s.element(1) * s.element(8))) * inv;
+                m.element(2) = ((s.element(1) * s.element(5)) - (s.element(2) * s.element(4))) * inv;
+                m.element(3) = ((s.element(5) * s.element(6)) - (s.element(3) * s.element(8))) * inv;
+                m.element(4) = ((s.element(0) * s.element(8)) - (s.element(2) * s.element(6))) * inv;
+                m.element(5) = ((s.element(2) * s.element(3)) - (s.element(0) * s.element(5))) * inv;
+                m.element(6) = ((s.element(3) * s.element(7)) - (s.element(4) * s.element(6))) * inv;
+                m.element(7) = ((s.element(1) * s.element(6)) - (s.element(0) * s.element(7))) * inv;
+                m.element(8) = ((s.element(0) * s.element(4)) - (s.element(1) * s.element(3))) * inv;
+                return true;
+            }
+        };
+
+        template<class T>
+        struct FixedMatrixSquareOps<T,4> {
+            /*
+                The 4x4 determinant and inverse are both built from the 2x2
+                minors of the top two and bottom two rows (Laplace expansion
+                by complementary minors).
+            */
+            struct Minors {
+                T s0, s1, s2, s3, s4, s5;
+                T c0, c1, c2, c3, c4, c5;
+
+                Minors(const FixedMatrix<T,4,4>& m) {
+                    s0 = (m.element(0) * m.element(5)) - (m.element(4) * m.element(1));
+                    s1 = (m.element(0) * m.element(6)) - (m.element(4) * m.element(2));
+                    s2 = (m.element(0) * m.element(7)) - (m.element(4) * m.element(3));
+                    s3 = (m.element(1) * m.element(6)) - (m.element(5) * m.element(2));
+                    s4 = (m.element(1) * m.element(7)) - (m.element(5) * m.element(3));
+                    s5 = (m.element(2) * m.element(7)) - (m.element(6) * m.element(3));
+                    c5 = (m.element(10) * m.element(15)) - (m.element(14) * m.element(11));
+                    c4 = (m.element(9) * m.element(15)) - (m.element(13) * m.element(11));
+                    c3 = (m.element(9) * m.element(14)) - (m.element(13) * m.element(10));
+                    c2 = (m.element(8) * m.element(15)) - (m.element(12) * m.element(11));
+                    c1 = (m.element(8) * m.element(14)) - (m.element(12) * m.element(10));
+                    c0 = (m.element(8) * m.element(13)) - (m.element(12) * m.element(9));
+                }
+
+                inline T det() const {
+                    return (s0 * c5) - (s1 * c4) + (s2 * c3) + (s3 * c2) - (s4 * c1) + (s5 * c0);
+                }
+            };
+
+            static T det(const FixedMatrix<T,4,4>& m) {
+                return Minors(m).det();
+            }
+
+            static bool invert(FixedMatrix<T,4,4>& m) {
+                const Minors x(m);
+                const T deter = x.det();
+                if (deter == 0) return false;
+                const T inv = 1 / deter;
+                const FixedMatrix<T,4,4> a(m);
+                m.element(0)  = ( a.element(5) * x.c5 - a.element(6) * x.c4 + a.element(7) * x.c3) * inv;
+                m.element(1)  = (-a.element(1) * x.c5 + a.element(2) * x.c4 - a.element(3) * x.c3) * inv;
+                m.element(2)  = ( a.element(13) * x.s5 - a.element(14) * x.s4 + a.element(15) * x.s3) * inv;
+                m.element(3)  = (-a.element(9) * x.s5 + a.element(10) * x.s4 - a.element(11) * x.s3) * inv;
+                m.element(4)  = (-a.element(4) * x.c5 + a.element(6) * x.c2 - a.element(7) * x.c1) * inv;
+                m.element(5)  = ( a.element(0) * x.c5 - a.element(2) * x.c2 + a.element(3) * x.c1) * inv;
+                m.element(6)  = (-a.element(12) * x.s5 + a.element(14) * x.s2 - a.element(15) * x.s1) * inv;
+                m.element(7)  = ( a.element(8) * x.s5 - a.element(10) * x.s2 + a.element(11) * x.s1) * inv;
+                m.element(8)  = ( a.element(4) * x.c4 - a.element(5) * x.c2 + a.element(7) * x.c0) * inv;
+                m.element(9)  = (-a.element(0) * x.c4 + a.element(1) * x.c2 - a.element(3) * x.c0) * inv;
+                m.element(10) = ( a.element(12) * x.s4 - a.element(13) * x.s2 + a.element(15) * x.s0) * inv;
+                m.element(11) = (-a.element(8) * x.s4 + a.element(9) * x.s2 - a.element(11) * x.s0) * inv;
+                m.element(12) = (-a.element(4) * x.c3 + a.element(5) * x.c1 - a.element(6) * x.c0) * inv;
+                m.element(13) = ( a.element(0) * x.c3 - a.element(1) * x.c1 + a.element(2) * x.c0) * inv;
+                m.element(14) = (-a.element(12) * x.s3 + a.element(13) * x.s1 - a.element(14) * x.s0) * inv;
+                m.element(15) = ( a.element(8) * x.s3 - a.element(9) * x.s1 + a.element(10) * x.s0) * inv;
+                return true;
+            }
+        };
+
+        template<class T, uint_type R, uint_type C>
+        class FixedMatrix {
+            public:
+                T data[R * C];
+
+                //Constructors
+                constexpr FixedMatrix() : data() {
+                    /*
+                        Zero initialised matrix, usable in constant
+                        expressions.
+                    */
+                }
+
+                template<class... A, class = typename std::enable_if<sizeof...(A) + 1 == R * C>::type>
+                constexpr explicit FixedMatrix(T first, A... rest) : data{first, static_cast<T>(rest)...} {
+                    /*
+                        Constructs from exactly R*C elements in row-major
+                        order, usable in constant expressions. Other counts
+                        drop out of overload resolution.
+                    */
+                }
+
+                FixedMatrix(std::initializer_list< std::initializer_list<T> > list) : data() {
+                    /*
+                        Creates a matrix from a 2-dimensional initializer_list,
+                        as with bop::maths::Matrix. Missing elements are zero.
+                    */
+                    uint_type row = 0;
+                    for (auto sublist = list.begin(); sublist != list.end() && row < R; sublist++, row++) {
+                        uint_type col = 0;
+                        for (auto elem = sublist->begin(); elem != sublist->end() && col < C; elem++, col++) {
+                            this->data[(row * C) + col] = *elem;
+                        }
+                    }
+                }
+
+                explicit FixedMatrix(const Matrix<T>& mat) : data() {
+                    /*
+                        Copies the overlapping region of a dynamic matrix.
+                    */
+                    for (uint_type row = 0; row < R && row < mat.height(); row++) {
+                        for (uint_type col = 0; col < C && col < mat.width(); col++) {
+                            this->data[(row * C) + col] = mat.element(row,col);
+                        }
+                    }
+                }
+
+                operator Matrix<T>() const {
+                    /*
+                        Conversion to a dynamic matrix.
+                    */
+                    Matrix<T> mat(C, R);
+                    for (uint_type elem = 0; elem < R * C; elem++) mat.element(elem) = this->data[elem];
+                    return mat;
+                }
+
+                static constexpr FixedMatrix<T,R,C> identity() {
+                    FixedMatrix<T,R,C> mat;
+                    for (uint_type elem = 0; elem < R && elem < C; elem++) mat.data[(elem * C) + elem] = 1;
+                    return mat;
+                }
+
+                //Information functions
+
+                constexpr uint_type width() const {
+                    return C;
+                }
+
+                constexpr uint_type height() const {
+                    return R;
+                }
+
+                constexpr bool square() const {
+                    return R == C;
+                }
+
+                inline T& element(uint_type row, uint_type col) {
+                    return this->data[(row * C) + col];
+                }
+
+                constexpr const T& element(uint_type row, uint_type col) const {
+                    return this->data[(row * C) + col];
+                }
+
+                inline T& element(uint_type elem) {
+                    return this->data[elem];
+                }
+
+                constexpr const T& element(uint_type elem) const {
+                    return this->data[elem];
+                }
+
+                inline T* operator[] (uint_type row) {
+                    /*
+                        Returns the start of a row, so that [row][col] indexing
+                        needs no helper object.
+                    */
+                    return this->data + (row * C);
+                }
+
+                constexpr const T* operator[] (uint_type row) const {
+                    return this->data + (row * C);
+                }
+
+                //Boolean logic overloads
+
+                bool operator== (const FixedMatrix<T,R,C>& mat) const {
+                    for (uint_type elem = 0; elem < R * C; elem++) {
+                        if (this->data[elem] != mat.data[elem]) return false;
+                    }
+                    return true;
+                }
+
+                bool operator!= (const FixedMatrix<T,R,C>& mat) const {
+                    return !((*this) == mat);
+                }
+
+                //Arithmetic overloads
+
+                FixedMatrix<T,R,C>& operator+= (const FixedMatrix<T,R,C>& mat) {
+                    for (uint_type elem = 0; elem < R * C; elem++) this->data[elem] += mat.data[elem];
+                    return *this;
+                }
+
+                FixedMatrix<T,R,C>& operator-= (const FixedMatrix<T,R,C>& mat) {
+                    for (uint_type elem = 0; elem < R * C; elem++) this->data[elem] -= mat.data[elem];
+                    return *this;
+                }
+
+                FixedMatrix<T,R,C>& operator*= (const T scalar) {
+                    for (uint_type elem = 0; elem < R * C; elem++) this->data[elem] *= scalar;
+                    return *this;
+                }
+
+                FixedMatrix<T,R,C>& operator/= (const T scalar) {
+                    /*
+                        As with Matrix, division by zero leaves the matrix unchanged.
+                    */
+                    if (scalar != 0) (*this) *= (1/scalar);
+                    return *this;
+                }
+
+                FixedMatrix<T,R,C>& operator*= (const FixedMatrix<T,C,C>& mat) {
+                    (*this) = (*this) * mat;
+                    return *this;
+                }
+
+                FixedMatrix<T,R,C> operator- () const {
+                    FixedMatrix<T,R,C> mat(*this);
+                    for (uint_type elem = 0; elem < R * C; elem++) mat.data[elem] = -mat.data[elem];
+                    return mat;
+                }
+
+                //Square matrix functions
+
+                T det() const {
+                    static_assert(R == C, "bop::maths::FixedMatrix::det() needs a square matrix.");
+                    return FixedMatrixSquareOps<T,R>::det(*this);
+                }
+
+                FixedMatrix<T,R,C>& invert() {
+                    /*
+                        Inverts the matrix in place, a singular matrix is left
+                        unchanged.
+                    */
+                    static_assert(R == C, "bop::maths::FixedMatrix::invert() needs a square matrix.");
+                    FixedMatrixSquareOps<T,R>::invert(*this);
+                    return *this;
+                }
+
+                FixedMatrix<T,R,C> inverted() const {
+                    return FixedMatrix<T,R,C>(*this).invert();
+                }
+
+                FixedMatrix<T,R,C>& transpose() {
+                    static_assert(R == C, "bop::maths::FixedMatrix::transpose() is in place, use transposed() for non-square matrices.");
+                    for (uint_type row = 0; row < R; row++) {
+                        for (uint_type col = row + 1; col < C; col++) {
+                            std::swap(this->data[(row * C) + col], this->data[(col * C) + row]);
+                        }
+                    }
+                    return *this;
+                }
+
+                FixedMatrix<T,C,R> transposed() const {
+                    FixedMatrix<T,C,R> mat;
+                    for (uint_type row = 0; row < R; row++) {
+                        for (uint_type col = 0; col < C; col++) {
+                            mat.data[(col * R) + row] = this->data[(row * C) + col];
+                        }
+                    }
+                    return mat;
+                }
+
+                std::string string(bool newlines = true) const {
+                    return Matrix<T>(*this).string(newlines);
+                }
+        };
+
+        typedef FixedMatrix<prec_type,2,2> matrix2;
+        typedef FixedMatrix<prec_type,3,3> matrix3;
+        typedef FixedMatrix<prec_type,4,4> matrix4;
+
+        //External arithmetic overloads
+
+        template<class T, uint_type R, uint_type K, uint_type C>
+        FixedMatrix<T,R,C> operator* (const FixedMatrix<T,R,K>& mat1, const FixedMatrix<T,K,C>& mat2) {
+            /*
+                Fixed size product, the row of the result is accumulated as a
+                sum of scaled rows of mat2 so the innermost loop is contiguous.
+            */
+            FixedMatrix<T,R,C> mat_p;
+            for (uint_type row = 0; row < R; row++) {
+                for (uint_type iter = 0; iter < K; iter++) {
+                    const T scale = mat1.data[(row * K) + iter];
+                    for (uint_type col = 0; col < C; col++) {
+                        mat_p.data[(row * C) + col] += scale * mat2.data[(iter * C) + col];
+                    }
+                }
+            }
+            return mat_p;
+        }
+
+        template<class T, uint_type R, uint_type C>
+        Vector<T> operator* (const FixedMatrix<T,R,C>& mat, const Vector<T>& vec) {
+            Vector<T> vec_p(R);
+            for (uint_type row = 0; row < R; row++) {
+                T product = 0;
+                for (uint_type col = 0; col < C && col < vec.size(); col++) product += mat.data[(row * C) + col] * vec[col];
+                vec_p[row] = product;
+            }
+            return vec_p;
+        }
+
+        template<class T, uint_type R, uint_type C>
+        FixedMatrix<T,R,C> operator* (const FixedMatrix<T,R,C>& mat, const T scalar) {
+            return FixedMatrix<T,R,C>(mat) *= scalar;
+        }
+
+        template<class T, uint_type R, uint_type C>
+        FixedMatrix<T,R,C> operator/ (const FixedMatrix<T,R,C>& mat, const T scalar) {
+            return FixedMatrix<T,R,C>(mat) /= scalar;
+        }
+
+        template<class T, uint_type R, uint_type C>
+        FixedMatrix<T,R,C> operator+ (const FixedMatrix<T,R,C>& mat1, const FixedMatrix<T,R,C>& mat2) {
+            return FixedMatrix<T,R,C>(mat1) += mat2;
+        }
+
+        template<class T, uint_type R, uint_type C>
+        FixedMatrix<T,R,C> operator- (const FixedMatrix<T,R,C>& mat1, const FixedMatrix<T,R,C>& mat2) {
+            return FixedMatrix<T,R,C>(mat1) -= mat2;
+        }
+
+        template<class T, uint_type R, uint_type C>
+        std::ostream& operator<< (std::ostream& stream, const FixedMatrix<T,R,C>& mat) {
+            stream << mat.string();
+            return stream;
+        }
+    }
+}
+
+#endif
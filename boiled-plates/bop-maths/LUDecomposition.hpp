@@ -0,0 +1,348 @@
+#ifndef BOP_LU_DECOMPOSITION_HPP
+#define BOP_LU_DECOMPOSITION_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "SIMD.hpp"
+#include "MatrixView.hpp"
+#include "TriangularSolve.hpp"
+
+/*
+    bop::maths::LUDecomposition class file
+
+    Partially pivoted LU factorization, PA = LU. The unit lower triangle L
+    and upper triangle U are stored packed in a single row-major buffer
+    (the unit diagonal of L is implicit) alongside the row pivots, so one
+    factorization can be reused for the determinant, the inverse and any
+    number of solves.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        template<class T>
+        class LUDecomposition {
+            protected:
+                uint_type order;
+                std::vector<T> factors;
+                /*
+                    Row i of the matrix was swapped with row pivots[i] at step i,
+                    as in LAPACK's ipiv.
+                */
+                std::vector<uint_type> pivots;
+                int pivot_sign;
+                bool is_singular;
+
+                inline T& at(uint_type row, uint_type col) {
+                    return this->factors[(row * this->order) + col];
+                }
+
+                inline const T& at(uint_type row, uint_type col) const {
+                    return this->factors[(row * this->order) + col];
+                }
+
+                void swapRows(uint_type row_a, uint_type row_b) {
+                    std::swap_ranges(this->factors.begin() + (row_a * this->order),
+                                     this->factors.begin() + ((row_a + 1) * this->order),
+                                     this->factors.begin() + (row_b * this->order));
+                }
+
+                void factorizePanel(uint_type start, uint_type panel_width) {
+                    /*
+                        Unblocked, right-looking elimination of the columns
+                        [start, start + panel_width), only updating inside the
+                        panel. Pivot rows are swapped across the full width.
+                    */
+                    const uint_type n = this->order;
+                    for (uint_type col = start; col < start + panel_width; col++) {
+                        uint_type pivot_row = col;
+                        T pivot_mag = std::abs(this->at(col,col));
+                        for (uint_type row = col + 1; row < n; row++) {
+                            if (std::abs(this->at(row,col)) > pivot_mag) {
+                                pivot_mag = std::abs(this->at(row,col));
+                                pivot_row = row;
+                            }
+                        }
+                        this->pivots[col] = pivot_row;
+                        if (this->at(pivot_row,col) == T(0)) {
+                            /*
+                                The column is already zero below the diagonal,
+                                so there is nothing to eliminate.
+                            */
+                            this->is_singular = true;
+                            continue;
+                        }
+                        if (pivot_row != col) {
+                            this->swapRows(pivot_row, col);
+                            this->pivot_sign = -this->pivot_sign;
+                        }
+                        const T inv_pivot = T(1) / this->at(col,col);
+                        const uint_type rest = start + panel_width - col - 1;
+                        for (uint_type row = col + 1; row < n; row++) {
+                            T& multiplier = this->at(row,col);
+                            multiplier *= inv_pivot;
+                            if (rest > 0 && multiplier != T(0)) {
+                                kernel::axpy<T>(rest, -multiplier, &this->at(col,col + 1), &this->at(row,col + 1));
+                            }
+                        }
+                    }
+                }
+
+            public:
+                /*
+                    Width of the column panels factored between trailing GEMM
+                    updates.
+                */
+                static const uint_type block_size = 64;
+
+                LUDecomposition() : order(0), pivot_sign(1), is_singular(false) {
+                }
+
+                LUDecomposition(const Matrix<T>& mat) : LUDecomposition() {
+                    /*
+                        A non-square matrix gives an empty factorization that
+                        reports itself singular.
+                    */
+                    if (mat.square()) this->factorize(mat.rowData(0), mat.height(), mat.stride());
+                    else this->is_singular = true;
+                }
+
+                LUDecomposition(const MatrixView<T>& view) : LUDecomposition() {
+                    if (view.width() == view.height()) this->factorize(view.data(), view.height(), view.stride());
+                    else this->is_singular = true;
+                }
+
+                LUDecomposition(const T* data, uint_type size, uint_type ld) : LUDecomposition() {
+                    this->factorize(data, size, ld);
+                }
+
+                LUDecomposition<T>& factorize(const T* data, uint_type size, uint_type ld) {
+                    /*
+                        Factors the size by size matrix at data, whose rows are ld
+                        elements apart, discarding any previous factorization.
+
+                        Blocked right-looking elimination: each panel of
+                        block_size columns is factored, the matching block row of
+                        U is found by a unit lower triangular solve and the
+                        trailing matrix is updated by a single GEMM, so the
+                        trailing matrix is streamed once per panel rather than
+                        once per column.
+                    */
+                    const uint_type n = size;
+                    const uint_type nb = block_size;
+                    this->order = n;
+                    this->factors.resize(n * n);
+                    this->pivots.resize(n);
+                    this->pivot_sign = 1;
+                    this->is_singular = false;
+                    for (uint_type row = 0; row < n; row++) {
+                        std::copy(data + (row * ld), data + (row * ld) + n, this->factors.begin() + (row * n));
+                    }
+                    for (uint_type start = 0; start < n; start += nb) {
+                        const uint_type panel_width = std::min(nb, n - start);
+                        const uint_type trailing = n - start - panel_width;
+                        this->factorizePanel(start, panel_width);
+                        if (trailing == 0) continue;
+                        /*
+                            U12 = L11^-1 * A12, by forward substitution on the
+                            rows of the block row.
+                        */
+                        const uint_type right = start + panel_width;
+                        for (uint_type row = start + 1; row < right; row++) {
+                            for (uint_type iter = start; iter < row; iter++) {
+                                if (this->at(row,iter) != T(0)) {
+                                    kernel::axpy<T>(trailing, -this->at(row,iter), &this->at(iter,right), &this->at(row,right));
+                                }
+                            }
+                        }
+                        /*
+                            A22 -= L21 * U12
+                        */
+                        kernel::gemm<T>(trailing, trailing, panel_width, T(-1),
+                                        &this->at(right,start), n, 1,
+                                        &this->at(start,right), n, 1,
+                                        T(1), &this->at(right,right), n);
+                    }
+                    return *this;
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->order;
+                }
+
+                inline bool singular() const {
+                    return this->is_singular;
+                }
+
+                inline const std::vector<uint_type>& pivotIndices() const {
+                    return this->pivots;
+                }
+
+                inline const T* data() const {
+                    /*
+                        The packed factors, L strictly below the diagonal and U on
+                        and above it.
+                    */
+                    return this->factors.data();
+                }
+
+                T det() const {
+                    /*
+                        Product of the pivots, negated for an odd number of row
+                        swaps.
+                    */
+                    T deter = T(this->pivot_sign);
+                    for (uint_type elem = 0; elem < this->order; elem++) deter *= this->at(elem,elem);
+                    return deter;
+                }
+
+                Matrix<T> lower() const {
+                    Matrix<T> mat(this->order, this->order, 0);
+                    for (uint_type row = 0; row < this->order; row++) {
+                        for (uint_type col = 0; col < row; col++) mat.element(row,col) = this->at(row,col);
+                        mat.element(row,row) = 1;
+                    }
+                    return mat;
+                }
+
+                Matrix<T> upper() const {
+                    Matrix<T> mat(this->order, this->order, 0);
+                    for (uint_type row = 0; row < this->order; row++) {
+                        for (uint_type col = row; col < this->order; col++) mat.element(row,col) = this->at(row,col);
+                    }
+                    return mat;
+                }
+
+                Matrix<T> permutation() const {
+                    /*
+                        The permutation matrix P of PA = LU.
+                    */
+                    std::vector<uint_type> rows(this->order);
+                    for (uint_type row = 0; row < this->order; row++) rows[row] = row;
+                    for (uint_type row = 0; row < this->order; row++) std::swap(rows[row], rows[this->pivots[row]]);
+                    Matrix<T> mat(this->order, this->order, 0);
+                    for (uint_type row = 0; row < this->order; row++) mat.element(row, rows[row]) = 1;
+                    return mat;
+                }
+
+                //Solving
+
+                void solveInPlace(T* b, uint_type columns, uint_type ldb) const {
+                    /*
+                        Overwrites the size by columns right hand side at b with
+                        the solution X of AX = B, in O(n^2) work per column. A
+                        singular factorization gives non-finite elements, so
+                        check singular() first where that matters.
+                    */
+                    const uint_type n = this->order;
+                    for (uint_type row = 0; row < n; row++) {
+                        if (this->pivots[row] != row) {
+                            std::swap_ranges(b + (row * ldb), b + (row * ldb) + columns, b + (this->pivots[row] * ldb));
+                        }
+                    }
+                    if (columns == 1) {
+                        /*
+                            A single right hand side is solved with dot products
+                            along the rows of the factors.
+                        */
+                        for (uint_type row = 1; row < n; row++) {
+                            T sum = b[row * ldb];
+                            for (uint_type iter = 0; iter < row; iter++) sum -= this->at(row,iter) * b[iter * ldb];
+                            b[row * ldb] = sum;
+                        }
+                        for (uint_type row = n; row-- > 0;) {
+                            T sum = b[row * ldb];
+                            for (uint_type iter = row + 1; iter < n; iter++) sum -= this->at(row,iter) * b[iter * ldb];
+                            b[row * ldb] = sum / this->at(row,row);
+                        }
+                        return;
+                    }
+                    /*
+                        Many right hand sides go through the blocked triangular
+                        solves, L unit lower then U upper.
+                    */
+                    kernel::trsmLower<T>(n, columns, this->factors.data(), n, true, b, ldb);
+                    kernel::trsmUpper<T>(n, columns, this->factors.data(), n, false, b, ldb);
+                }
+
+                void solveInPlace(const MatrixView<T>& b) const {
+                    /*
+                        b is left unchanged if it does not have size() rows or
+                        the factorization is singular.
+                    */
+                    if (b.height() != this->order || this->is_singular) return;
+                    this->solveInPlace(b.data(), b.width(), b.stride());
+                }
+
+                Matrix<T> solve(const Matrix<T>& b) const {
+                    /*
+                        b is returned unchanged if it does not have size() rows
+                        or the factorization is singular.
+                    */
+                    if (b.height() != this->order || this->is_singular) return b;
+                    Matrix<T> x(b);
+                    this->solveInPlace(x.rowData(0), x.width(), x.stride());
+                    return x;
+                }
+
+                Matrix<T> solve(const MatrixView<T>& b) const {
+                    Matrix<T> x(b);
+                    if (b.height() != this->order || this->is_singular) return x;
+                    this->solveInPlace(x.rowData(0), x.width(), x.stride());
+                    return x;
+                }
+
+                Matrix<T> inverse() const {
+                    Matrix<T> inv(this->order, this->order, 0);
+                    for (uint_type elem = 0; elem < this->order; elem++) inv.element(elem,elem) = 1;
+                    this->solveInPlace(inv.rowData(0), this->order, inv.stride());
+                    return inv;
+                }
+        };
+
+        template<class T>
+        Matrix<T> solve(const LUDecomposition<T>& lu, const Matrix<T>& b) {
+            /*
+                X such that AX = B, reusing a factorization of A so that each
+                call costs O(n^2) per right hand side.
+            */
+            return lu.solve(b);
+        }
+
+        template<class T>
+        Matrix<T> solve(const LUDecomposition<T>& lu, const MatrixView<T>& b) {
+            return lu.solve(b);
+        }
+
+        template<class T>
+        Matrix<T> solve(const Matrix<T>& a, const Matrix<T>& b) {
+            /*
+                X such that AX = B for every column of B at once, by
+                factoring A and substituting rather than forming A^-1, which
+                is about a third of the work and more accurate. B is
+                returned unchanged if A is not square, B does not have as
+                many rows as A or A is singular.
+            */
+            return LUDecomposition<T>(a).solve(b);
+        }
+
+        template<class T>
+        Matrix<T> solve(const MatrixView<T>& a, const MatrixView<T>& b) {
+            return LUDecomposition<T>(a).solve(b);
+        }
+    }
+}
+
+#endif
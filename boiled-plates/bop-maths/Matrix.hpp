@@ -3,7 +3,14 @@
 #ifndef BOP_MATRIX_DISCARD_BY
 #define BOP_MATRIX_DISCARD_BY 0xFFFF
 #endif
+#ifndef BOP_MATRIX_ALIGNMENT
+#define BOP_MATRIX_ALIGNMENT 64
+#endif
 #include <initializer_list>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -14,11 +21,20 @@
 #include <vector>
 #include "MathsExtra.hpp"
 #include "Vector.hpp"
+#include "MatrixKernels.hpp"
+#include "MatrixVectorKernels.hpp"
+#include "SIMD.hpp"
+#include "MatrixExpression.hpp"
+#include "MatrixView.hpp"
+#include "StructuredMatrix.hpp"
+#include "MatrixCache.hpp"
+#include "MatrixAllocator.hpp"
+#include "LUDecomposition.hpp"
+#include "CholeskyDecomposition.hpp"
+#include "QRDecomposition.hpp"
+#include "BareissElimination.hpp"
+#include "MatrixTranspose.hpp"
 #include "../bop-defaults/types.hpp"
-#ifdef BOP_MATRIX_USE_RECYCLER
-#include "../bop-memory/Recycler.hpp"
-#include "../bop-memory/PrimativeArrayContainer.hpp"
-#endif
 
 /*
     bop::maths::Matrix class file
@@ -37,19 +53,102 @@ namespace bop {
                 static_assert(std::is_trivially_copyable<T>::value, "The class bop::maths::Matrix<T> can only have T be a trivially copyable type.");
                 static_assert(std::is_trivially_destructable<T>::value, "The class bop::maths::Matrix<T> can only have T be trivially destructable.");
                 #endif
-                #ifdef BOP_MATRIX_USE_RECYCLER
-                static mem::PrimativeArrayRecycler<T> recycler;
-                #endif
                 uint_type matrix_width;
                 uint_type matrix_height;
+                uint_type matrix_stride;
+                uint_type matrix_capacity;
                 T* data;
 
-                inline void setData(uint_type width, uint_type height, bool delete_ptr = true) {
-                    if (this->data == nullptr || (delete_ptr && (width * height) > this->width() * this->height())) {
-                        this->data = static_cast<T*>(realloc(this->data, width * height * sizeof(T)));
+                #ifdef BOP_MATRIX_PAD_ROWS
+                static const bool pad_by_default = true;
+                #else
+                static const bool pad_by_default = false;
+                #endif
+
+                static uint_type leadingDimension(uint_type width, bool padded) {
+                    /*
+                        Row stride for a matrix of the given width. Padded rows
+                        are rounded up to whole alignment units so every row
+                        starts aligned, plus one more unit when the stride would
+                        be a multiple of 4KiB and successive rows would compete
+                        for the same cache sets.
+                    */
+                    const uint_type unit = BOP_MATRIX_ALIGNMENT / sizeof(T);
+                    if (!padded || width <= 1 || unit == 0 || (BOP_MATRIX_ALIGNMENT % sizeof(T)) != 0) return width;
+                    uint_type stride = ((width + unit - 1) / unit) * unit;
+                    if (((stride * sizeof(T)) % 4096) == 0) stride += unit;
+                    return stride;
+                }
+
+                static inline std::size_t allocationBytes(uint_type count) {
+                    return (count * sizeof(T)) + (2 * sizeof(void*)) + BOP_MATRIX_ALIGNMENT - 1;
+                }
+
+                static T* allocate(uint_type count) {
+                    /*
+                        Storage comes from the allocator active on this thread
+                        (see MatrixAllocator.hpp) and is aligned to
+                        BOP_MATRIX_ALIGNMENT bytes by over-allocating. The two
+                        words just before the aligned pointer keep the block and
+                        the allocator it came from, so it is released to that
+                        allocator whichever one is active by then.
+                        posix_memalign was measured at several times the cost
+                        of malloc for small matrices, and its split chunks kept
+                        large buffers from being reused.
+                    */
+                    static_assert(BOP_MATRIX_ALIGNMENT >= sizeof(void*) && (BOP_MATRIX_ALIGNMENT & (BOP_MATRIX_ALIGNMENT - 1)) == 0,
+                                  "BOP_MATRIX_ALIGNMENT must be a power of two no smaller than a pointer.");
+                    MatrixAllocator& owner = MatrixAllocator::active();
+                    unsigned char* block = static_cast<unsigned char*>(owner.allocate(Matrix<T>::allocationBytes(count)));
+                    if (block == nullptr) return nullptr;
+                    unsigned char* aligned = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(block) + (2 * sizeof(void*)) + BOP_MATRIX_ALIGNMENT - 1) & ~uintptr_t(BOP_MATRIX_ALIGNMENT - 1));
+                    reinterpret_cast<void**>(aligned)[-1] = block;
+                    reinterpret_cast<void**>(aligned)[-2] = &owner;
+                    return reinterpret_cast<T*>(aligned);
+                }
+
+                static void release(T* pointer, uint_type count) {
+                    if (pointer == nullptr) return;
+                    void** header = reinterpret_cast<void**>(pointer);
+                    static_cast<MatrixAllocator*>(header[-2])->release(header[-1], Matrix<T>::allocationBytes(count));
+                }
+
+                inline void setData(uint_type width, uint_type height, bool delete_ptr = true, bool padded = pad_by_default) {
+                    /*
+                        Sets the shape of the matrix, only allocating when the
+                        current storage is too small. Contents are not kept.
+                    */
+                    const uint_type stride = Matrix<T>::leadingDimension(width, padded);
+                    if (this->data == nullptr || (delete_ptr && (stride * height) > this->matrix_capacity)) {
+                        Matrix<T>::release(this->data, this->matrix_capacity);
+                        this->data = Matrix<T>::allocate(stride * height);
+                        this->matrix_capacity = stride * height;
                     }
                     this->matrix_width = width;
                     this->matrix_height = height;
+                    this->matrix_stride = stride;
+                }
+
+                inline void swapStorage(Matrix<T>& mat) {
+                    std::swap(this->matrix_width, mat.matrix_width);
+                    std::swap(this->matrix_height, mat.matrix_height);
+                    std::swap(this->matrix_stride, mat.matrix_stride);
+                    std::swap(this->matrix_capacity, mat.matrix_capacity);
+                    std::swap(this->data, mat.data);
+                }
+
+                inline void copyElements(const Matrix<T>& mat) {
+                    /*
+                        Copies the elements of a matrix of the same shape.
+                    */
+                    if (this->packed() && mat.packed()) {
+                        memcpy(this->data, mat.data, this->width() * this->height() * sizeof(T));
+                    }
+                    else {
+                        for (uint_type row = 0; row < this->height(); row++) {
+                            memcpy(this->data + (row * this->matrix_stride), mat.data + (row * mat.matrix_stride), this->width() * sizeof(T));
+                        }
+                    }
                 }
 
                 class MatrixIndexHandler {
@@ -80,6 +179,7 @@ namespace bop {
 
                 MatrixIndexHandler handler;
             public:
+                typedef T value_type;
 
                 //Constructors
                 Matrix() : handler(*this) {
@@ -89,6 +189,8 @@ namespace bop {
                     this->data = nullptr;
                     this->matrix_width = 0;
                     this->matrix_height = 0;
+                    this->matrix_stride = 0;
+                    this->matrix_capacity = 0;
                 }
 
                 Matrix(uint_type width, uint_type height, T fill = 0) : Matrix() {
@@ -97,9 +199,19 @@ namespace bop {
                         the given fill value.
                     */
                     this->setData(width,height,false);
-                    for (uint_type elem = 0; elem < this->width() * this->height(); elem++) {
-                        this->element(elem) = fill;
-                    }
+                    this->fill(fill);
+                }
+
+                static Matrix<T> padded(uint_type width, uint_type height, T fill = 0) {
+                    /*
+                        A matrix whose rows are padded to aligned starts, see
+                        leadingDimension. Defining BOP_MATRIX_PAD_ROWS pads
+                        every matrix.
+                    */
+                    Matrix<T> mat;
+                    mat.setData(width, height, false, true);
+                    mat.fill(fill);
+                    return mat;
                 }
 
                 template<class A>
@@ -107,7 +219,7 @@ namespace bop {
                     /*
                         Creates a matrix from a 2-dimensional initializer_list.
                     */
-                    this->setData(list.size(), list.begin()->size(), false);
+                    this->setData(list.begin()->size(), list.size(), false);
                     uint_type row = 0;
                     for (auto sublist : list) {
                         uint_type col = 0;
@@ -123,41 +235,45 @@ namespace bop {
                     /*
                         Copy constructor.
                     */
-                    this->setData(mat.width(),mat.height(),false);
-                    memcpy(this->data, mat.data, mat.width() * mat.height() * sizeof(T));
+                    this->setData(mat.width(),mat.height(),false,mat.padded());
+                    this->copyElements(mat);
                 }
 
                 template<class A>
                 Matrix(const Matrix<A>& mat_tocast) : Matrix() {
-                    this->setData(mat_tocast.width(), mat_tocast.height(), false);
-                    for (uint_type elem = 0; elem < mat_tocast.width() * mat_tocast.height(); elem++) this->element(0,elem) = static_cast<T>(mat_tocast.element(0,elem));
+                    /*
+                        Converting constructor, row by row through the
+                        conversion kernels, which are vectorised between
+                        float and double.
+                    */
+                    this->setData(mat_tocast.width(), mat_tocast.height(), false, mat_tocast.padded());
+                    for (uint_type row = 0; row < this->height(); row++) kernel::convert<A,T>(this->width(), mat_tocast.rowData(row), this->rowData(row));
+                }
+
+                template<class E>
+                Matrix(const MatrixExpression<E>& expr) : Matrix() {
+                    /*
+                        Evaluates an element-wise expression (see
+                        MatrixExpression.hpp) into a new matrix.
+                    */
+                    this->setData(expr.expression().width(), expr.expression().height(), false);
+                    this->assignExpression(expr.expression());
                 }
 
                 #ifndef BOP_MATRIX_DEFAULT_MOVE
-                Matrix(Matrix<T>&& mat) : Matrix() {
+                Matrix(Matrix<T>&& mat) noexcept : Matrix() {
                     /*
-                        Move constructor.
+                        Move constructor, takes the storage of the given
+                        matrix and leaves it empty. The index handler is not
+                        moved, it was bound to this matrix by Matrix().
                     */
-                    #ifdef BOP_MATRIX_SWAPMOVE
-                    std::swap(this->matrix_width, mat.matrix_width);
-                    std::swap(this->matrix_height, mat.matrix_height);
-                    std::swap(this->data, mat.data);
-                    #else
-                    this->matrix_width = mat.matrix_width;
-                    this->matrix_height = mat.matrix_height;
-                    this->data = mat.data;
-                    mat.data = nullptr;
-                    #endif
+                    this->swapStorage(mat);
                 }
                 #endif
 
                 //Destructor
                 ~Matrix() {
-                    #ifdef BOP_MATRIX_USE_RECYCLER
-                    if (this->data != nullptr) Matrix<T>::recycler.give(this->data, this->width() * this->height());
-                    #else
-                    delete[] this->data;
-                    #endif
+                    Matrix<T>::release(this->data, this->matrix_capacity);
                     this->data = nullptr;
                 }
 
@@ -172,25 +288,48 @@ namespace bop {
                 }
 
                 inline Matrix<T>& operator= (const Matrix<T>& mat) {
-                    this->setData(mat.width(), mat.height());
-                    memcpy(this->data, mat.data, this->width() * this->height() * sizeof(T));
+                    if (this == &mat) return *this;
+                    this->setData(mat.width(), mat.height(), true, mat.padded());
+                    this->copyElements(mat);
                     return *this;
                 }
 
-                inline Matrix<T>& operator= (Matrix<T>&& mat) {
-                    #ifdef BOP_MATRIX_SWAPMOVE
-                    std::swap(this->matrix_width, mat.matrix_width);
-                    std::swap(this->matrix_height, mat.matrix_height);
-                    std::swap(this->data, mat.data);
-                    #else
-                    this->matrix_width = mat.matrix_width;
-                    this->matrix_height = mat.matrix_height;
-                    this->data = mat.data;
+                inline Matrix<T>& operator= (Matrix<T>&& mat) noexcept {
+                    /*
+                        Move assignment. The storage this matrix held is
+                        released, or with BOP_MATRIX_SWAPMOVE handed to the
+                        moved-from matrix to be released with it.
+                    */
+                    if (this == &mat) return *this;
+                    this->swapStorage(mat);
+                    #ifndef BOP_MATRIX_SWAPMOVE
+                    Matrix<T>::release(mat.data, mat.matrix_capacity);
                     mat.data = nullptr;
+                    mat.matrix_width = 0;
+                    mat.matrix_height = 0;
+                    mat.matrix_stride = 0;
+                    mat.matrix_capacity = 0;
                     #endif
                     return *this;
                 }
 
+                template<class E>
+                Matrix<T>& operator= (const MatrixExpression<E>& expr) {
+                    /*
+                        Evaluates an expression into this matrix in a single
+                        pass. When the expression changes the shape of the
+                        matrix it is evaluated into a new buffer instead, as
+                        this matrix may be one of its operands.
+                    */
+                    if (this->valid() && this->width() == expr.expression().width() && this->height() == expr.expression().height()) {
+                        this->assignExpression(expr.expression());
+                    }
+                    else {
+                        (*this) = Matrix<T>(expr);
+                    }
+                    return *this;
+                }
+
                 //Boolean logic overloads
                 inline bool operator== (const Matrix<T>& mat) const {
                     if (this->width() == mat.width() && this->height() == mat.height()) {
@@ -215,47 +354,27 @@ namespace bop {
                         Scalar multiplication member operator, multiplies all
                         elements by the given scalar.
                     */
-                    for (uint_type elem = 0; elem < this->height() * this->width(); elem++) {
-                        this->element(elem) *= scalar;
-                    }
+                    if (this->packed()) kernel::scal<T>(this->height() * this->width(), scalar, this->data);
+                    else MatrixView<T>(*this) *= scalar;
                     return *this;
                 }
 
                 Matrix<T>& operator*= (const Matrix<T>& mat) {
+                    return (*this) *= MatrixView<T>(mat);
+                }
+
+                Matrix<T>& operator*= (const MatrixView<T>& view) {
                     /*
-                        Naive matrix multiplication implementation
+                        Matrix multiplication, the product is computed by the
+                        packed and cache-blocked kernel for float and double
+                        matrices, and by a naive triple loop for other types.
+                        See MatrixKernels.hpp. The right hand side may be any
+                        view, including one into this matrix. If the view's
+                        height is not this matrix's width the matrix is left
+                        unchanged.
                     */
-                    #ifdef BOP_MATRIX_USE_RECYCLER
-                    T* temp = Matrix<T>::recycler.request(this->height() * mat.width());
-                    #else
-                    T* temp = new T[this->height() * mat.width()];
-                    #endif
-                    for (uint_type row = 0; row < this->height(); row++) {
-                        for (uint_type col = 0; col < mat.width(); col++) {
-                            temp[(row * mat.width()) + col] = 0;
-                            for (uint_type iter = 0; iter < mat.width(); iter++) {
-                                temp[(row * mat.width()) + col] += this->element(row,iter) * mat.element(iter,col);
-                            }
-                        }
-                    }
-                    /*
-                    //This method is actually slower, surprisingly.
-                    for (uint_type elem = 0; elem < mat.width() * this->height(); elem++) {
-                        //equation for col = elem % mat.width()
-                        //equation for row = (elem - col) / mat.width()
-                        temp[elem] = 0;
-                        for (uint_type iter = 0; iter < mat.width(); iter++) {
-                            temp[elem] += this->element((elem - (elem % mat.width())) / mat.width(), iter) * mat.element(iter, elem % mat.width());
-                        }
-                    }
-                    */
-                    #ifdef BOP_MATRIX_USE_RECYCLER
-                    Matrix<T>::recycler.give(this->data, this->width() * this->height());
-                    #else
-                    delete[] this->data;
-                    #endif
-                    this->data = temp;
-                    this->matrix_width = mat.matrix_width;
+                    if (view.height() != this->width()) return *this;
+                    this->assignProduct(MatrixView<T>(*this), view, this->padded() || pad_by_default);
                     return *this;
                 }
 
@@ -267,21 +386,9 @@ namespace bop {
                         multiplied is the vector. The matrix is unaffected.
                     */
                     if (vec.width == this->width()) {
-                        T* temp_data = new T[this->height()];
-                        for (uint_type i = 0; i < this->height(); i++) {
-                            T product = 0;
-                            for (uint_type dot_index = 0; dot_index < vec.size(); dot_index++) {
-                                product += vec[dot_index] * this->element(i,dot_index);
-                            }
-                            temp_data[i] = product;
-                            #ifdef BOP_MATRIX_MULTIPLY_DISCARD_TINY
-                            temp_data[i] += BOP_MATRIX_DISCARD_BY;
-                            temp_data[i] -= BOP_MATRIX_DISCARD_BY;
-                            #endif
-                        }
-                        delete[] vec.data;
-                        vec.data = temp_data;
-                        vec.width = this->height();
+                        Vector<T> vec_p(this->height());
+                        this->apply(vec, vec_p);
+                        vec = std::move(vec_p);
                     }
                     return vec;
                 }
@@ -302,16 +409,17 @@ namespace bop {
                         Addition member operator, adds all the elements of a
                         given matrix to the matrix.
                     */
-                    if (this->width() == mat.width() && this->height() == mat.height()) {
-                        for (uint_type elem = 0; elem < this->height() * this->width(); elem++) {
-                            this->element(elem) += mat.element(elem);
-                        }
+                    if (this->width() == mat.width() && this->height() == mat.height() && this->packed() && mat.packed()) {
+                        kernel::axpy<T>(this->height() * this->width(), T(1), mat.data, this->data);
                     }
                     else {
-                        for (uint_type row = 0; row < this->height(); row++) {
-                            for (uint_type col = 0; col < this->width(); col++) {
-                                this->element(row,col) += mat.element(row,col);
-                            }
+                        /*
+                            Padded or differently sized operands go row by row,
+                            the latter only combining over the region they share.
+                        */
+                        const uint_type cols = std::min(this->width(), mat.width());
+                        for (uint_type row = 0; row < this->height() && row < mat.height(); row++) {
+                            kernel::axpy<T>(cols, T(1), mat.data + (row * mat.stride()), this->data + (row * this->stride()));
                         }
                     }
                     return *this;
@@ -322,38 +430,172 @@ namespace bop {
                         Subtraction member operator, subtracts the value of
                         each element in a given matrix from the matrix.
                     */
-                    if (this->width() == mat.width() && this->height() == mat.height()) {
-                        for (uint_type elem = 0; elem < this->height() * this->width(); elem++) {
-                            this->element(elem) -= mat.element(elem);
-                        }
+                    if (this->width() == mat.width() && this->height() == mat.height() && this->packed() && mat.packed()) {
+                        kernel::axpy<T>(this->height() * this->width(), T(-1), mat.data, this->data);
                     }
                     else {
-                        for (uint_type row = 0; row < this->height(); row++) {
-                            for (uint_type col = 0; col < this->width(); col++) {
-                                this->element(row,col) -= mat.element(row,col);
-                            }
+                        /*
+                            Padded or differently sized operands go row by row,
+                            the latter only combining over the region they share.
+                        */
+                        const uint_type cols = std::min(this->width(), mat.width());
+                        for (uint_type row = 0; row < this->height() && row < mat.height(); row++) {
+                            kernel::axpy<T>(cols, T(-1), mat.data + (row * mat.stride()), this->data + (row * this->stride()));
                         }
                     }
                     return *this;
                 }
 
-                Matrix<T> operator- () {
+                Matrix<T>& operator+= (const MatrixView<T>& view) {
+                    MatrixView<T>(*this) += view;
+                    return *this;
+                }
+
+                Matrix<T>& operator-= (const MatrixView<T>& view) {
+                    MatrixView<T>(*this) -= view;
+                    return *this;
+                }
+
+                template<class E>
+                Matrix<T>& operator+= (const MatrixExpression<E>& expr) {
+                    /*
+                        Fused addition of an expression, no temporary matrix is
+                        made for the right hand side.
+                    */
+                    this->assignExpression(MatrixTerminal<T>(*this) + expr.expression());
+                    return *this;
+                }
+
+                template<class E>
+                Matrix<T>& operator-= (const MatrixExpression<E>& expr) {
+                    this->assignExpression(MatrixTerminal<T>(*this) - expr.expression());
+                    return *this;
+                }
+
+                Matrix<T> operator- () const & {
                     Matrix<T> mat(*this);
-                    for (uint_type elem = 0; elem < this->width() * this->height(); elem++) {
-                        mat.element(elem) *= -1;
-                    }
+                    mat *= T(-1);
                     return mat;
                 }
 
+                Matrix<T> operator- () && {
+                    /*
+                        Negates an expiring matrix in its own storage.
+                    */
+                    (*this) *= T(-1);
+                    return std::move(*this);
+                }
+
+            private:
+
+                template<class T_>
+                friend Matrix<T_> operator* (const Matrix<T_>& mat1, const Matrix<T_>& mat2);
+
+                inline void assignProduct(const MatrixView<T>& left, const MatrixView<T>& right, bool padded) {
+                    /*
+                        Replaces the contents of this matrix with the product
+                        of two views, either of which may refer to it.
+                    */
+                    Matrix<T> mat_p;
+                    mat_p.setData(right.width(), left.height(), false, padded);
+                    #ifdef BOP_MATRIX_USE_STRASSEN
+                    /*
+                        Large square products go through the Strassen-Winograd
+                        recursion when it is enabled.
+                    */
+                    if (left.square() && right.square() && right.width() == left.width() && left.width() >= kernel::strassenCrossover()) {
+                        kernel::gemmStrassen<T>(left.height(), right.width(), left.width(),
+                                                left.data(), left.stride(), right.data(), right.stride(),
+                                                mat_p.data, mat_p.stride());
+                    }
+                    else
+                    #endif
+                    if (right.width() == 1 && right.stride() == 1) {
+                        /*
+                            A contiguous single column is a matrix-vector
+                            product, which needs no packing.
+                        */
+                        kernel::gemv<T>(left.height(), left.width(), T(1), left.data(), left.stride(), right.data(), T(0), mat_p.data);
+                    }
+                    else kernel::gemm<T>(left.height(), right.width(), left.width(), T(1),
+                                    left.data(), left.stride(), 1,
+                                    right.data(), right.stride(), 1,
+                                    T(0), mat_p.data, mat_p.stride());
+                    this->swapStorage(mat_p);
+                }
+
+                template<class E>
+                inline void assignExpression(const E& expr) {
+                    /*
+                        Writes every element of an expression into the matrix,
+                        which must already have the expression's shape. Flat
+                        indexing is used unless an operand has a different
+                        shape or the rows are padded.
+                    */
+                    if (this->packed() && expr.conformant(this->width(), this->height())) {
+                        const uint_type size = this->width() * this->height();
+                        for (uint_type elem = 0; elem < size; elem++) this->data[elem] = static_cast<T>(expr.element(elem));
+                    }
+                    else {
+                        for (uint_type row = 0; row < this->height(); row++) {
+                            for (uint_type col = 0; col < this->width(); col++) {
+                                this->data[(row * this->stride()) + col] = static_cast<T>(expr.element(row,col));
+                            }
+                        }
+                    }
+                }
+
+            public:
+
                 //Information functions
 
                 inline T& element(uint_type row, uint_type col) const {
-                    if (row == 0) return this->data[col];
-                    else return this->data[(row * this->width()) + col];
+                    return this->data[(row * this->matrix_stride) + col];
                 }
 
                 inline T& element(uint_type elem) const {
-                    return this->data[elem];
+                    /*
+                        Element by its row-major position, ignoring any padding
+                        at the ends of the rows.
+                    */
+                    if (this->matrix_stride == this->matrix_width) return this->data[elem];
+                    else return this->data[((elem / this->matrix_width) * this->matrix_stride) + (elem % this->matrix_width)];
+                }
+
+                inline T* rowData(uint_type row) const {
+                    return this->data + (row * this->matrix_stride);
+                }
+
+                inline uint_type stride() const {
+                    /*
+                        The leading dimension, elements between the starts of
+                        consecutive rows. Equal to the width unless the rows
+                        are padded.
+                    */
+                    return this->matrix_stride;
+                }
+
+                inline bool packed() const {
+                    return (this->matrix_stride == this->matrix_width);
+                }
+
+                inline bool padded() const {
+                    return !this->packed();
+                }
+
+                inline MatrixAllocator* allocator() const {
+                    /*
+                        The allocator that owns the storage, or nullptr when
+                        there is none.
+                    */
+                    if (this->data == nullptr) return nullptr;
+                    return static_cast<MatrixAllocator*>(reinterpret_cast<void* const*>(this->data)[-2]);
+                }
+
+                Matrix<T>& fill(const T value) {
+                    if (this->packed()) std::fill(this->data, this->data + (this->width() * this->height()), value);
+                    else MatrixView<T>(*this).fill(value);
+                    return *this;
                 }
 
                 inline uint_type width() const {
@@ -428,6 +670,104 @@ namespace bop {
                     Matrix<T> upper;
                 };
 
+                LUDecomposition<T> factorize() const {
+                    /*
+                        Partially pivoted LU factorization of the matrix, which
+                        can be kept and reused for det(), inverse() and solve().
+                        Prefer this to decompose(), which does no pivoting.
+                    */
+                    return LUDecomposition<T>(*this);
+                }
+
+                CholeskyDecomposition<T> cholesky() const {
+                    /*
+                        Cholesky factorization of a symmetric positive definite
+                        matrix, from its lower triangle. Check
+                        positiveDefinite() on the result.
+                    */
+                    return CholeskyDecomposition<T>(*this);
+                }
+
+                QRDecomposition<T> qr() const {
+                    /*
+                        Householder QR factorization, for least squares
+                        problems and other systems too ill-conditioned for
+                        the normal equations.
+                    */
+                    return QRDecomposition<T>(*this);
+                }
+
+                BareissElimination<T> bareiss() const {
+                    /*
+                        Fraction-free elimination of an integer matrix, for its
+                        exact rank, determinant and reduced row echelon form.
+                    */
+                    return BareissElimination<T>(*this);
+                }
+
+                //Products written into storage the caller owns.
+
+                bool multiplyAdd(const MatrixView<T>& a, const MatrixView<T>& b, T alpha = T(1), T beta = T(1),
+                                 bool transpose_a = false, bool transpose_b = false) {
+                    /*
+                        this = alpha * op(a) * op(b) + beta * this in the
+                        matrix's own storage, see MatrixView::multiplyAdd. With
+                        the default alpha and beta the product is accumulated.
+                    */
+                    return MatrixView<T>(*this).multiplyAdd(a, b, alpha, beta, transpose_a, transpose_b);
+                }
+
+                void apply(const Vector<T>& vec, Vector<T>& out, T alpha = T(1), T beta = T(0)) const {
+                    /*
+                        out = alpha * (this * vec) + beta * out. out is only
+                        reallocated if it is not already height() long, so a
+                        matrix can be applied repeatedly without allocating.
+                        vec must be width() long and must not be out.
+                    */
+                    if (vec.size() != this->width() || &vec == &out) return;
+                    if (out.size() != this->height()) {
+                        out = Vector<T>(this->height());
+                        beta = T(0);
+                    }
+                    kernel::gemv<T>(this->height(), this->width(), alpha, this->data, this->stride(), vec.data, beta, out.data);
+                    #ifdef BOP_MATRIX_MULTIPLY_DISCARD_TINY
+                    for (uint_type i = 0; i < this->height(); i++) {
+                        out.data[i] += BOP_MATRIX_DISCARD_BY;
+                        out.data[i] -= BOP_MATRIX_DISCARD_BY;
+                    }
+                    #endif
+                }
+
+                void applyTransposed(const Vector<T>& vec, Vector<T>& out, T alpha = T(1), T beta = T(0)) const {
+                    /*
+                        out = alpha * (vec^T * this) + beta * out, the product
+                        with vec as a row vector on the left, without forming
+                        the transpose. vec must be height() long.
+                    */
+                    if (vec.size() != this->height() || &vec == &out) return;
+                    if (out.size() != this->width()) {
+                        out = Vector<T>(this->width());
+                        beta = T(0);
+                    }
+                    kernel::gevm<T>(this->height(), this->width(), alpha, vec.data, this->data, this->stride(), beta, out.data);
+                }
+
+                void applyBatch(const Matrix<T>& vectors, Matrix<T>& out) const {
+                    /*
+                        Applies the matrix to every row of vectors, each of
+                        which is one width() long vector, in a single sweep
+                        over the matrix. Row v of out is this * (row v of
+                        vectors). out is only reallocated if its shape does not
+                        match.
+                    */
+                    if (vectors.width() != this->width() || &vectors == &out) return;
+                    if (out.width() != this->height() || out.height() != vectors.height()) out = Matrix<T>(this->height(), vectors.height());
+                    kernel::gemvBatch<T>(this->height(), this->width(), vectors.height(), T(1),
+                                         this->data, this->stride(),
+                                         vectors.data, vectors.stride(),
+                                         T(0), out.data, out.stride());
+                }
+
                 LU decompose() const {
                     LU LU_pair;
 
@@ -463,6 +803,21 @@ namespace bop {
                     else if (this->width() == 2) {
                         return (this->element(0,0) * this->element(1,1)) - (this->element(0,1) * this->element(1,0));
                     }
+                    else if (std::is_integral<T>::value && std::is_signed<T>::value) {
+                        /*
+                            Exact fraction-free elimination, see
+                            BareissElimination.hpp. Matrices up to 4x4 are
+                            eliminated in a buffer on the stack.
+                        */
+                        const uint_type size = this->width();
+                        if (size <= 4) {
+                            T buffer[16];
+                            for (uint_type row = 0; row < size; row++) std::copy(this->rowData(row), this->rowData(row) + size, buffer + (row * size));
+                            return kernel::bareissDet(size, buffer, size);
+                        }
+                        Matrix<T> eliminated(*this);
+                        return kernel::bareissDet(size, eliminated.rowData(0), eliminated.stride());
+                    }
                     else if (this->width() < 5 && allow_recursive) {
                         /*
                             start and launch recursive determinant.
@@ -475,12 +830,19 @@ namespace bop {
                             if (this->element(0,i) != 0) {
                                 allowed_cols[i] = false;
                                 deter += (multi * (this->element(0,i) * this->detCascade(allowed_cols, size)));
-                                multi *= -1;
                                 allowed_cols[i] = true;
                             }
+                            multi *= -1;
                         }
                         return deter;
                     }
+                    else if (std::is_floating_point<T>::value) {
+                        /*
+                            The determinant is the signed product of the pivots of
+                            a partially pivoted LU factorization.
+                        */
+                        return this->factorize().det();
+                    }
                     else {
                         /*
                             As we are simply finding the product of the pivots
@@ -501,7 +863,7 @@ namespace bop {
                             }
                         }
                         T deter = 1;
-                        for (uint_type elem = 0; elem < this->height(); elem++) deter *= this->element(elem,elem);
+                        for (uint_type elem = 0; elem < this->height(); elem++) deter *= upper.element(elem,elem);
                         return deter;
                     }
                 }
@@ -526,6 +888,7 @@ namespace bop {
                         return (this->element(this->height() - 2,c1) * this->element(this->height() - 1,c2)) - (this->element(this->height() - 2,c2) * this->element(this->height() - 1,c1));
                     }
                     else {
+                        const uint_type row = this->height() - size;
                         size--;
                         T deter = 0;
                         T multi = 1;
@@ -533,7 +896,7 @@ namespace bop {
                             if (!allowed_cols[i]) continue;
                             else {
                                 allowed_cols[i] = false;
-                                deter += (multi * (this->element(this->height() - size,i) * this->detCascade(allowed_cols, size)));
+                                deter += (multi * (this->element(row,i) * this->detCascade(allowed_cols, size)));
                                 multi *= -1;
                                 allowed_cols[i] = true;
 
@@ -547,6 +910,15 @@ namespace bop {
             public:
 
                 Matrix<T>& invert() {
+                    if (std::is_floating_point<T>::value && this->square() && this->height() > 2) {
+                        /*
+                            Inverse by solving against the identity with an LU
+                            factorization, a singular matrix is left unchanged.
+                        */
+                        LUDecomposition<T> lu(*this);
+                        if (!lu.singular()) (*this) = lu.inverse();
+                        return *this;
+                    }
                     T deter = this->det();
                     if (deter != 0) {
                         if (this->height() == 2) {
@@ -618,38 +990,46 @@ namespace bop {
                                     }
                                 }
                             }
-                            std::swap(this->data, inverse.data);
+                            this->swapStorage(inverse);
                         }
                     }
                     return *this;
                 }
 
-                inline Matrix<T> inverted() const {
+                inline Matrix<T> inverted() const & {
                     return Matrix<T>(*this).invert();
                 }
 
+                inline Matrix<T> inverted() && {
+                    /*
+                        An expiring matrix is inverted in place and its
+                        storage handed on to the result.
+                    */
+                    return std::move(this->invert());
+                }
+
                 #ifdef BOP_MATRIX_ALLOW_INVERSE_METHOD
                 //macro-enabled method name alternative.
-                inline Matrix<T> inverse() const {return Matrix<T>(*this).invert();}
+                inline Matrix<T> inverse() const & {return Matrix<T>(*this).invert();}
+                inline Matrix<T> inverse() && {return std::move(this->invert());}
                 #endif
 
                 inline Matrix<T>& transpose() {
+                    /*
+                        Square matrices are transposed in place by swapping tiles
+                        across the diagonal. Others are written transposed into
+                        new storage, which measured several times faster than
+                        following the permutation cycles in place once the
+                        matrix leaves cache.
+                    */
                     if (this->width() == this->height()) {
-                        for (uint_type row = 0; row < this->height(); row++) {
-                            for (uint_type col = row + 1; col < this->width(); col++) {
-                                std::swap(this->element(row,col), this->element(col,row));
-                            }
-                        }
+                        kernel::transposeSquareInPlace(this->height(), this->data, this->stride());
                     }
                     else {
-                        Matrix<T> mat_transpose(this->height(),this->width());
-                        for (uint_type row = 0; row < this->height(); row++) {
-                            for (uint_type col = 0; col < this->width(); col++) {
-                                mat_transpose.element(col,row) = this->element(row,col);
-                            }
-                        }
-                        std::swap(this->data,mat_transpose.data);
-                        std::swap(this->matrix_width, this->matrix_height);
+                        Matrix<T> mat_transpose;
+                        mat_transpose.setData(this->height(), this->width(), false, this->padded() || pad_by_default);
+                        kernel::transposeCopy(this->height(), this->width(), this->data, this->stride(), mat_transpose.data, mat_transpose.stride());
+                        this->swapStorage(mat_transpose);
                     }
                     return *this;
                 }
@@ -657,8 +1037,23 @@ namespace bop {
                 const static uint_type rowvec = 1;
                 const static uint_type colvec = 2;
 
-                inline Matrix<T> transposed() const {
-                    return Matrix<T>(*this).transpose();
+                inline Matrix<T> transposed() const & {
+                    /*
+                        Written straight into the new matrix, without copying
+                        this one first.
+                    */
+                    Matrix<T> mat_transpose;
+                    mat_transpose.setData(this->height(), this->width(), false, this->padded() || pad_by_default);
+                    kernel::transposeCopy(this->height(), this->width(), this->data, this->stride(), mat_transpose.data, mat_transpose.stride());
+                    return mat_transpose;
+                }
+
+                inline Matrix<T> transposed() && {
+                    /*
+                        An expiring square matrix is transposed in its own
+                        storage, see transpose().
+                    */
+                    return std::move(this->transpose());
                 }
 
                 inline bool isVector() const {
@@ -675,6 +1070,24 @@ namespace bop {
                     else return false;
                 }
 
+                //Views, none of which copy or allocate.
+
+                inline MatrixView<T> view() const {
+                    return MatrixView<T>(*this);
+                }
+
+                inline MatrixView<T> row(uint_type index) const {
+                    return this->view().row(index);
+                }
+
+                inline MatrixView<T> column(uint_type index) const {
+                    return this->view().column(index);
+                }
+
+                inline MatrixView<T> block(uint_type row_off, uint_type col_off, uint_type width, uint_type height) const {
+                    return this->view().block(row_off, col_off, width, height);
+                }
+
                 //Matrix manipulation functions.
 
                 inline void swapRows(uint_type index_a, uint_type index_b) {
@@ -704,50 +1117,50 @@ namespace bop {
                 }
         };
 
-        #ifdef BOP_MATRIX_USE_RECYCLER
-        template<class T>
-        mem::PrimativeArrayRecycler<T> Matrix<T>::recycler = mem::PrimativeArrayRecycler<T>();
-        #endif
         typedef Matrix<prec_type> matrix;
 
-        //External arithmetic overloads
-
-        template<class T>
-        Matrix<T> operator* (Matrix<T>& mat, const T scalar) {
-            Matrix<T> mat_p(mat);
-            mat_p *= scalar;
-            return mat_p;
-        }
+        //External arithmetic overloads, the element-wise ones live in MatrixExpression.hpp
 
         template<class T>
         Matrix<T> operator* (const Matrix<T>& mat1, const Matrix<T>& mat2) {
-            Matrix<T> mat_p(mat1);
-            mat_p *= mat2;
+            /*
+                The product is written straight into the result, neither
+                operand is copied. If mat2's height is not mat1's width,
+                mat1 is returned unchanged.
+            */
+            if (mat2.height() != mat1.width()) return mat1;
+            Matrix<T> mat_p;
+            mat_p.assignProduct(MatrixView<T>(mat1), MatrixView<T>(mat2), mat1.padded() || Matrix<T>::pad_by_default);
             return mat_p;
         }
 
         template<class T>
-        Vector<T> operator* (const Matrix<T>& mat, Vector<T>& vec) {
-            Vector<T> vec_p(vec);
-            mat *= vec_p;
-            return vec_p;
-        }
-
-        template<class T>
-        Matrix<T> operator/ (const Matrix<T>& mat, const T scalar) {
-            Matrix<T> mat_p(mat);
-            mat_p /= scalar;
+        Matrix<T> strassenMultiply(const Matrix<T>& mat1, const Matrix<T>& mat2, uint_type crossover = kernel::strassenCrossover()) {
+            /*
+                Product of two matrices by the Strassen-Winograd recursion,
+                asymptotically faster than mat1 * mat2 for very large
+                matrices. See kernel::gemmStrassen. As with operator*, mat1
+                is returned unchanged if the shapes do not conform.
+            */
+            if (mat2.height() != mat1.width()) return mat1;
+            Matrix<T> mat_p(mat2.width(), mat1.height());
+            kernel::gemmStrassen<T>(mat1.height(), mat2.width(), mat1.width(),
+                                    mat1.rowData(0), mat1.stride(), mat2.rowData(0), mat2.stride(),
+                                    mat_p.rowData(0), mat_p.stride(), crossover);
             return mat_p;
         }
 
         template<class T>
-        Matrix<T> operator+ (const Matrix<T>& mat1, const Matrix<T>& mat2) {
-            return Matrix<T>(mat1) += mat2;
-        }
-
-        template<class T>
-        Matrix<T> operator- (const Matrix<T>& mat1, const Matrix<T>& mat2) {
-            return Matrix<T>(mat1) -= mat2;
+        Vector<T> operator* (const Matrix<T>& mat, const Vector<T>& vec) {
+            /*
+                The product goes straight into the result through the GEMV
+                kernel. If vec does not have mat.width() elements it is
+                returned unchanged, as by Matrix::operator*=(Vector<T>&).
+            */
+            if (vec.size() != mat.width()) return vec;
+            Vector<T> vec_p(mat.height());
+            mat.apply(vec, vec_p);
+            return vec_p;
         }
 
         template<class T>
@@ -760,12 +1173,19 @@ namespace bop {
         template<class T>
         struct IdentityMatrix {
             /*
-                Identity matrix factory
+                Identity matrix factory. Products and sums only need
+                implicit(), which holds no elements at all.
             */
+            typedef typename MatrixCache<uint_type,T>::handle_type handle;
+
             static Matrix<T> make(uint_type size) {
                 return make(size,size);
             }
 
+            static inline ScaledIdentity<T> implicit(uint_type size, T scale = T(1)) {
+                return ScaledIdentity<T>(size, scale);
+            }
+
             static uint_type encodeMatrixDimentions(uint_type width, uint_type height) {
                 /*
                     If the matrix is of a reasonable size, then the
@@ -789,17 +1209,32 @@ namespace bop {
             }
 
             static Matrix<T> make(uint_type width, uint_type height) {
-                static std::unordered_map<uint_type,Matrix<T> > map;
+                /*
+                    Filled in place rather than copied out of a cache, as a
+                    copy of a cached matrix costs as much as filling it.
+                */
+                Matrix<T> mat(width,height);
+                for (uint_type elem = 0; elem < std::min(width,height); elem++) mat.element(elem,elem) = 1;
+                return mat;
+            }
+
+            static MatrixCache<uint_type,T>& cache() {
+                static MatrixCache<uint_type,T> identities(16);
+                return identities;
+            }
+
+            static handle shared(uint_type width, uint_type height) {
+                /*
+                    A shared, immutable identity matrix from cache().
+                    Dimensions too large to encode are not cached.
+                */
                 uint_type size_pair = encodeMatrixDimentions(width,height);
-                if (map[size_pair]) return map[size_pair];
-                else {
-                    map[size_pair] = Matrix<T>(width,height);
-                    for (uint_type elem = 0; elem < width * height; elem += width + 1) {
-                        map[size_pair].element(elem) = 1;
-                    }
-                    return map[size_pair];
-                }
+                if (size_pair == 0) return std::make_shared< const Matrix<T> >(make(width,height));
+                return cache().get(size_pair, [width,height]() { return make(width,height); });
+            }
 
+            static inline handle shared(uint_type size) {
+                return shared(size,size);
             }
         };
 
@@ -808,23 +1243,43 @@ namespace bop {
             /*
                 Rotation matrix factory.
             */
-            static Matrix<T> make(T angle, bool clockwise = false, bool rads = false) {
-                static std::unordered_map<T,Matrix<T> > map;
+            typedef typename MatrixCache<T,T>::handle_type handle;
+
+            static MatrixCache<T,T>& cache() {
+                /*
+                    Keyed by the angle in radians. Angles from continuous
+                    motion rarely repeat, so the cache is bounded to keep
+                    them from piling up.
+                */
+                static MatrixCache<T,T> rotations(256);
+                return rotations;
+            }
+
+            static handle shared(T angle, bool clockwise = false, bool rads = false) {
+                /*
+                    A shared, immutable rotation matrix from cache(). A NaN
+                    key never finds itself, so non-finite angles are built
+                    without being cached.
+                */
                 if (clockwise) angle -= 180;
                 if (!rads) angle = ((pi/180.0) * angle); //Convert the degrees to radians manually
-                if (map[angle]) return map[angle];
-                else {
-                    map[angle] = {{static_cast<T>(cos(angle)), static_cast<T>(-sin(angle))},
-                                  {static_cast<T>(sin(angle)), static_cast<T>(cos(angle))}};
-                    return map[angle];
-                }
+                auto build = [angle]() -> Matrix<T> {
+                    return {{static_cast<T>(cos(angle)), static_cast<T>(-sin(angle))},
+                            {static_cast<T>(sin(angle)), static_cast<T>(cos(angle))}};
+                };
+                if (!std::isfinite(angle)) return std::make_shared< const Matrix<T> >(build());
+                return cache().get(angle, build);
+            }
+
+            static Matrix<T> make(T angle, bool clockwise = false, bool rads = false) {
+                return *shared(angle, clockwise, rads);
             }
         };
         struct OffsetMatrix {
             /*
-                Offset matrix factory. returns a constant matrix reference that
-                represents the index offset in the one-dimentional array representation
-                of the matrix during transposition.
+                Offset matrix factory. returns a matrix that represents the
+                index offset in the one-dimentional array representation of
+                the matrix during transposition.
             */
             static inline int_type offset(uint_type width, uint_type height, uint_type row, uint_type col) {
                 /*
@@ -841,25 +1296,45 @@ namespace bop {
                 return index % width;
             }
 
-            template<class T>
-            static const Matrix<int_type>& make(const Matrix<T>& matrix) {
-                return OffsetMatrix::make(matrix.width(),matrix.height());
+            typedef MatrixCache<uint_type,int_type>::handle_type handle;
+
+            static MatrixCache<uint_type,int_type>& cache() {
+                static MatrixCache<uint_type,int_type> offsets(16);
+                return offsets;
             }
 
-            static const Matrix<int_type>& make(uint_type width, uint_type height) {
-                static std::map<uint_type,Matrix<int_type> > map;
-                uint_type encoded = IdentityMatrix<uint_type>::encodeMatrixDimentions(width,height);
-                if (map[encoded]) return map[encoded];
-                else {
-                    Matrix<int_type> mat = Matrix<int_type>(width,height);
-                    for (uint_type row = 0; row < mat.height(); row++) {
-                        for (uint_type col = 0; col < mat.width(); col++) {
-                            mat[row][col] = OffsetMatrix::offset(width,height,row,col);
-                        }
+            static Matrix<int_type> build(uint_type width, uint_type height) {
+                Matrix<int_type> mat = Matrix<int_type>(width,height);
+                for (uint_type row = 0; row < mat.height(); row++) {
+                    for (uint_type col = 0; col < mat.width(); col++) {
+                        mat.element(row,col) = OffsetMatrix::offset(width,height,row,col);
                     }
-                    map[encoded] = mat;
-                    return map[encoded];
                 }
+                return mat;
+            }
+
+            static handle shared(uint_type width, uint_type height) {
+                /*
+                    A shared, immutable offset matrix from cache(), which
+                    stays valid after it has been evicted.
+                */
+                uint_type encoded = IdentityMatrix<uint_type>::encodeMatrixDimentions(width,height);
+                if (encoded == 0) return std::make_shared< const Matrix<int_type> >(OffsetMatrix::build(width,height));
+                return cache().get(encoded, [width,height]() { return OffsetMatrix::build(width,height); });
+            }
+
+            template<class T>
+            static inline handle shared(const Matrix<T>& matrix) {
+                return OffsetMatrix::shared(matrix.width(),matrix.height());
+            }
+
+            static inline Matrix<int_type> make(uint_type width, uint_type height) {
+                return *OffsetMatrix::shared(width,height);
+            }
+
+            template<class T>
+            static inline Matrix<int_type> make(const Matrix<T>& matrix) {
+                return OffsetMatrix::make(matrix.width(),matrix.height());
             }
         };
 
@@ -0,0 +1,318 @@
+#ifndef BOP_MATRIX_ALLOCATOR_HPP
+#define BOP_MATRIX_ALLOCATOR_HPP
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "../bop-defaults/types.hpp"
+#include "../bop-memory/Recycler.hpp"
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+    bop::maths::MatrixAllocator class file
+
+    Where Matrix storage comes from. Every allocation a Matrix makes goes
+    to the allocator active on the calling thread: the process-wide
+    default (the heap, or the recycler when BOP_MATRIX_USE_RECYCLER is
+    defined) unless a MatrixAllocatorScope has selected another one. The
+    allocator is recorded with each block, so storage always goes back to
+    the allocator it came from, and matrices from different allocators mix
+    freely. Matrix<T> itself is unchanged, only the blocks behind it
+    differ.
+
+    Allocators hand out unaligned blocks with malloc's alignment, Matrix
+    aligns its storage within them. An allocator must outlive every
+    matrix whose storage it provided.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        class MatrixAllocator {
+            public:
+                virtual ~MatrixAllocator() {
+                }
+
+                virtual void* allocate(std::size_t bytes) = 0;
+                virtual void release(void* block, std::size_t bytes) = 0;
+
+                static MatrixAllocator& heap();
+                static MatrixAllocator& recycling();
+
+                static MatrixAllocator& standard() {
+                    /*
+                        The process-wide default, used by threads with no
+                        MatrixAllocatorScope open.
+                    */
+                    return *MatrixAllocator::defaultSlot().load(std::memory_order_acquire);
+                }
+
+                static void setStandard(MatrixAllocator& allocator) {
+                    MatrixAllocator::defaultSlot().store(&allocator, std::memory_order_release);
+                }
+
+                static MatrixAllocator& active() {
+                    MatrixAllocator* selected = MatrixAllocator::threadSlot();
+                    return (selected != nullptr) ? *selected : MatrixAllocator::standard();
+                }
+
+            protected:
+                friend class MatrixAllocatorScope;
+
+                static std::atomic<MatrixAllocator*>& defaultSlot() {
+                    #ifdef BOP_MATRIX_USE_RECYCLER
+                    static std::atomic<MatrixAllocator*> slot(&MatrixAllocator::recycling());
+                    #else
+                    static std::atomic<MatrixAllocator*> slot(&MatrixAllocator::heap());
+                    #endif
+                    return slot;
+                }
+
+                static MatrixAllocator*& threadSlot() {
+                    static thread_local MatrixAllocator* slot = nullptr;
+                    return slot;
+                }
+        };
+
+        class MatrixAllocatorScope {
+            /*
+                Makes an allocator active on this thread for the lifetime of
+                the scope, restoring the previous one after. Scopes nest.
+            */
+            private:
+                MatrixAllocator* previous;
+            public:
+                MatrixAllocatorScope(MatrixAllocator& allocator) : previous(MatrixAllocator::threadSlot()) {
+                    MatrixAllocator::threadSlot() = &allocator;
+                }
+
+                MatrixAllocatorScope(const MatrixAllocatorScope&) = delete;
+                MatrixAllocatorScope& operator= (const MatrixAllocatorScope&) = delete;
+
+                ~MatrixAllocatorScope() {
+                    MatrixAllocator::threadSlot() = this->previous;
+                }
+        };
+
+        class HeapMatrixAllocator : public MatrixAllocator {
+            /*
+                malloc and free, the default.
+            */
+            public:
+                void* allocate(std::size_t bytes) override {
+                    return malloc(bytes);
+                }
+
+                void release(void* block, std::size_t) override {
+                    free(block);
+                }
+        };
+
+        class RecyclingMatrixAllocator : public MatrixAllocator {
+            /*
+                Keeps released blocks to hand out again for requests of the
+                same size, through bop::mem::PrimativeArrayRecycler. Suits
+                code that makes and drops matrices of a few shapes over and
+                over. Blocks are only freed when the allocator is destroyed.
+            */
+            protected:
+                mem::PrimativeArrayRecycler<unsigned char> recycler;
+                std::mutex recycler_mutex;
+            public:
+                void* allocate(std::size_t bytes) override {
+                    std::lock_guard<std::mutex> lock(this->recycler_mutex);
+                    return this->recycler.request(bytes);
+                }
+
+                void release(void* block, std::size_t bytes) override {
+                    std::lock_guard<std::mutex> lock(this->recycler_mutex);
+                    this->recycler.give(static_cast<unsigned char*>(block), bytes);
+                }
+
+                void reserve(std::size_t bytes, uint_type count) {
+                    std::lock_guard<std::mutex> lock(this->recycler_mutex);
+                    this->recycler.reserve(bytes, count);
+                }
+        };
+
+        class ArenaMatrixAllocator : public MatrixAllocator {
+            /*
+                Bump allocation from large chunks. Releasing the most
+                recent block gives its space back, so short-lived
+                temporaries are reused in place, other releases wait for
+                reset(). Suits a phase of work whose matrices all die
+                together: a frame, a request or a solver iteration.
+            */
+            protected:
+                struct Chunk {
+                    unsigned char* memory;
+                    std::size_t size;
+                };
+
+                static const std::size_t granule = alignof(std::max_align_t);
+
+                std::vector<Chunk> chunks;
+                std::size_t chunk_size;
+                std::size_t current;
+                std::size_t offset;
+                std::size_t in_use;
+                std::mutex arena_mutex;
+
+                static inline std::size_t roundUp(std::size_t bytes) {
+                    return ((bytes + granule - 1) / granule) * granule;
+                }
+
+            public:
+                ArenaMatrixAllocator(std::size_t chunk_bytes = std::size_t(1) << 22) :
+                    chunk_size(chunk_bytes), current(0), offset(0), in_use(0) {
+                }
+
+                ArenaMatrixAllocator(const ArenaMatrixAllocator&) = delete;
+                ArenaMatrixAllocator& operator= (const ArenaMatrixAllocator&) = delete;
+
+                ~ArenaMatrixAllocator() {
+                    for (Chunk& chunk : this->chunks) free(chunk.memory);
+                }
+
+                void* allocate(std::size_t bytes) override {
+                    std::lock_guard<std::mutex> lock(this->arena_mutex);
+                    bytes = ArenaMatrixAllocator::roundUp(bytes);
+                    while (this->current < this->chunks.size() && this->offset + bytes > this->chunks[this->current].size) {
+                        this->current++;
+                        this->offset = 0;
+                    }
+                    if (this->current == this->chunks.size()) {
+                        Chunk chunk;
+                        chunk.size = std::max(this->chunk_size, bytes);
+                        chunk.memory = static_cast<unsigned char*>(malloc(chunk.size));
+                        if (chunk.memory == nullptr) return nullptr;
+                        this->chunks.push_back(chunk);
+                        this->offset = 0;
+                    }
+                    void* block = this->chunks[this->current].memory + this->offset;
+                    this->offset += bytes;
+                    this->in_use += bytes;
+                    return block;
+                }
+
+                void release(void* block, std::size_t bytes) override {
+                    std::lock_guard<std::mutex> lock(this->arena_mutex);
+                    bytes = ArenaMatrixAllocator::roundUp(bytes);
+                    this->in_use -= bytes;
+                    if (this->current < this->chunks.size() && bytes <= this->offset &&
+                        static_cast<unsigned char*>(block) == this->chunks[this->current].memory + this->offset - bytes) {
+                        this->offset -= bytes;
+                    }
+                }
+
+                void reset() {
+                    /*
+                        Makes all of the arena free again, keeping its chunks.
+                        No matrix from the arena may be in use.
+                    */
+                    std::lock_guard<std::mutex> lock(this->arena_mutex);
+                    this->current = 0;
+                    this->offset = 0;
+                    this->in_use = 0;
+                }
+
+                std::size_t used() {
+                    /*
+                        Bytes handed out and not yet released.
+                    */
+                    std::lock_guard<std::mutex> lock(this->arena_mutex);
+                    return this->in_use;
+                }
+
+                std::size_t reserved() {
+                    std::lock_guard<std::mutex> lock(this->arena_mutex);
+                    std::size_t total = 0;
+                    for (const Chunk& chunk : this->chunks) total += chunk.size;
+                    return total;
+                }
+        };
+
+        class HugePageMatrixAllocator : public MatrixAllocator {
+            /*
+                Maps blocks of at least threshold bytes starting on a 2MiB
+                boundary and asks the kernel to back them with transparent
+                huge pages, cutting TLB misses when large matrices are
+                streamed through. mmap only aligns to the base page, so one
+                huge page more than needed is mapped and the ends trimmed
+                off; the length is kept to whole base pages, and any tail
+                past the last whole huge page stays in base pages. Smaller
+                blocks, and every block off Linux, come from the heap.
+            */
+            protected:
+                std::size_t threshold;
+
+                #if defined(__linux__)
+                static inline std::size_t mappedBytes(std::size_t bytes) {
+                    const std::size_t base_page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+                    return ((bytes + base_page - 1) / base_page) * base_page;
+                }
+                #endif
+
+            public:
+                static const std::size_t page_size = std::size_t(1) << 21;
+
+                HugePageMatrixAllocator(std::size_t threshold_bytes = page_size) : threshold(threshold_bytes) {
+                }
+
+                void* allocate(std::size_t bytes) override {
+                    #if defined(__linux__)
+                    if (bytes >= this->threshold) {
+                        const std::size_t length = HugePageMatrixAllocator::mappedBytes(bytes);
+                        void* mapping = mmap(nullptr, length + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                        if (mapping == MAP_FAILED) return nullptr;
+                        unsigned char* start = static_cast<unsigned char*>(mapping);
+                        unsigned char* block = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(start) + page_size - 1) & ~uintptr_t(page_size - 1));
+                        if (block != start) munmap(start, block - start);
+                        if (block + length != start + length + page_size) munmap(block + length, (start + length + page_size) - (block + length));
+                        #ifdef MADV_HUGEPAGE
+                        madvise(block, length, MADV_HUGEPAGE);
+                        #endif
+                        return block;
+                    }
+                    #endif
+                    return malloc(bytes);
+                }
+
+                void release(void* block, std::size_t bytes) override {
+                    #if defined(__linux__)
+                    if (bytes >= this->threshold) {
+                        munmap(block, HugePageMatrixAllocator::mappedBytes(bytes));
+                        return;
+                    }
+                    #endif
+                    free(block);
+                }
+        };
+
+        inline MatrixAllocator& MatrixAllocator::heap() {
+            /*
+                Never destroyed, so matrices with static storage can still
+                release to it at exit.
+            */
+            static MatrixAllocator* allocator = new HeapMatrixAllocator();
+            return *allocator;
+        }
+
+        inline MatrixAllocator& MatrixAllocator::recycling() {
+            static MatrixAllocator* allocator = new RecyclingMatrixAllocator();
+            return *allocator;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,544 @@
+#ifndef BOP_MATRIX_BATCH_HPP
+#define BOP_MATRIX_BATCH_HPP
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "../bop-defaults/types.hpp"
+#include "../bop-utility/ThreadPool.hpp"
+#include "SIMD.hpp"
+#include "FixedMatrix.hpp"
+#include "MatrixParallel.hpp"
+
+/*
+    bop::maths::MatrixBatch class file
+
+    A batch of N same-shaped R by C matrices stored structure-of-arrays:
+    element (row, col) of every matrix in the batch is contiguous, one
+    plane per element. The batched kernels then load one element of a
+    run of consecutive matrices into a single vector register, so each
+    SIMD lane works on its own matrix and the arithmetic is exactly the
+    scalar arithmetic of FixedMatrix, lane by lane. A batch of vectors is
+    a MatrixBatch with one column.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            template<class T, uint_type Bytes, bool Vectorised = (std::is_same<T,float>::value || std::is_same<T,double>::value)>
+            struct BatchPack {
+                /*
+                    The matrices processed together by one vector register of
+                    Bytes bytes, a single matrix for types without a vector
+                    form.
+                */
+                static const uint_type lanes = 1;
+                typedef T type;
+
+                BOP_SIMD_INLINE static inline void load(type& pack, const T* src) {
+                    pack = *src;
+                }
+
+                BOP_SIMD_INLINE static inline void store(T* dst, const type& pack) {
+                    *dst = pack;
+                }
+            };
+
+            #if (defined(__GNUC__) || defined(__clang__)) && !defined(BOP_SIMD_DISABLE)
+            template<class T, uint_type Bytes>
+            struct BatchPack<T,Bytes,true> {
+                /*
+                    float and double use the compiler's vector extensions, so
+                    the same kernel source is compiled for each vector width.
+                */
+                static const uint_type lanes = Bytes / sizeof(T);
+                typedef T type __attribute__((vector_size(Bytes)));
+                typedef T unaligned __attribute__((vector_size(Bytes), aligned(sizeof(T)), may_alias));
+
+                BOP_SIMD_INLINE static inline void load(type& pack, const T* src) {
+                    pack = *reinterpret_cast<const unaligned*>(src);
+                }
+
+                BOP_SIMD_INLINE static inline void store(T* dst, const type& pack) {
+                    *reinterpret_cast<unaligned*>(dst) = pack;
+                }
+            };
+            #endif
+
+            template<class T>
+            struct BatchGroup {
+                /*
+                    Matrices in the widest pack, batches are stored in whole
+                    groups so that every vector width divides them.
+                */
+                static const uint_type matrices = BatchPack<T,64>::lanes;
+            };
+
+            template<class P, uint_type N>
+            struct BatchSquareOps;
+
+            /*
+                Closed form determinants and adjugates on packs of matrices,
+                the same expressions as FixedMatrixSquareOps so that results
+                agree with FixedMatrix exactly. Results are written through
+                references rather than returned, wide vectors are not passed
+                by value.
+            */
+            template<class P>
+            struct BatchSquareOps<P,1> {
+                BOP_SIMD_INLINE static inline void det(const P* m, P& deter) {
+                    deter = m[0];
+                }
+
+                BOP_SIMD_INLINE static inline void adjugate(const P* m, P* adj) {
+                    adj[0] = P() + 1;
+                }
+            };
+
+            template<class P>
+            struct BatchSquareOps<P,2> {
+                BOP_SIMD_INLINE static inline void det(const P* m, P& deter) {
+                    deter = (m[0] * m[3]) - (m[1] * m[2]);
+                }
+
+                BOP_SIMD_INLINE static inline void adjugate(const P* m, P* adj) {
+                    adj[0] = m[3];
+                    adj[1] = -m[1];
+                    adj[2] = -m[2];
+                    adj[3] = m[0];
+                }
+            };
+
+            template<class P>
+            struct BatchSquareOps<P,3> {
+                BOP_SIMD_INLINE static inline void det(const P* m, P& deter) {
+                    deter = m[0] * ((m[4] * m[8]) - (m[5] * m[7]))
+                          - m[1] * ((m[3] * m[8]) - (m[5] * m[6]))
+                          + m[2] * ((m[3] * m[7]) - (m[4] * m[6]));
+                }
+
+                BOP_SIMD_INLINE static inline void adjugate(const P* s, P* adj) {
+                    adj[0] = (s[4] * s[8]) - (s[5] * s[7]);
+                    adj[1] = (s[2] * s[7]) - (s[1] * s[8]);
+                    adj[2] = (s[1] * s[5]) - (s[2] * s[4]);
+                    adj[3] = (s[5] * s[6]) - (s[3] * s[8]);
+                    adj[4] = (s[0] * s[8]) - (s[2] * s[6]);
+                    adj[5] = (s[2] * s[3]) - (s[0] * s[5]);
+                    adj[6] = (s[3] * s[7]) - (s[4] * s[6]);
+                    adj[7] = (s[1] * s[6]) - (s[0] * s[7]);
+                    adj[8] = (s[0] * s[4]) - (s[1] * s[3]);
+                }
+            };
+
+            template<class P>
+            struct BatchSquareOps<P,4> {
+                struct Minors {
+                    P s0, s1, s2, s3, s4, s5;
+                    P c0, c1, c2, c3, c4, c5;
+
+                    BOP_SIMD_INLINE Minors(const P* m) {
+                        s0 = (m[0] * m[5]) - (m[4] * m[1]);
+                        s1 = (m[0] * m[6]) - (m[4] * m[2]);
+                        s2 = (m[0] * m[7]) - (m[4] * m[3]);
+                        s3 = (m[1] * m[6]) - (m[5] * m[2]);
+                        s4 = (m[1] * m[7]) - (m[5] * m[3]);
+                        s5 = (m[2] * m[7]) - (m[6] * m[3]);
+                        c5 = (m[10] * m[15]) - (m[14] * m[11]);
+                        c4 = (m[9] * m[15]) - (m[13] * m[11]);
+                        c3 = (m[9] * m[14]) - (m[13] * m[10]);
+                        c2 = (m[8] * m[15]) - (m[12] * m[11]);
+                        c1 = (m[8] * m[14]) - (m[12] * m[10]);
+                        c0 = (m[8] * m[13]) - (m[12] * m[9]);
+                    }
+
+                    BOP_SIMD_INLINE inline void det(P& deter) const {
+                        deter = (s0 * c5) - (s1 * c4) + (s2 * c3) + (s3 * c2) - (s4 * c1) + (s5 * c0);
+                    }
+                };
+
+                BOP_SIMD_INLINE static inline void det(const P* m, P& deter) {
+                    Minors(m).det(deter);
+                }
+
+                BOP_SIMD_INLINE static inline void adjugate(const P* a, P* adj) {
+                    const Minors x(a);
+                    adj[0]  = ( a[5] * x.c5 - a[6] * x.c4 + a[7] * x.c3);
+                    adj[1]  = (-a[1] * x.c5 + a[2] * x.c4 - a[3] * x.c3);
+                    adj[2]  = ( a[13] * x.s5 - a[14] * x.s4 + a[15] * x.s3);
+                    adj[3]  = (-a[9] * x.s5 + a[10] * x.s4 - a[11] * x.s3);
+                    adj[4]  = (-a[4] * x.c5 + a[6] * x.c2 - a[7] * x.c1);
+                    adj[5]  = ( a[0] * x.c5 - a[2] * x.c2 + a[3] * x.c1);
+                    adj[6]  = (-a[12] * x.s5 + a[14] * x.s2 - a[15] * x.s1);
+                    adj[7]  = ( a[8] * x.s5 - a[10] * x.s2 + a[11] * x.s1);
+                    adj[8]  = ( a[4] * x.c4 - a[5] * x.c2 + a[7] * x.c0);
+                    adj[9]  = (-a[0] * x.c4 + a[1] * x.c2 - a[3] * x.c0);
+                    adj[10] = ( a[12] * x.s4 - a[13] * x.s2 + a[15] * x.s0);
+                    adj[11] = (-a[8] * x.s4 + a[9] * x.s2 - a[11] * x.s0);
+                    adj[12] = (-a[4] * x.c3 + a[5] * x.c1 - a[6] * x.c0);
+                    adj[13] = ( a[0] * x.c3 - a[1] * x.c1 + a[2] * x.c0);
+                    adj[14] = (-a[12] * x.s3 + a[13] * x.s1 - a[14] * x.s0);
+                    adj[15] = ( a[8] * x.s3 - a[9] * x.s1 + a[10] * x.s0);
+                }
+            };
+
+            /*
+                Kernels over the group of matrices starting at index base, each
+                operand given as its first plane and the distance ld between
+                planes. group<Bytes>(base) processes one pack of Bytes bytes.
+            */
+
+            template<class T, uint_type R, uint_type K, uint_type C>
+            struct BatchMultiplyKernel {
+                const T* a;
+                uint_type lda;
+                const T* b;
+                uint_type ldb;
+                T* c;
+                uint_type ldc;
+
+                template<uint_type Bytes>
+                BOP_SIMD_INLINE inline void group(uint_type base) const {
+                    typedef BatchPack<T,Bytes> pack;
+                    typename pack::type a_elems[R * K], b_elems[K * C];
+                    for (uint_type elem = 0; elem < R * K; elem++) pack::load(a_elems[elem], this->a + (elem * this->lda) + base);
+                    for (uint_type elem = 0; elem < K * C; elem++) pack::load(b_elems[elem], this->b + (elem * this->ldb) + base);
+                    for (uint_type row = 0; row < R; row++) {
+                        for (uint_type col = 0; col < C; col++) {
+                            typename pack::type sum = a_elems[row * K] * b_elems[col];
+                            for (uint_type iter = 1; iter < K; iter++) sum += a_elems[(row * K) + iter] * b_elems[(iter * C) + col];
+                            pack::store(this->c + (((row * C) + col) * this->ldc) + base, sum);
+                        }
+                    }
+                }
+            };
+
+            template<class T, uint_type N>
+            struct BatchDetKernel {
+                const T* a;
+                uint_type lda;
+                T* dets;
+
+                template<uint_type Bytes>
+                BOP_SIMD_INLINE inline void group(uint_type base) const {
+                    typedef BatchPack<T,Bytes> pack;
+                    typename pack::type elems[N * N], deter;
+                    for (uint_type elem = 0; elem < N * N; elem++) pack::load(elems[elem], this->a + (elem * this->lda) + base);
+                    BatchSquareOps<typename pack::type, N>::det(elems, deter);
+                    pack::store(this->dets + base, deter);
+                }
+            };
+
+            template<class T, uint_type N>
+            struct BatchInvertKernel {
+                T* a;
+                uint_type lda;
+                T* dets;
+
+                template<uint_type Bytes>
+                BOP_SIMD_INLINE inline void group(uint_type base) const {
+                    /*
+                        Adjugate over determinant. Lanes holding a singular
+                        matrix keep their matrix, like FixedMatrix::invert().
+                    */
+                    typedef BatchPack<T,Bytes> pack;
+                    typename pack::type elems[N * N], adj[N * N], deter;
+                    for (uint_type elem = 0; elem < N * N; elem++) pack::load(elems[elem], this->a + (elem * this->lda) + base);
+                    BatchSquareOps<typename pack::type, N>::det(elems, deter);
+                    BatchSquareOps<typename pack::type, N>::adjugate(elems, adj);
+                    const typename pack::type inv = T(1) / deter;
+                    for (uint_type elem = 0; elem < N * N; elem++) {
+                        pack::store(this->a + (elem * this->lda) + base, (deter == 0) ? elems[elem] : adj[elem] * inv);
+                    }
+                    pack::store(this->dets + base, deter);
+                }
+            };
+
+            struct BatchParallelThreshold {
+                /*
+                    Matrices below which a batch is not split across a pool.
+                */
+                static const uint_type matrices = 1 << 13;
+            };
+
+            template<class T, uint_type Bytes, class F>
+            BOP_SIMD_INLINE inline void batchRange(uint_type begin, uint_type end, const F& kernel) {
+                const uint_type step = BatchPack<T,Bytes>::lanes;
+                for (uint_type base = begin; base < end; base += step) kernel.template group<Bytes>(base);
+            }
+
+            #ifdef BOP_SIMD_X86
+            /*
+                The same loop compiled for wider vector units, with the
+                kernel inlined into it.
+            */
+            template<class T, class F>
+            BOP_SIMD_TARGET("avx2") void batchRangeAVX2(uint_type begin, uint_type end, const F& kernel) {
+                batchRange<T,32>(begin, end, kernel);
+            }
+
+            template<class T, class F>
+            BOP_SIMD_TARGET("avx512f") void batchRangeAVX512(uint_type begin, uint_type end, const F& kernel) {
+                batchRange<T,64>(begin, end, kernel);
+            }
+            #endif
+
+            template<class T, class F>
+            void batchForEach(uint_type begin, uint_type end, const F& kernel) {
+                /*
+                    Runs one of the kernels above over the groups of matrices
+                    in [begin, end) at the widest vector width the host
+                    supports.
+                */
+                #ifdef BOP_SIMD_X86
+                switch (simd::level()) {
+                    case simd::avx512:
+                        batchRangeAVX512<T>(begin, end, kernel);
+                        return;
+                    case simd::avx2:
+                        batchRangeAVX2<T>(begin, end, kernel);
+                        return;
+                    default:
+                        break;
+                }
+                #endif
+                batchRange<T,16>(begin, end, kernel);
+            }
+
+            template<class T, class F>
+            void batchForEach(util::ThreadPool& pool, uint_type count, const F& kernel) {
+                /*
+                    Splits the groups of a batch into one contiguous range per
+                    thread.
+                */
+                const uint_type threshold = BatchParallelThreshold::matrices;
+                const uint_type group = BatchGroup<T>::matrices;
+                const uint_type threads = pool.numberOfThreads();
+                if (threads < 2 || count < threshold) {
+                    batchForEach<T>(0, count, kernel);
+                    return;
+                }
+                const uint_type groups = (count + group - 1) / group;
+                const uint_type groups_per_task = (groups + threads - 1) / threads;
+                const uint_type tasks = (groups + groups_per_task - 1) / groups_per_task;
+                TaskLatch latch(tasks);
+                TaskLatch* latch_ptr = &latch;
+                const F* kernel_ptr = &kernel;
+                for (uint_type task = 0; task < tasks; task++) {
+                    const uint_type begin = task * groups_per_task * group;
+                    const uint_type end = std::min(count, begin + (groups_per_task * group));
+                    pool.addTask([=]() -> void {
+                        batchForEach<T>(begin, end, *kernel_ptr);
+                        latch_ptr->countDown();
+                    });
+                }
+                latch.wait();
+            }
+        }
+
+        template<class T, uint_type R, uint_type C>
+        class MatrixBatch {
+            protected:
+                uint_type batch_size;
+                /*
+                    Matrices each plane has room for, a whole number of
+                    BatchPack groups so that the kernels never need a
+                    remainder loop, and one group more when the planes would
+                    be a multiple of 4KiB apart and compete for the same
+                    cache sets. The padding matrices are zero.
+                */
+                uint_type batch_capacity;
+                std::vector<T> planes;
+
+            public:
+                typedef T value_type;
+                
+                //Constructors
+
+                MatrixBatch() : batch_size(0), batch_capacity(0) {
+                }
+
+                MatrixBatch(uint_type count) : MatrixBatch() {
+                    /*
+                        count zero matrices.
+                    */
+                    this->resize(count);
+                }
+
+                MatrixBatch(uint_type count, const FixedMatrix<T,R,C>& mat) : MatrixBatch(count) {
+                    /*
+                        count copies of mat.
+                    */
+                    for (uint_type elem = 0; elem < R * C; elem++) std::fill(this->plane(elem), this->plane(elem) + count, mat.element(elem));
+                }
+
+                void resize(uint_type count) {
+                    /*
+                        Keeps the first count matrices, new matrices are zero.
+                    */
+                    const uint_type group = kernel::BatchGroup<T>::matrices;
+                    uint_type capacity = ((count + group - 1) / group) * group;
+                    if (((capacity * sizeof(T)) % 4096) == 0) capacity += group;
+                    std::vector<T> resized(R * C * capacity, T(0));
+                    const uint_type kept = std::min(count, this->batch_size);
+                    for (uint_type elem = 0; elem < R * C; elem++) {
+                        std::copy(this->plane(elem), this->plane(elem) + kept, resized.begin() + (elem * capacity));
+                    }
+                    this->planes.swap(resized);
+                    this->batch_size = count;
+                    this->batch_capacity = capacity;
+                }
+
+                //Element access
+
+                inline T* plane(uint_type elem) {
+                    /*
+                        Element elem (row-major) of every matrix in the batch.
+                    */
+                    return this->planes.data() + (elem * this->batch_capacity);
+                }
+
+                inline const T* plane(uint_type elem) const {
+                    return this->planes.data() + (elem * this->batch_capacity);
+                }
+
+                inline T& element(uint_type index, uint_type row, uint_type col) {
+                    return this->plane((row * C) + col)[index];
+                }
+
+                inline const T& element(uint_type index, uint_type row, uint_type col) const {
+                    return this->plane((row * C) + col)[index];
+                }
+
+                FixedMatrix<T,R,C> get(uint_type index) const {
+                    FixedMatrix<T,R,C> mat;
+                    for (uint_type elem = 0; elem < R * C; elem++) mat.element(elem) = this->plane(elem)[index];
+                    return mat;
+                }
+
+                void set(uint_type index, const FixedMatrix<T,R,C>& mat) {
+                    for (uint_type elem = 0; elem < R * C; elem++) this->plane(elem)[index] = mat.element(elem);
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->batch_size;
+                }
+
+                inline uint_type stride() const {
+                    /*
+                        Elements between consecutive planes.
+                    */
+                    return this->batch_capacity;
+                }
+
+                //Square matrix functions
+
+                std::vector<T> det() const {
+                    return this->determinants(nullptr);
+                }
+
+                std::vector<T> det(util::ThreadPool& pool) const {
+                    return this->determinants(&pool);
+                }
+
+                uint_type invert() {
+                    return this->invertEach(nullptr);
+                }
+
+                uint_type invert(util::ThreadPool& pool) {
+                    return this->invertEach(&pool);
+                }
+
+                MatrixBatch<T,R,C> inverted() const {
+                    MatrixBatch<T,R,C> batch(*this);
+                    batch.invert();
+                    return batch;
+                }
+
+            protected:
+                template<class F>
+                void forEachGroup(util::ThreadPool* pool, const F& kernel) const {
+                    if (pool != nullptr) kernel::batchForEach<T>(*pool, this->batch_capacity, kernel);
+                    else kernel::batchForEach<T>(0, this->batch_capacity, kernel);
+                }
+
+                std::vector<T> determinants(util::ThreadPool* pool) const {
+                    /*
+                        The determinant of every matrix in the batch.
+                    */
+                    static_assert(R == C && R <= 4, "bop::maths::MatrixBatch::det() needs square matrices of at most 4x4.");
+                    std::vector<T> dets(this->batch_capacity);
+                    const kernel::BatchDetKernel<T,R> det_kernel = {this->planes.data(), this->batch_capacity, dets.data()};
+                    this->forEachGroup(pool, det_kernel);
+                    dets.resize(this->batch_size);
+                    return dets;
+                }
+
+                uint_type invertEach(util::ThreadPool* pool) {
+                    /*
+                        Inverts every matrix in place and returns how many were
+                        singular, those are left unchanged.
+                    */
+                    static_assert(R == C && R <= 4, "bop::maths::MatrixBatch::invert() needs square matrices of at most 4x4.");
+                    std::vector<T> dets(this->batch_capacity);
+                    const kernel::BatchInvertKernel<T,R> invert_kernel = {this->planes.data(), this->batch_capacity, dets.data()};
+                    this->forEachGroup(pool, invert_kernel);
+                    return std::count(dets.begin(), dets.begin() + this->batch_size, T(0));
+                }
+
+                template<class T_, uint_type R_, uint_type K_, uint_type C_>
+                friend MatrixBatch<T_,R_,C_>& multiply(const MatrixBatch<T_,R_,K_>& batch1, const MatrixBatch<T_,K_,C_>& batch2, MatrixBatch<T_,R_,C_>& batch_p, util::ThreadPool* pool);
+        };
+
+        template<class T, uint_type R, uint_type K, uint_type C>
+        MatrixBatch<T,R,C>& multiply(const MatrixBatch<T,R,K>& batch1, const MatrixBatch<T,K,C>& batch2, MatrixBatch<T,R,C>& batch_p, util::ThreadPool* pool) {
+            /*
+                Pairwise products batch1[i] * batch2[i] over the matrices the
+                two batches share, written into batch_p, which must not be
+                either operand. Reusing batch_p across calls avoids allocating
+                the output. A null pool multiplies on this thread.
+            */
+            const uint_type count = std::min(batch1.size(), batch2.size());
+            if (batch_p.size() != count) batch_p.resize(count);
+            const kernel::BatchMultiplyKernel<T,R,K,C> multiply_kernel = {batch1.plane(0), batch1.stride(), batch2.plane(0), batch2.stride(), batch_p.plane(0), batch_p.stride()};
+            batch_p.forEachGroup(pool, multiply_kernel);
+            return batch_p;
+        }
+
+        template<class T, uint_type R, uint_type K, uint_type C>
+        MatrixBatch<T,R,C>& multiply(const MatrixBatch<T,R,K>& batch1, const MatrixBatch<T,K,C>& batch2, MatrixBatch<T,R,C>& batch_p) {
+            return multiply(batch1, batch2, batch_p, static_cast<util::ThreadPool*>(nullptr));
+        }
+
+        template<class T, uint_type R, uint_type K, uint_type C>
+        MatrixBatch<T,R,C>& multiply(const MatrixBatch<T,R,K>& batch1, const MatrixBatch<T,K,C>& batch2, MatrixBatch<T,R,C>& batch_p, util::ThreadPool& pool) {
+            return multiply(batch1, batch2, batch_p, &pool);
+        }
+
+        template<class T, uint_type R, uint_type K, uint_type C>
+        MatrixBatch<T,R,C> multiply(const MatrixBatch<T,R,K>& batch1, const MatrixBatch<T,K,C>& batch2, util::ThreadPool& pool = defaultThreadPool()) {
+            /*
+                Parallel counterpart of batch1 * batch2, spread across the
+                given pool (or the library's default pool) for large batches.
+            */
+            MatrixBatch<T,R,C> batch_p;
+            multiply(batch1, batch2, batch_p, &pool);
+            return batch_p;
+        }
+
+        template<class T, uint_type R, uint_type K, uint_type C>
+        MatrixBatch<T,R,C> operator* (const MatrixBatch<T,R,K>& batch1, const MatrixBatch<T,K,C>& batch2) {
+            MatrixBatch<T,R,C> batch_p;
+            multiply(batch1, batch2, batch_p, static_cast<util::ThreadPool*>(nullptr));
+            return batch_p;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef BOP_MATRIX_CACHE_HPP
+#define BOP_MATRIX_CACHE_HPP
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include "../bop-defaults/types.hpp"
+#include "MatrixAllocator.hpp"
+
+/*
+    bop::maths::MatrixCache class file
+
+    A bounded cache of immutable matrices shared between threads, used by
+    the Matrix factories. Matrices are handed out as shared handles, so a
+    hit costs a reference count rather than a copy and a handle stays
+    valid after its matrix has been evicted. Once the cache is full the
+    least recently used matrix is evicted.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        struct MatrixCacheStatistics {
+            uint_type hits;
+            uint_type misses;
+            uint_type evictions;
+            uint_type size;
+            uint_type capacity;
+        };
+
+        template<class K, class T, class Hash = std::hash<K> >
+        class MatrixCache {
+            public:
+                typedef std::shared_ptr< const Matrix<T> > handle_type;
+
+            protected:
+                typedef std::list< std::pair<K,handle_type> > entry_list;
+
+                /*
+                    Most recently used first.
+                */
+                entry_list entries;
+                std::unordered_map<K,typename entry_list::iterator,Hash> index;
+                uint_type max_entries;
+                uint_type hit_count;
+                uint_type miss_count;
+                uint_type eviction_count;
+                mutable std::mutex cache_mutex;
+
+                void trim() {
+                    /*
+                        Must be called with cache_mutex held.
+                    */
+                    while (this->entries.size() > this->max_entries) {
+                        this->index.erase(this->entries.back().first);
+                        this->entries.pop_back();
+                        this->eviction_count++;
+                    }
+                }
+
+            public:
+                MatrixCache(uint_type capacity) : max_entries(capacity), hit_count(0), miss_count(0), eviction_count(0) {
+                }
+
+                MatrixCache(const MatrixCache&) = delete;
+                MatrixCache& operator= (const MatrixCache&) = delete;
+
+                template<class F>
+                handle_type get(const K& key, F make) {
+                    /*
+                        The matrix stored under key, made by calling make()
+                        on a miss. make() runs without the lock held, so a
+                        slow one does not stall hits from other threads; if
+                        two threads miss on the same key together, the
+                        first to finish is kept and both get it. Cached
+                        matrices outlive any scope the caller has open, so
+                        they are built with the process default allocator.
+                    */
+                    {
+                        std::lock_guard<std::mutex> lock(this->cache_mutex);
+                        auto found = this->index.find(key);
+                        if (found != this->index.end()) {
+                            this->entries.splice(this->entries.begin(), this->entries, found->second);
+                            this->hit_count++;
+                            return found->second->second;
+                        }
+                        this->miss_count++;
+                    }
+                    handle_type made;
+                    {
+                        MatrixAllocatorScope scope(MatrixAllocator::standard());
+                        made = std::make_shared< const Matrix<T> >(make());
+                    }
+                    std::lock_guard<std::mutex> lock(this->cache_mutex);
+                    auto found = this->index.find(key);
+                    if (found != this->index.end()) return found->second->second;
+                    if (this->max_entries == 0) return made;
+                    this->entries.emplace_front(key, made);
+                    this->index[key] = this->entries.begin();
+                    this->trim();
+                    return made;
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    std::lock_guard<std::mutex> lock(this->cache_mutex);
+                    return this->entries.size();
+                }
+
+                inline uint_type capacity() const {
+                    std::lock_guard<std::mutex> lock(this->cache_mutex);
+                    return this->max_entries;
+                }
+
+                MatrixCacheStatistics statistics() const {
+                    /*
+                        A consistent snapshot of the counters.
+                    */
+                    std::lock_guard<std::mutex> lock(this->cache_mutex);
+                    MatrixCacheStatistics stats;
+                    stats.hits = this->hit_count;
+                    stats.misses = this->miss_count;
+                    stats.evictions = this->eviction_count;
+                    stats.size = this->entries.size();
+                    stats.capacity = this->max_entries;
+                    return stats;
+                }
+
+                //Management functions
+
+                void setCapacity(uint_type capacity) {
+                    /*
+                        Shrinking evicts the least recently used matrices,
+                        a capacity of zero disables caching.
+                    */
+                    std::lock_guard<std::mutex> lock(this->cache_mutex);
+                    this->max_entries = capacity;
+                    this->trim();
+                }
+
+                void clear() {
+                    std::lock_guard<std::mutex> lock(this->cache_mutex);
+                    this->index.clear();
+                    this->entries.clear();
+                }
+
+                void resetStatistics() {
+                    std::lock_guard<std::mutex> lock(this->cache_mutex);
+                    this->hit_count = 0;
+                    this->miss_count = 0;
+                    this->eviction_count = 0;
+                }
+        };
+    }
+}
+
+#endif
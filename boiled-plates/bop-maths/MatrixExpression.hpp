@@ -0,0 +1,358 @@
+#ifndef BOP_MATRIX_EXPRESSION_HPP
+#define BOP_MATRIX_EXPRESSION_HPP
+
+#include <type_traits>
+#include <iostream>
+#include <utility>
+#include "../bop-defaults/types.hpp"
+
+/*
+    Expression templates for the element-wise bop::maths::Matrix operators.
+
+    The free +, -, scalar * and / operators build lightweight expression
+    objects instead of matrices, and the whole expression is evaluated in
+    a single pass when it is assigned to (or used to construct) a Matrix.
+    Expressions convert implicitly to Matrix<T>, so code that expects a
+    matrix keeps working.
+
+    Matrix operands are held by reference, so an expression should be
+    consumed within the statement that builds it rather than stored with
+    "auto".
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        template<class E>
+        struct MatrixExpression {
+            /*
+                CRTP base of every expression node.
+            */
+            inline const E& expression() const {
+                return static_cast<const E&>(*this);
+            }
+        };
+
+        template<class T>
+        class MatrixTerminal : public MatrixExpression< MatrixTerminal<T> > {
+            /*
+                Leaf of an expression, refers to an existing matrix.
+            */
+            private:
+                const Matrix<T>& matrix;
+            public:
+                typedef T value_type;
+
+                MatrixTerminal(const Matrix<T>& mat) : matrix(mat) {
+                }
+
+                inline uint_type width() const {
+                    return this->matrix.width();
+                }
+
+                inline uint_type height() const {
+                    return this->matrix.height();
+                }
+
+                inline bool conformant(uint_type width, uint_type height) const {
+                    /*
+                        Flat indexing is only used on matrices with packed rows.
+                    */
+                    return (this->width() == width && this->height() == height && this->matrix.packed());
+                }
+
+                inline T element(uint_type elem) const {
+                    return this->matrix.rowData(0)[elem];
+                }
+
+                inline T element(uint_type row, uint_type col) const {
+                    return this->matrix.element(row,col);
+                }
+        };
+
+        struct ExpressionAdd {
+            template<class T>
+            static inline T apply(const T left, const T right) {
+                return left + right;
+            }
+        };
+
+        struct ExpressionSubtract {
+            template<class T>
+            static inline T apply(const T left, const T right) {
+                return left - right;
+            }
+        };
+
+        struct ExpressionMultiply {
+            template<class T>
+            static inline T apply(const T left, const T right) {
+                return left * right;
+            }
+        };
+
+        template<class L, class R, class Op>
+        class MatrixBinaryExpression : public MatrixExpression< MatrixBinaryExpression<L,R,Op> > {
+            /*
+                Element-wise combination of two expressions. Takes the shape
+                of the left operand, and like Matrix::operator+= only combines
+                over the region both operands share.
+            */
+            private:
+                L left;
+                R right;
+            public:
+                typedef typename L::value_type value_type;
+
+                MatrixBinaryExpression(const L& left_expr, const R& right_expr) : left(left_expr), right(right_expr) {
+                }
+
+                inline uint_type width() const {
+                    return this->left.width();
+                }
+
+                inline uint_type height() const {
+                    return this->left.height();
+                }
+
+                inline bool conformant(uint_type width, uint_type height) const {
+                    return this->left.conformant(width,height) && this->right.conformant(width,height);
+                }
+
+                inline value_type element(uint_type elem) const {
+                    return Op::apply(this->left.element(elem), this->right.element(elem));
+                }
+
+                inline value_type element(uint_type row, uint_type col) const {
+                    if (row < this->right.height() && col < this->right.width()) {
+                        return Op::apply(this->left.element(row,col), this->right.element(row,col));
+                    }
+                    else return this->left.element(row,col);
+                }
+
+                inline Matrix<value_type> eval() const {
+                    return Matrix<value_type>(*this);
+                }
+        };
+
+        template<class E, class Op>
+        class MatrixScalarExpression : public MatrixExpression< MatrixScalarExpression<E,Op> > {
+            /*
+                Element-wise combination of an expression and a scalar.
+            */
+            private:
+                E expr;
+            public:
+                typedef typename E::value_type value_type;
+            private:
+                value_type scalar;
+            public:
+
+                MatrixScalarExpression(const E& expression, const value_type scalar_value) : expr(expression), scalar(scalar_value) {
+                }
+
+                inline uint_type width() const {
+                    return this->expr.width();
+                }
+
+                inline uint_type height() const {
+                    return this->expr.height();
+                }
+
+                inline bool conformant(uint_type width, uint_type height) const {
+                    return this->expr.conformant(width,height);
+                }
+
+                inline value_type element(uint_type elem) const {
+                    return Op::apply(this->expr.element(elem), this->scalar);
+                }
+
+                inline value_type element(uint_type row, uint_type col) const {
+                    return Op::apply(this->expr.element(row,col), this->scalar);
+                }
+
+                inline Matrix<value_type> eval() const {
+                    return Matrix<value_type>(*this);
+                }
+        };
+
+        template<class X, bool = std::is_base_of<MatrixExpression<X>, X>::value>
+        struct MatrixExpressionTraits {
+            /*
+                Identifies what may appear as an operand of an expression,
+                and how it is stored inside the expression tree.
+            */
+            static const bool value = false;
+            static const bool node = false;
+        };
+
+        template<class X>
+        struct MatrixExpressionTraits<X,true> {
+            static const bool value = true;
+            static const bool node = true;
+            typedef X term_type;
+            typedef typename X::value_type value_type;
+        };
+
+        template<class T>
+        struct MatrixExpressionTraits<Matrix<T>,false> {
+            static const bool value = true;
+            static const bool node = false;
+            typedef MatrixTerminal<T> term_type;
+            typedef T value_type;
+        };
+
+        template<class L, class R, bool = MatrixExpressionTraits<L>::value && MatrixExpressionTraits<R>::value>
+        struct MatrixExpressionOperands {
+            /*
+                True when two operands can be combined into an expression,
+                which needs both to have the same element type so nothing
+                is converted silently.
+            */
+            static const bool value = false;
+        };
+
+        template<class L, class R>
+        struct MatrixExpressionOperands<L,R,true> {
+            static const bool value = std::is_same<typename MatrixExpressionTraits<L>::value_type, typename MatrixExpressionTraits<R>::value_type>::value;
+        };
+
+        //Expression building operators
+
+        template<class L, class R>
+        inline typename std::enable_if<MatrixExpressionOperands<L,R>::value,
+            MatrixBinaryExpression<typename MatrixExpressionTraits<L>::term_type, typename MatrixExpressionTraits<R>::term_type, ExpressionAdd> >::type
+        operator+ (const L& left, const R& right) {
+            return MatrixBinaryExpression<typename MatrixExpressionTraits<L>::term_type, typename MatrixExpressionTraits<R>::term_type, ExpressionAdd>(left, right);
+        }
+
+        template<class L, class R>
+        inline typename std::enable_if<MatrixExpressionOperands<L,R>::value,
+            MatrixBinaryExpression<typename MatrixExpressionTraits<L>::term_type, typename MatrixExpressionTraits<R>::term_type, ExpressionSubtract> >::type
+        operator- (const L& left, const R& right) {
+            return MatrixBinaryExpression<typename MatrixExpressionTraits<L>::term_type, typename MatrixExpressionTraits<R>::term_type, ExpressionSubtract>(left, right);
+        }
+
+        template<class E>
+        inline typename std::enable_if<MatrixExpressionTraits<E>::value,
+            MatrixScalarExpression<typename MatrixExpressionTraits<E>::term_type, ExpressionMultiply> >::type
+        operator* (const E& expr, const typename MatrixExpressionTraits<E>::value_type scalar) {
+            return MatrixScalarExpression<typename MatrixExpressionTraits<E>::term_type, ExpressionMultiply>(expr, scalar);
+        }
+
+        template<class E>
+        inline typename std::enable_if<MatrixExpressionTraits<E>::value,
+            MatrixScalarExpression<typename MatrixExpressionTraits<E>::term_type, ExpressionMultiply> >::type
+        operator/ (const E& expr, const typename MatrixExpressionTraits<E>::value_type scalar) {
+            /*
+                Mirrors Matrix::operator/=, multiplying by the reciprocal and
+                leaving the matrix unchanged when dividing by zero.
+            */
+            typedef typename MatrixExpressionTraits<E>::value_type value_type;
+            return MatrixScalarExpression<typename MatrixExpressionTraits<E>::term_type, ExpressionMultiply>(expr, (scalar != 0) ? (1/scalar) : value_type(1));
+        }
+
+        //Operators that reuse the storage of an expiring matrix
+
+        template<class T, class R>
+        struct MatrixExpressionOperand {
+            /*
+                True when R can be combined with a Matrix<T> in place.
+            */
+            static const bool value = MatrixExpressionTraits<R>::value && std::is_same<typename MatrixExpressionTraits<R>::value_type, T>::value;
+        };
+
+        template<class T, class R>
+        inline typename std::enable_if<MatrixExpressionOperand<T,R>::value, Matrix<T> >::type
+        operator+ (Matrix<T>&& left, const R& right) {
+            /*
+                The result is evaluated into the left operand's storage
+                instead of a new matrix, so chains such as a + b + c
+                allocate once when the first operand is a temporary.
+            */
+            left += right;
+            return std::move(left);
+        }
+
+        template<class T, class R>
+        inline typename std::enable_if<MatrixExpressionOperand<T,R>::value, Matrix<T> >::type
+        operator- (Matrix<T>&& left, const R& right) {
+            left -= right;
+            return std::move(left);
+        }
+
+        template<class T, class L>
+        inline typename std::enable_if<MatrixExpressionOperand<T,L>::value, Matrix<T> >::type
+        operator+ (const L& left, Matrix<T>&& right) {
+            /*
+                Only when the shapes match can the right operand's storage
+                hold the result, which takes the left operand's shape.
+            */
+            if (left.width() != right.width() || left.height() != right.height()) return Matrix<T>(left + right);
+            right += left;
+            return std::move(right);
+        }
+
+        template<class T, class L>
+        inline typename std::enable_if<MatrixExpressionOperand<T,L>::value, Matrix<T> >::type
+        operator- (const L& left, Matrix<T>&& right) {
+            if (left.width() != right.width() || left.height() != right.height()) return Matrix<T>(left - right);
+            right = left - right;
+            return std::move(right);
+        }
+
+        template<class T>
+        inline Matrix<T> operator+ (Matrix<T>&& left, Matrix<T>&& right) {
+            left += right;
+            return std::move(left);
+        }
+
+        template<class T>
+        inline Matrix<T> operator- (Matrix<T>&& left, Matrix<T>&& right) {
+            left -= right;
+            return std::move(left);
+        }
+
+        template<class T>
+        inline Matrix<T> operator* (Matrix<T>&& mat, const typename MatrixExpressionTraits< Matrix<T> >::value_type scalar) {
+            mat *= scalar;
+            return std::move(mat);
+        }
+
+        template<class T>
+        inline Matrix<T> operator/ (Matrix<T>&& mat, const typename MatrixExpressionTraits< Matrix<T> >::value_type scalar) {
+            mat /= scalar;
+            return std::move(mat);
+        }
+
+        //Operators that need a materialised matrix
+
+        template<class L, class R>
+        inline typename std::enable_if<MatrixExpressionOperands<L,R>::value && (MatrixExpressionTraits<L>::node || MatrixExpressionTraits<R>::node),
+            Matrix<typename MatrixExpressionTraits<L>::value_type> >::type
+        operator* (const L& left, const R& right) {
+            /*
+                Matrix product where at least one operand is an unevaluated
+                expression, both are evaluated first.
+            */
+            Matrix<typename MatrixExpressionTraits<L>::value_type> mat_p(left);
+            mat_p *= Matrix<typename MatrixExpressionTraits<R>::value_type>(right);
+            return mat_p;
+        }
+
+        template<class E>
+        inline typename std::enable_if<MatrixExpressionTraits<E>::node, std::ostream&>::type
+        operator<< (std::ostream& stream, const E& expr) {
+            stream << Matrix<typename E::value_type>(expr);
+            return stream;
+        }
+    }
+}
+
+#endif
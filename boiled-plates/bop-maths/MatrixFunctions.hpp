@@ -0,0 +1,203 @@
+#ifndef BOP_MATRIX_FUNCTIONS_HPP
+#define BOP_MATRIX_FUNCTIONS_HPP
+
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <initializer_list>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "SIMD.hpp"
+#include "Matrix.hpp"
+#include "LUDecomposition.hpp"
+
+/*
+    bop::maths matrix functions file
+
+    Integer powers by repeated squaring, taking O(log k) products instead
+    of k, and the matrix exponential by scaling and squaring with Pade
+    approximants (Higham, "The scaling and squaring method for the matrix
+    exponential revisited", 2005). Every product goes through the GEMM
+    kernel into buffers allocated once up front, so the number of
+    allocations does not grow with k or with the number of squarings.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            template<class T>
+            inline void productInto(const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& c, T beta = T(0)) {
+                /*
+                    c = a * b + beta * c for square matrices of one size, c
+                    must be a different matrix to a and b.
+                */
+                gemm<T>(a.height(), b.width(), a.width(), T(1),
+                        a.rowData(0), a.stride(), 1,
+                        b.rowData(0), b.stride(), 1,
+                        beta, c.rowData(0), c.stride());
+            }
+
+            template<class T>
+            void combineInto(Matrix<T>& out, T identity, std::initializer_list< std::pair<T, const Matrix<T>*> > terms) {
+                /*
+                    out = identity * I + the sum of the scaled terms.
+                */
+                for (uint_type row = 0; row < out.height(); row++) {
+                    T* out_row = out.rowData(row);
+                    std::fill(out_row, out_row + out.width(), T(0));
+                    for (const std::pair<T, const Matrix<T>*>& term : terms) axpy<T>(out.width(), term.first, term.second->rowData(row), out_row);
+                    out_row[row] += identity;
+                }
+            }
+        }
+
+        template<class T>
+        Matrix<T> pow(const Matrix<T>& mat, uint_type power) {
+            /*
+                mat raised to a non-negative integer power by binary
+                exponentiation, in about 2 log2(power) products between
+                three buffers. A non-square matrix is returned unchanged,
+                and the zeroth power is the identity.
+            */
+            if (!mat.square() || mat.height() == 0) return mat;
+            const uint_type n = mat.height();
+            Matrix<T> result(n, n), base(mat), scratch(n, n);
+            if (power == 0) {
+                for (uint_type elem = 0; elem < n; elem++) result.element(elem,elem) = T(1);
+                return result;
+            }
+            bool first = true;
+            while (true) {
+                if (power & 1) {
+                    if (first) {
+                        for (uint_type row = 0; row < n; row++) std::copy(base.rowData(row), base.rowData(row) + n, result.rowData(row));
+                        first = false;
+                    }
+                    else {
+                        kernel::productInto(result, base, scratch);
+                        std::swap(result, scratch);
+                    }
+                }
+                power >>= 1;
+                if (power == 0) break;
+                kernel::productInto(base, base, scratch);
+                std::swap(base, scratch);
+            }
+            return result;
+        }
+
+        template<class T>
+        Matrix<T> expm(const Matrix<T>& mat) {
+            /*
+                The matrix exponential e^A. The lowest degree Pade
+                approximant accurate to double precision for the 1-norm of
+                A is used, from degree 3 up to 13; beyond the reach of
+                degree 13, A is first scaled by 2^-s and the result squared
+                s times. A non-square matrix, or one whose approximant
+                cannot be solved for (only when A is not finite), is
+                returned unchanged.
+            */
+            static_assert(std::is_floating_point<T>::value, "bop::maths::expm is only for floating point types.");
+            if (!mat.square()) return mat;
+            const uint_type n = mat.height();
+            if (n == 0) return mat;
+            static const double theta[] = {1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1, 2.097847961257068e0, 5.371920351148152e0};
+            static const double b3[] = {120, 60, 12, 1};
+            static const double b5[] = {30240, 15120, 3360, 420, 30, 1};
+            static const double b7[] = {17297280, 8648640, 1995840, 277200, 25200, 1512, 56, 1};
+            static const double b9[] = {17643225600.0, 8821612800.0, 2075673600, 302702400, 30270240, 2162160, 110880, 3960, 90, 1};
+            static const double b13[] = {64764752532480000.0, 32382376266240000.0, 7771770303897600.0, 1187353796428800.0,
+                                         129060195264000.0, 10559470521600.0, 670442572800.0, 33522128640.0,
+                                         1323241920, 40840800, 960960, 16380, 182, 1};
+            T norm = T(0);
+            for (uint_type col = 0; col < n; col++) {
+                T sum = T(0);
+                for (uint_type row = 0; row < n; row++) sum += std::abs(mat.element(row,col));
+                norm = std::max(norm, sum);
+            }
+            uint_type degree = 13;
+            uint_type squarings = 0;
+            const double* b = b13;
+            if (norm <= T(theta[0])) { degree = 3; b = b3; }
+            else if (norm <= T(theta[1])) { degree = 5; b = b5; }
+            else if (norm <= T(theta[2])) { degree = 7; b = b7; }
+            else if (norm <= T(theta[3])) { degree = 9; b = b9; }
+            else if (norm > T(theta[4])) {
+                if (!std::isfinite(norm)) return mat;
+                squarings = static_cast<uint_type>(std::max(0.0, std::ceil(std::log2(double(norm) / theta[4]))));
+            }
+            Matrix<T> a(mat);
+            if (squarings > 0) a *= T(std::ldexp(1.0, -static_cast<int>(squarings)));
+            /*
+                e^A ~ (V - U)^-1 (V + U) with U holding the odd powers of A
+                and V the even ones.
+            */
+            Matrix<T> a2(n, n), a4(n, n), a6(n, n), u(n, n), v(n, n), odd(n, n);
+            kernel::productInto(a, a, a2);
+            if (degree >= 5) kernel::productInto(a2, a2, a4);
+            if (degree >= 7) kernel::productInto(a4, a2, a6);
+            if (degree == 13) {
+                /*
+                    Degree 13 needs only A^2, A^4 and A^6, with
+                    U = A [A^6 (b13 A^6 + b11 A^4 + b9 A^2) + b7 A^6 + b5 A^4 + b3 A^2 + b1 I]
+                    and V formed the same way from the even coefficients.
+                */
+                Matrix<T> high(n, n);
+                kernel::combineInto<T>(high, T(0), {{T(b[13]), &a6}, {T(b[11]), &a4}, {T(b[9]), &a2}});
+                kernel::combineInto<T>(odd, T(b[1]), {{T(b[7]), &a6}, {T(b[5]), &a4}, {T(b[3]), &a2}});
+                kernel::productInto(a6, high, odd, T(1));
+                kernel::combineInto<T>(high, T(0), {{T(b[12]), &a6}, {T(b[10]), &a4}, {T(b[8]), &a2}});
+                kernel::combineInto<T>(v, T(b[0]), {{T(b[6]), &a6}, {T(b[4]), &a4}, {T(b[2]), &a2}});
+                kernel::productInto(a6, high, v, T(1));
+            }
+            else {
+                Matrix<T> a8;
+                if (degree == 9) {
+                    a8 = Matrix<T>(n, n);
+                    kernel::productInto(a6, a2, a8);
+                }
+                switch (degree) {
+                    case 3:
+                        kernel::combineInto<T>(odd, T(b[1]), {{T(b[3]), &a2}});
+                        kernel::combineInto<T>(v, T(b[0]), {{T(b[2]), &a2}});
+                        break;
+                    case 5:
+                        kernel::combineInto<T>(odd, T(b[1]), {{T(b[5]), &a4}, {T(b[3]), &a2}});
+                        kernel::combineInto<T>(v, T(b[0]), {{T(b[4]), &a4}, {T(b[2]), &a2}});
+                        break;
+                    case 7:
+                        kernel::combineInto<T>(odd, T(b[1]), {{T(b[7]), &a6}, {T(b[5]), &a4}, {T(b[3]), &a2}});
+                        kernel::combineInto<T>(v, T(b[0]), {{T(b[6]), &a6}, {T(b[4]), &a4}, {T(b[2]), &a2}});
+                        break;
+                    default:
+                        kernel::combineInto<T>(odd, T(b[1]), {{T(b[9]), &a8}, {T(b[7]), &a6}, {T(b[5]), &a4}, {T(b[3]), &a2}});
+                        kernel::combineInto<T>(v, T(b[0]), {{T(b[8]), &a8}, {T(b[6]), &a6}, {T(b[4]), &a4}, {T(b[2]), &a2}});
+                        break;
+                }
+            }
+            kernel::productInto(a, odd, u);
+            /*
+                The buffers of A^4 and A^6 are free again, and hold V + U and
+                V - U for the solve.
+            */
+            kernel::combineInto<T>(a4, T(0), {{T(1), &v}, {T(1), &u}});
+            kernel::combineInto<T>(a6, T(0), {{T(1), &v}, {T(-1), &u}});
+            LUDecomposition<T> lu(a6);
+            if (lu.singular()) return mat;
+            lu.solveInPlace(a4.rowData(0), n, a4.stride());
+            for (uint_type iter = 0; iter < squarings; iter++) {
+                kernel::productInto(a4, a4, a6);
+                std::swap(a4, a6);
+            }
+            return a4;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,368 @@
+#ifndef BOP_MATRIX_KERNELS_HPP
+#define BOP_MATRIX_KERNELS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "../bop-defaults/types.hpp"
+#ifndef BOP_STRASSEN_CROSSOVER
+#define BOP_STRASSEN_CROSSOVER 2048
+#endif
+
+/*
+    bop::maths::kernel, the computational kernels behind bop::maths::Matrix.
+
+    Kernels work on raw row-major buffers so that they can be shared by
+    anything that stores its elements in a similar way. Operands are given
+    as a pointer with a row stride and a column stride, element (i,j) of an
+    operand being ptr[(i * row_stride) + (j * col_stride)].
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            template<class T>
+            struct GemmBlocking {
+                /*
+                    Blocking sizes for the packed GEMM kernel. The micro kernel
+                    keeps an mr by nr tile of the product in registers, a kc by nr
+                    sliver of B is sized to stay in L1, an mc by kc block of A in
+                    L2 and a kc by nc panel of B in L3.
+                */
+                static const uint_type mr = 4;
+                static const uint_type nr = 4;
+                static const uint_type kc = 256;
+                static const uint_type mc = 128;
+                static const uint_type nc = 2048;
+            };
+
+            template<>
+            struct GemmBlocking<float> {
+                static const uint_type mr = 4;
+                static const uint_type nr = 8;
+                static const uint_type kc = 256;
+                static const uint_type mc = 128;
+                static const uint_type nc = 4096;
+            };
+
+            template<class T>
+            struct GemmTraits {
+                /*
+                    Types the packed kernel is used for, anything else goes
+                    through the naive triple loop.
+                */
+                static const bool blocked = std::is_same<T,float>::value || std::is_same<T,double>::value;
+                /*
+                    Products with fewer multiply-adds than this are too small
+                    for packing to pay for itself and use the naive loop.
+                */
+                static const uint_type small_product = 16 * 16 * 16;
+            };
+
+            template<class T, class S = T>
+            void gemmNaive(uint_type m, uint_type n, uint_type k, T alpha,
+                           const S* a, uint_type rsa, uint_type csa,
+                           const S* b, uint_type rsb, uint_type csb,
+                           T beta, T* c, uint_type ldc) {
+                /*
+                    Naive matrix multiplication, C = alpha*A*B + beta*C. Used
+                    for element types the packed kernel is not written for.
+                    The operands may be stored as a narrower type S, products
+                    are always formed in T.
+                */
+                for (uint_type row = 0; row < m; row++) {
+                    for (uint_type col = 0; col < n; col++) {
+                        T sum = 0;
+                        for (uint_type iter = 0; iter < k; iter++) {
+                            sum += T(a[(row * rsa) + (iter * csa)]) * T(b[(iter * rsb) + (col * csb)]);
+                        }
+                        if (beta == T(0)) c[(row * ldc) + col] = alpha * sum;
+                        else c[(row * ldc) + col] = (alpha * sum) + (beta * c[(row * ldc) + col]);
+                    }
+                }
+            }
+
+            template<class T, class S>
+            inline void gemmPackA(uint_type mc, uint_type kc, const S* a, uint_type rsa, uint_type csa, T* packed) {
+                /*
+                    Packs an mc by kc block of A into row panels of height mr,
+                    each stored so that the mr values needed by one step of
+                    the micro kernel are contiguous. Rows past the edge of
+                    the block are zero filled. A stored as a narrower type is
+                    widened here, so it is read from memory at its own size.
+                */
+                const uint_type mr = GemmBlocking<T>::mr;
+                for (uint_type panel = 0; panel < mc; panel += mr) {
+                    const uint_type rows = std::min(mr, mc - panel);
+                    for (uint_type iter = 0; iter < kc; iter++) {
+                        for (uint_type row = 0; row < mr; row++) {
+                            *(packed++) = (row < rows) ? T(a[((panel + row) * rsa) + (iter * csa)]) : T(0);
+                        }
+                    }
+                }
+            }
+
+            template<class T, class S>
+            inline void gemmPackB(uint_type kc, uint_type nc, const S* b, uint_type rsb, uint_type csb, T* packed) {
+                /*
+                    Packs a kc by nc panel of B into column slivers of width
+                    nr, mirroring gemmPackA.
+                */
+                const uint_type nr = GemmBlocking<T>::nr;
+                for (uint_type sliver = 0; sliver < nc; sliver += nr) {
+                    const uint_type cols = std::min(nr, nc - sliver);
+                    for (uint_type iter = 0; iter < kc; iter++) {
+                        for (uint_type col = 0; col < nr; col++) {
+                            *(packed++) = (col < cols) ? T(b[(iter * rsb) + ((sliver + col) * csb)]) : T(0);
+                        }
+                    }
+                }
+            }
+
+            template<class T>
+            inline void gemmMicroKernel(uint_type kc, const T* a_panel, const T* b_sliver, T* tile) {
+                /*
+                    Register-tiled inner kernel, computes the mr by nr product
+                    of one packed A panel and one packed B sliver. The fixed
+                    trip counts let the compiler keep the tile in registers
+                    and vectorise across nr.
+                */
+                const uint_type mr = GemmBlocking<T>::mr;
+                const uint_type nr = GemmBlocking<T>::nr;
+                T acc[GemmBlocking<T>::mr * GemmBlocking<T>::nr] = {};
+                for (uint_type iter = 0; iter < kc; iter++) {
+                    for (uint_type row = 0; row < mr; row++) {
+                        const T a_val = a_panel[row];
+                        for (uint_type col = 0; col < nr; col++) {
+                            acc[(row * nr) + col] += a_val * b_sliver[col];
+                        }
+                    }
+                    a_panel += mr;
+                    b_sliver += nr;
+                }
+                for (uint_type elem = 0; elem < mr * nr; elem++) tile[elem] = acc[elem];
+            }
+
+            template<class T, class S = T>
+            void gemmBlocked(uint_type m, uint_type n, uint_type k, T alpha,
+                             const S* a, uint_type rsa, uint_type csa,
+                             const S* b, uint_type rsb, uint_type csb,
+                             T beta, T* c, uint_type ldc) {
+                /*
+                    Packed, cache-blocked GEMM in the style of GotoBLAS/BLIS,
+                    C = alpha*A*B + beta*C.
+
+                    The loop nest, from the outside in, walks nc wide panels
+                    of C, kc deep panels of the shared dimension (packing B),
+                    mc tall blocks of C (packing A) and finally the mr by nr
+                    register tiles handled by the micro kernel.
+                */
+                const uint_type mr = GemmBlocking<T>::mr;
+                const uint_type nr = GemmBlocking<T>::nr;
+                const uint_type kc_max = GemmBlocking<T>::kc;
+                const uint_type mc_max = GemmBlocking<T>::mc;
+                const uint_type nc_max = GemmBlocking<T>::nc;
+                /*
+                    Packing buffers are kept per thread so that repeated products
+                    do not reallocate and concurrent callers do not collide.
+                */
+                static thread_local std::vector<T> packed_a;
+                static thread_local std::vector<T> packed_b;
+                T tile[GemmBlocking<T>::mr * GemmBlocking<T>::nr];
+                if (k == 0 || alpha == T(0)) {
+                    for (uint_type row = 0; row < m; row++) {
+                        for (uint_type col = 0; col < n; col++) {
+                            c[(row * ldc) + col] = (beta == T(0)) ? T(0) : beta * c[(row * ldc) + col];
+                        }
+                    }
+                    return;
+                }
+                for (uint_type jc = 0; jc < n; jc += nc_max) {
+                    const uint_type nc = std::min(nc_max, n - jc);
+                    for (uint_type pc = 0; pc < k; pc += kc_max) {
+                        const uint_type kc = std::min(kc_max, k - pc);
+                        /*
+                            Only the first pass over the shared dimension applies
+                            beta, every later pass accumulates onto it.
+                        */
+                        const T beta_pass = (pc == 0) ? beta : T(1);
+                        packed_b.resize(kc * (((nc + nr - 1) / nr) * nr));
+                        gemmPackB(kc, nc, b + (pc * rsb) + (jc * csb), rsb, csb, packed_b.data());
+                        for (uint_type ic = 0; ic < m; ic += mc_max) {
+                            const uint_type mc = std::min(mc_max, m - ic);
+                            packed_a.resize(kc * (((mc + mr - 1) / mr) * mr));
+                            gemmPackA(mc, kc, a + (ic * rsa) + (pc * csa), rsa, csa, packed_a.data());
+                            for (uint_type jr = 0; jr < nc; jr += nr) {
+                                const uint_type cols = std::min(nr, nc - jr);
+                                for (uint_type ir = 0; ir < mc; ir += mr) {
+                                    const uint_type rows = std::min(mr, mc - ir);
+                                    gemmMicroKernel(kc, packed_a.data() + (ir * kc), packed_b.data() + (jr * kc), tile);
+                                    T* c_tile = c + ((ic + ir) * ldc) + jc + jr;
+                                    for (uint_type row = 0; row < rows; row++) {
+                                        for (uint_type col = 0; col < cols; col++) {
+                                            T& c_elem = c_tile[(row * ldc) + col];
+                                            if (beta_pass == T(0)) c_elem = alpha * tile[(row * nr) + col];
+                                            else c_elem = (alpha * tile[(row * nr) + col]) + (beta_pass * c_elem);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            template<class T>
+            inline void gemm(std::true_type, uint_type m, uint_type n, uint_type k, T alpha,
+                             const T* a, uint_type rsa, uint_type csa,
+                             const T* b, uint_type rsb, uint_type csb,
+                             T beta, T* c, uint_type ldc) {
+                if (m * n * k < GemmTraits<T>::small_product) gemmNaive(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+                else gemmBlocked(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+            }
+
+            template<class T>
+            inline void gemm(std::false_type, uint_type m, uint_type n, uint_type k, T alpha,
+                             const T* a, uint_type rsa, uint_type csa,
+                             const T* b, uint_type rsb, uint_type csb,
+                             T beta, T* c, uint_type ldc) {
+                gemmNaive(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+            }
+
+            template<class T>
+            inline void gemm(uint_type m, uint_type n, uint_type k, T alpha,
+                             const T* a, uint_type rsa, uint_type csa,
+                             const T* b, uint_type rsb, uint_type csb,
+                             T beta, T* c, uint_type ldc) {
+                /*
+                    C = alpha*A*B + beta*C where A is m by k, B is k by n and C
+                    is an m by n row-major buffer with a row stride of ldc.
+                    Picks the packed kernel for float and double, and the naive
+                    loop for every other type.
+                */
+                gemm(std::integral_constant<bool, GemmTraits<T>::blocked>(), m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+            }
+
+            template<class T, class S>
+            inline void gemmMixed(uint_type m, uint_type n, uint_type k, T alpha,
+                                  const S* a, uint_type rsa, uint_type csa,
+                                  const S* b, uint_type rsb, uint_type csb,
+                                  T beta, T* c, uint_type ldc) {
+                /*
+                    As gemm(), with A and B stored as S (e.g. float) and the
+                    products accumulated in T (e.g. double). The operands are
+                    widened as they are packed, so they cost memory bandwidth
+                    at their stored size.
+                */
+                if (!GemmTraits<T>::blocked || m * n * k < GemmTraits<T>::small_product) gemmNaive<T,S>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+                else gemmBlocked<T,S>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+            }
+
+            inline uint_type& strassenCrossover() {
+                /*
+                    Size below which the Strassen-Winograd recursion hands over
+                    to the conventional kernel. Defaults to BOP_STRASSEN_CROSSOVER
+                    and may be tuned at runtime, e.g. from the crossover reported
+                    by matrix_benchmark.
+                */
+                static uint_type crossover = BOP_STRASSEN_CROSSOVER;
+                return crossover;
+            }
+
+            template<class T>
+            inline void blockAdd(uint_type rows, uint_type cols, const T* a, uint_type lda, const T* b, uint_type ldb, T* out, uint_type ldo) {
+                for (uint_type row = 0; row < rows; row++) {
+                    for (uint_type col = 0; col < cols; col++) out[(row * ldo) + col] = a[(row * lda) + col] + b[(row * ldb) + col];
+                }
+            }
+
+            template<class T>
+            inline void blockSubtract(uint_type rows, uint_type cols, const T* a, uint_type lda, const T* b, uint_type ldb, T* out, uint_type ldo) {
+                for (uint_type row = 0; row < rows; row++) {
+                    for (uint_type col = 0; col < cols; col++) out[(row * ldo) + col] = a[(row * lda) + col] - b[(row * ldb) + col];
+                }
+            }
+
+            template<class T>
+            void gemmStrassen(uint_type m, uint_type n, uint_type k,
+                              const T* a, uint_type lda, const T* b, uint_type ldb,
+                              T* c, uint_type ldc, uint_type crossover = strassenCrossover()) {
+                /*
+                    C = A*B by the Strassen-Winograd recursion (7 half-size
+                    products and 15 block additions per level), falling back on
+                    gemm once any dimension is below the crossover.
+
+                    Odd dimensions are handled by peeling: the recursion runs
+                    on the even leading part and the last row, column or rank
+                    one update left over is added with the conventional kernel,
+                    so no padding to a power of two is ever made.
+                */
+                if (m < crossover || n < crossover || k < crossover || m < 2 || n < 2 || k < 2) {
+                    gemm(m, n, k, T(1), a, lda, 1, b, ldb, 1, T(0), c, ldc);
+                    return;
+                }
+                const uint_type m2 = m / 2;
+                const uint_type n2 = n / 2;
+                const uint_type k2 = k / 2;
+                const T* a11 = a;
+                const T* a12 = a + k2;
+                const T* a21 = a + (m2 * lda);
+                const T* a22 = a + (m2 * lda) + k2;
+                const T* b11 = b;
+                const T* b12 = b + n2;
+                const T* b21 = b + (k2 * ldb);
+                const T* b22 = b + (k2 * ldb) + n2;
+                T* c11 = c;
+                T* c12 = c + n2;
+                T* c21 = c + (m2 * ldc);
+                T* c22 = c + (m2 * ldc) + n2;
+                /*
+                    Three temporaries are enough when the quadrants of C are
+                    used as workspace for the products.
+                */
+                std::vector<T> x(m2 * k2), y(k2 * n2), z(m2 * n2);
+                blockSubtract(m2, k2, a11, lda, a21, lda, x.data(), k2);                  //S3 = A11 - A21
+                blockSubtract(k2, n2, b22, ldb, b12, ldb, y.data(), n2);                  //T3 = B22 - B12
+                gemmStrassen(m2, n2, k2, x.data(), k2, y.data(), n2, c21, ldc, crossover); //P7 = S3*T3
+                blockAdd(m2, k2, a21, lda, a22, lda, x.data(), k2);                       //S1 = A21 + A22
+                blockSubtract(k2, n2, b12, ldb, b11, ldb, y.data(), n2);                  //T1 = B12 - B11
+                gemmStrassen(m2, n2, k2, x.data(), k2, y.data(), n2, c22, ldc, crossover); //P5 = S1*T1
+                blockSubtract(m2, k2, x.data(), k2, a11, lda, x.data(), k2);              //S2 = S1 - A11
+                blockSubtract(k2, n2, b22, ldb, y.data(), n2, y.data(), n2);              //T2 = B22 - T1
+                gemmStrassen(m2, n2, k2, x.data(), k2, y.data(), n2, c12, ldc, crossover); //P6 = S2*T2
+                blockSubtract(m2, k2, a12, lda, x.data(), k2, x.data(), k2);              //S4 = A12 - S2
+                gemmStrassen(m2, n2, k2, a11, lda, b11, ldb, c11, ldc, crossover);         //P1 = A11*B11
+                blockAdd(m2, n2, c12, ldc, c11, ldc, c12, ldc);                           //U2 = P1 + P6
+                blockAdd(m2, n2, c21, ldc, c12, ldc, c21, ldc);                           //U3 = U2 + P7
+                blockAdd(m2, n2, c12, ldc, c22, ldc, c12, ldc);                           //U4 = U2 + P5
+                blockAdd(m2, n2, c22, ldc, c21, ldc, c22, ldc);                           //C22 = U3 + P5
+                gemmStrassen(m2, n2, k2, x.data(), k2, b22, ldb, z.data(), n2, crossover); //P3 = S4*B22
+                blockAdd(m2, n2, c12, ldc, z.data(), n2, c12, ldc);                       //C12 = U4 + P3
+                blockSubtract(k2, n2, y.data(), n2, b21, ldb, y.data(), n2);              //T4 = T2 - B21
+                gemmStrassen(m2, n2, k2, a22, lda, y.data(), n2, z.data(), n2, crossover); //P4 = A22*T4
+                blockSubtract(m2, n2, c21, ldc, z.data(), n2, c21, ldc);                  //C21 = U3 - P4
+                gemmStrassen(m2, n2, k2, a12, lda, b21, ldb, z.data(), n2, crossover);     //P2 = A12*B21
+                blockAdd(m2, n2, c11, ldc, z.data(), n2, c11, ldc);                       //C11 = P1 + P2
+                /*
+                    Peeling for odd dimensions.
+                */
+                if (k % 2 != 0) {
+                    gemm(2 * m2, 2 * n2, 1, T(1), a + (k - 1), lda, 1, b + ((k - 1) * ldb), ldb, 1, T(1), c, ldc);
+                }
+                if (n % 2 != 0) {
+                    gemm(m, 1, k, T(1), a, lda, 1, b + (n - 1), ldb, 1, T(0), c + (n - 1), ldc);
+                }
+                if (m % 2 != 0) {
+                    gemm(1, 2 * n2, k, T(1), a + ((m - 1) * lda), lda, 1, b, ldb, 1, T(0), c + ((m - 1) * ldc), ldc);
+                }
+            }
+        }
+    }
+}
+
+#endif
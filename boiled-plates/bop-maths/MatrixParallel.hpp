@@ -0,0 +1,332 @@
+#ifndef BOP_MATRIX_PARALLEL_HPP
+#define BOP_MATRIX_PARALLEL_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "../bop-defaults/types.hpp"
+#include "../bop-utility/ThreadPool.hpp"
+#include "MatrixKernels.hpp"
+#include "MatrixVectorKernels.hpp"
+#include "Matrix.hpp"
+#include "SparseMatrix.hpp"
+
+/*
+    Multi-threaded matrix kernels built on bop::util::ThreadPool.
+
+    The output is split into tiles that are each computed by the serial
+    packed kernel. The way every element is accumulated does not depend
+    on the tiling, so results are identical to the single-threaded product
+    whatever the number of threads.
+
+    Each call waits for its own tasks. Called from a task already running
+    on the same pool, the work is done inline on that worker instead, as
+    waiting there could leave every worker of the pool blocked.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+
+        inline util::ThreadPool& defaultThreadPool() {
+            /*
+                Library-wide pool used when no pool is given, created on first
+                use with one thread per hardware thread.
+            */
+            static util::ThreadPool pool(std::max<uint_type>(1, std::thread::hardware_concurrency()));
+            return pool;
+        }
+
+        namespace kernel {
+
+            template<class T>
+            struct SparseParallelThreshold {
+                /*
+                    Multiply-adds below which a sparse product is not worth
+                    handing to the pool.
+                */
+                static const uint_type nonzeros = 1 << 15;
+            };
+
+            template<class T>
+            struct GemvParallelThreshold {
+                /*
+                    Matrix elements below which a matrix-vector product is not
+                    worth handing to the pool.
+                */
+                static const uint_type elements = 1 << 16;
+            };
+
+            template<class T>
+            struct ParallelGemmTiling {
+                /*
+                    Tile of C handed to one task. The height matches the mc
+                    blocking of the serial kernel, and the width is chosen so
+                    that re-packing A for each tile costs a few percent of the
+                    tile's arithmetic.
+                */
+                static const uint_type rows = GemmBlocking<T>::mc;
+                static const uint_type cols = 512;
+            };
+
+            class TaskLatch {
+                /*
+                    Counts down the tasks of one parallel call so the caller can
+                    wait on its own work rather than on the whole pool.
+                */
+                private:
+                    std::mutex latch_mutex;
+                    std::condition_variable latch_released;
+                    uint_type remaining;
+                public:
+                    TaskLatch(uint_type count) : remaining(count) {
+                    }
+
+                    void countDown() {
+                        std::lock_guard<std::mutex> lock(this->latch_mutex);
+                        this->remaining--;
+                        if (this->remaining == 0) this->latch_released.notify_all();
+                    }
+
+                    void wait() {
+                        std::unique_lock<std::mutex> lock(this->latch_mutex);
+                        this->latch_released.wait(lock, [this]() -> bool {
+                            return this->remaining == 0;
+                        });
+                    }
+            };
+
+            template<class T>
+            inline void gemmTile(std::true_type, uint_type m, uint_type n, uint_type k, T alpha,
+                                 const T* a, uint_type rsa, uint_type csa,
+                                 const T* b, uint_type rsb, uint_type csb,
+                                 T beta, T* c, uint_type ldc) {
+                gemmBlocked(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+            }
+
+            template<class T>
+            inline void gemmTile(std::false_type, uint_type m, uint_type n, uint_type k, T alpha,
+                                 const T* a, uint_type rsa, uint_type csa,
+                                 const T* b, uint_type rsb, uint_type csb,
+                                 T beta, T* c, uint_type ldc) {
+                gemmNaive(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+            }
+
+            template<class T>
+            void gemmParallel(util::ThreadPool& pool, uint_type m, uint_type n, uint_type k, T alpha,
+                              const T* a, uint_type rsa, uint_type csa,
+                              const T* b, uint_type rsb, uint_type csb,
+                              T beta, T* c, uint_type ldc) {
+                /*
+                    C = alpha*A*B + beta*C computed tile by tile on a thread pool.
+                    Blocks until every tile has been written. The choice
+                    between the naive and the packed kernel that gemm makes
+                    on the whole product is kept for every tile, a small edge
+                    tile would otherwise be summed in a different order.
+                */
+                const uint_type tile_rows = ParallelGemmTiling<T>::rows;
+                const uint_type tile_cols = ParallelGemmTiling<T>::cols;
+                const uint_type tiles_down = (m + tile_rows - 1) / tile_rows;
+                const uint_type tiles_across = (n + tile_cols - 1) / tile_cols;
+                if (pool.numberOfThreads() < 2 || pool.onWorkerThread() || tiles_down * tiles_across < 2 || m * n * k < GemmTraits<T>::small_product) {
+                    gemm(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+                    return;
+                }
+                TaskLatch latch(tiles_down * tiles_across);
+                for (uint_type tile_row = 0; tile_row < m; tile_row += tile_rows) {
+                    for (uint_type tile_col = 0; tile_col < n; tile_col += tile_cols) {
+                        const uint_type rows = std::min(tile_rows, m - tile_row);
+                        const uint_type cols = std::min(tile_cols, n - tile_col);
+                        const T* a_tile = a + (tile_row * rsa);
+                        const T* b_tile = b + (tile_col * csb);
+                        T* c_tile = c + (tile_row * ldc) + tile_col;
+                        TaskLatch* latch_ptr = &latch;
+                        pool.addTask([=]() -> void {
+                            gemmTile(std::integral_constant<bool, GemmTraits<T>::blocked>(),
+                                     rows, cols, k, alpha, a_tile, rsa, csa, b_tile, rsb, csb, beta, c_tile, ldc);
+                            latch_ptr->countDown();
+                        });
+                    }
+                }
+                latch.wait();
+            }
+
+            template<class T>
+            void gemvParallel(util::ThreadPool& pool, uint_type m, uint_type n, uint_type count, T alpha,
+                              const T* a, uint_type lda,
+                              const T* x, uint_type ldx,
+                              T beta, T* y, uint_type ldy) {
+                /*
+                    gemvBatch with the rows of A split evenly between the
+                    threads. Every output element is still summed by one
+                    thread in the serial order, so results match gemvBatch.
+                */
+                const uint_type threads = pool.numberOfThreads();
+                if (threads < 2 || pool.onWorkerThread() || m < 8 || m * n < GemvParallelThreshold<T>::elements) {
+                    gemvBatch(m, n, count, alpha, a, lda, x, ldx, beta, y, ldy);
+                    return;
+                }
+                /*
+                    Ranges are kept to multiples of four rows so that only the
+                    last one runs the single row tail.
+                */
+                const uint_type range_rows = ((((m + threads - 1) / threads) + 3) / 4) * 4;
+                const uint_type ranges = (m + range_rows - 1) / range_rows;
+                TaskLatch latch(ranges);
+                for (uint_type row = 0; row < m; row += range_rows) {
+                    const uint_type rows = std::min(range_rows, m - row);
+                    const T* a_range = a + (row * lda);
+                    T* y_range = y + row;
+                    TaskLatch* latch_ptr = &latch;
+                    pool.addTask([=]() -> void {
+                        gemvBatch(rows, n, count, alpha, a_range, lda, x, ldx, beta, y_range, ldy);
+                        latch_ptr->countDown();
+                    });
+                }
+                latch.wait();
+            }
+
+            template<class T>
+            void gevmParallel(util::ThreadPool& pool, uint_type m, uint_type n, T alpha,
+                              const T* x, const T* a, uint_type lda, T beta, T* y) {
+                /*
+                    gevm with the columns of A, and so of y, split evenly
+                    between the threads.
+                */
+                const uint_type threads = pool.numberOfThreads();
+                const uint_type slice = GemvBlocking<T>::cols;
+                if (threads < 2 || pool.onWorkerThread() || n < 2 * slice || m * n < GemvParallelThreshold<T>::elements) {
+                    gevm(m, n, alpha, x, a, lda, beta, y);
+                    return;
+                }
+                const uint_type range_cols = std::max(slice, (n + threads - 1) / threads);
+                const uint_type ranges = (n + range_cols - 1) / range_cols;
+                TaskLatch latch(ranges);
+                for (uint_type col = 0; col < n; col += range_cols) {
+                    const uint_type cols = std::min(range_cols, n - col);
+                    const T* a_range = a + col;
+                    T* y_range = y + col;
+                    TaskLatch* latch_ptr = &latch;
+                    pool.addTask([=]() -> void {
+                        gevm(m, cols, alpha, x, a_range, lda, beta, y_range);
+                        latch_ptr->countDown();
+                    });
+                }
+                latch.wait();
+            }
+
+            template<class T>
+            void spmmParallel(util::ThreadPool& pool, uint_type height, uint_type columns,
+                              const uint_type* offsets, const uint_type* indices, const T* values,
+                              const T* b, uint_type ldb, T* c, uint_type ldc) {
+                /*
+                    C = S*B for a CSR matrix S, with the rows of S split into
+                    ranges holding roughly equal numbers of nonzeros, a few per
+                    thread so that uneven rows still balance.
+                */
+                const uint_type nonzeros = offsets[height];
+                const uint_type threshold = SparseParallelThreshold<T>::nonzeros;
+                const uint_type ranges = std::min<uint_type>(height, pool.numberOfThreads() * 4);
+                if (pool.numberOfThreads() < 2 || pool.onWorkerThread() || ranges < 2 || nonzeros * std::max<uint_type>(columns, 1) < threshold) {
+                    spmmRows(0, height, columns, offsets, indices, values, b, ldb, c, ldc);
+                    return;
+                }
+                TaskLatch latch(ranges);
+                uint_type row_begin = 0;
+                for (uint_type range = 0; range < ranges; range++) {
+                    /*
+                        The range ends at the first row whose offset reaches its
+                        share of the nonzeros, and the last range takes the rest.
+                    */
+                    const uint_type target = (nonzeros / ranges) * (range + 1);
+                    uint_type row_end = (range + 1 == ranges) ? height : std::lower_bound(offsets + row_begin, offsets + height, target) - offsets;
+                    TaskLatch* latch_ptr = &latch;
+                    pool.addTask([=]() -> void {
+                        spmmRows(row_begin, row_end, columns, offsets, indices, values, b, ldb, c, ldc);
+                        latch_ptr->countDown();
+                    });
+                    row_begin = row_end;
+                }
+                latch.wait();
+            }
+        }
+
+        template<class T>
+        Matrix<T> multiply(const Matrix<T>& mat1, const Matrix<T>& mat2, util::ThreadPool& pool = defaultThreadPool()) {
+            /*
+                Parallel counterpart of mat1 * mat2, the product is computed on
+                the given pool (or the library's default pool). mat1 is
+                returned unchanged if the shapes do not conform.
+            */
+            if (mat2.height() != mat1.width()) return mat1;
+            Matrix<T> mat_p(mat2.width(), mat1.height());
+            kernel::gemmParallel<T>(pool, mat1.height(), mat2.width(), mat1.width(), T(1),
+                                    mat1.rowData(0), mat1.stride(), 1,
+                                    mat2.rowData(0), mat2.stride(), 1,
+                                    T(0), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        void multiply(const Matrix<T>& mat, const Vector<T>& vec, Vector<T>& out, util::ThreadPool& pool = defaultThreadPool()) {
+            /*
+                Parallel counterpart of mat.apply(vec, out). out is only
+                reallocated if it is not already mat.height() long.
+            */
+            if (vec.size() != mat.width() || &vec == &out || mat.height() == 0) return;
+            if (out.size() != mat.height()) out = Vector<T>(mat.height());
+            kernel::gemvParallel<T>(pool, mat.height(), mat.width(), 1, T(1),
+                                    mat.rowData(0), mat.stride(), &vec[0], 0, T(0), &out[0], 0);
+        }
+
+        template<class T>
+        void multiplyTransposed(const Matrix<T>& mat, const Vector<T>& vec, Vector<T>& out, util::ThreadPool& pool = defaultThreadPool()) {
+            /*
+                Parallel counterpart of mat.applyTransposed(vec, out).
+            */
+            if (vec.size() != mat.height() || &vec == &out || mat.width() == 0) return;
+            if (out.size() != mat.width()) out = Vector<T>(mat.width());
+            kernel::gevmParallel<T>(pool, mat.height(), mat.width(), T(1), &vec[0], mat.rowData(0), mat.stride(), T(0), &out[0]);
+        }
+
+        template<class T>
+        void multiplyBatch(const Matrix<T>& mat, const Matrix<T>& vectors, Matrix<T>& out, util::ThreadPool& pool = defaultThreadPool()) {
+            /*
+                Parallel counterpart of mat.applyBatch(vectors, out), each
+                row of vectors being one vector.
+            */
+            if (vectors.width() != mat.width() || &vectors == &out || mat.height() == 0) return;
+            if (out.width() != mat.height() || out.height() != vectors.height()) out = Matrix<T>(mat.height(), vectors.height());
+            kernel::gemvParallel<T>(pool, mat.height(), mat.width(), vectors.height(), T(1),
+                                    mat.rowData(0), mat.stride(), vectors.rowData(0), vectors.stride(),
+                                    T(0), out.rowData(0), out.stride());
+        }
+
+        template<class T>
+        Matrix<T> multiply(const SparseMatrix<T>& sparse, const Matrix<T>& mat, util::ThreadPool& pool = defaultThreadPool()) {
+            /*
+                Parallel counterpart of sparse * mat, including the sparse
+                matrix-vector product when mat is a single column. CSC
+                matrices scatter into arbitrary rows of the product, so they
+                are multiplied serially, convert them with compressed() to
+                run in parallel.
+            */
+            Matrix<T> mat_p(mat.width(), sparse.height());
+            if (sparse.width() != mat.height()) return mat_p;
+            if (sparse.format() == SparseMatrix<T>::csc) {
+                sparse.multiply(mat.rowData(0), mat.width(), mat.stride(), mat_p.rowData(0), mat_p.stride());
+                return mat_p;
+            }
+            kernel::spmmParallel<T>(pool, sparse.height(), mat.width(),
+                                    sparse.offsetData().data(), sparse.indexData().data(), sparse.valueData().data(),
+                                    mat.rowData(0), mat.stride(), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+    }
+}
+
+#endif
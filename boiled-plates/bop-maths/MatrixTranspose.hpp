@@ -0,0 +1,278 @@
+#ifndef BOP_MATRIX_TRANSPOSE_HPP
+#define BOP_MATRIX_TRANSPOSE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include "../bop-defaults/types.hpp"
+#include "SIMD.hpp"
+
+/*
+    Transpose kernels for row-major matrices.
+
+    The work is split into small square blocks that are transposed in
+    registers by a SIMD micro-kernel (4x4 for double, 8x8 for float).
+    Outputs that fit in cache visit the blocks by a cache-oblivious
+    recursion, so the rows being read and the rows being written stay
+    resident at every level of the hierarchy. Larger outputs are written
+    with non-temporal stores instead.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            template<class T>
+            struct TransposeBlocking {
+                /*
+                    block is the side of the micro-kernel's tile and leaf the
+                    side below which the recursion stops splitting. Outputs of
+                    at least stream_bytes are written with non-temporal
+                    stores, as they will not fit in cache anyway and the
+                    scattered writes would otherwise read every destination
+                    line in first.
+                */
+                static const uint_type block = 4;
+                static const uint_type leaf = 16;
+                static const uint_type stream_bytes = 1 << 20;
+            };
+
+            template<>
+            struct TransposeBlocking<float> {
+                static const uint_type block = 8;
+                static const uint_type leaf = 16;
+                static const uint_type stream_bytes = 1 << 20;
+            };
+
+            template<class T>
+            void transposeBlockScalar(const T* src, uint_type lds, T* dst, uint_type ldd) {
+                const uint_type bs = TransposeBlocking<T>::block;
+                for (uint_type row = 0; row < bs; row++) {
+                    for (uint_type col = 0; col < bs; col++) dst[(col * ldd) + row] = src[(row * lds) + col];
+                }
+            }
+
+            #ifdef BOP_SIMD_X86
+            BOP_SIMD_TARGET("avx2") inline void transposeBlockAVX2(const double* src, uint_type lds, double* dst, uint_type ldd) {
+                /*
+                    4x4 doubles: interleave pairs of rows, then exchange the
+                    128-bit halves.
+                */
+                const __m256d r0 = _mm256_loadu_pd(src);
+                const __m256d r1 = _mm256_loadu_pd(src + lds);
+                const __m256d r2 = _mm256_loadu_pd(src + (2 * lds));
+                const __m256d r3 = _mm256_loadu_pd(src + (3 * lds));
+                const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+                const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+                const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+                const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+                _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+                _mm256_storeu_pd(dst + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+                _mm256_storeu_pd(dst + (2 * ldd), _mm256_permute2f128_pd(t0, t2, 0x31));
+                _mm256_storeu_pd(dst + (3 * ldd), _mm256_permute2f128_pd(t1, t3, 0x31));
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void transposeBlockAVX2(const float* src, uint_type lds, float* dst, uint_type ldd) {
+                /*
+                    8x8 floats: 32-bit then 64-bit interleaves within each
+                    128-bit lane, then the lanes are exchanged.
+                */
+                __m256 r[8];
+                __m256 t[8];
+                for (uint_type row = 0; row < 8; row++) r[row] = _mm256_loadu_ps(src + (row * lds));
+                for (uint_type pair = 0; pair < 8; pair += 2) {
+                    t[pair] = _mm256_unpacklo_ps(r[pair], r[pair + 1]);
+                    t[pair + 1] = _mm256_unpackhi_ps(r[pair], r[pair + 1]);
+                }
+                for (uint_type quad = 0; quad < 8; quad += 4) {
+                    r[quad] = _mm256_shuffle_ps(t[quad], t[quad + 2], 0x44);
+                    r[quad + 1] = _mm256_shuffle_ps(t[quad], t[quad + 2], 0xEE);
+                    r[quad + 2] = _mm256_shuffle_ps(t[quad + 1], t[quad + 3], 0x44);
+                    r[quad + 3] = _mm256_shuffle_ps(t[quad + 1], t[quad + 3], 0xEE);
+                }
+                for (uint_type row = 0; row < 4; row++) {
+                    _mm256_storeu_ps(dst + (row * ldd), _mm256_permute2f128_ps(r[row], r[row + 4], 0x20));
+                    _mm256_storeu_ps(dst + ((row + 4) * ldd), _mm256_permute2f128_ps(r[row], r[row + 4], 0x31));
+                }
+            }
+            #endif
+
+            template<class T>
+            struct TransposeKernels {
+                /*
+                    The block micro-kernel for a type, resolved once against
+                    simd::level().
+                */
+                typedef void (*block_function)(const T*, uint_type, T*, uint_type);
+
+                static block_function resolve(std::false_type) {
+                    return transposeBlockScalar<T>;
+                }
+
+                static block_function resolve(std::true_type) {
+                    #ifdef BOP_SIMD_X86
+                    if (simd::level() >= simd::avx2) return static_cast<block_function>(transposeBlockAVX2);
+                    #endif
+                    return transposeBlockScalar<T>;
+                }
+
+                typedef std::integral_constant<bool, std::is_same<T,float>::value || std::is_same<T,double>::value> vectorised;
+
+                static block_function block() {
+                    static const block_function function = resolve(vectorised());
+                    return function;
+                }
+            };
+
+            template<class T>
+            void transposeLeaf(uint_type rows, uint_type cols, const T* src, uint_type lds, T* dst, uint_type ldd) {
+                /*
+                    Whole tiles go through the micro-kernel, the ragged right
+                    and bottom edges are copied element by element.
+                */
+                const uint_type bs = TransposeBlocking<T>::block;
+                const typename TransposeKernels<T>::block_function block = TransposeKernels<T>::block();
+                const uint_type full_rows = rows - (rows % bs);
+                const uint_type full_cols = cols - (cols % bs);
+                for (uint_type row = 0; row < full_rows; row += bs) {
+                    for (uint_type col = 0; col < full_cols; col += bs) {
+                        block(src + (row * lds) + col, lds, dst + (col * ldd) + row, ldd);
+                    }
+                    for (uint_type sub_row = row; sub_row < row + bs; sub_row++) {
+                        for (uint_type col = full_cols; col < cols; col++) dst[(col * ldd) + sub_row] = src[(sub_row * lds) + col];
+                    }
+                }
+                for (uint_type row = full_rows; row < rows; row++) {
+                    for (uint_type col = 0; col < cols; col++) dst[(col * ldd) + row] = src[(row * lds) + col];
+                }
+            }
+
+            template<class T>
+            void transposeStreamLeaf(uint_type rows, uint_type cols, const T* src, uint_type lds, T* dst, uint_type ldd) {
+                /*
+                    Transposes the leaf into a buffer, then streams each of its
+                    rows out to the destination.
+                */
+                const uint_type leaf = TransposeBlocking<T>::leaf;
+                alignas(64) T buffer[leaf * leaf];
+                transposeLeaf(rows, cols, src, lds, buffer, leaf);
+                for (uint_type row = 0; row < cols; row++) stream(rows, buffer + (row * leaf), dst + (row * ldd));
+            }
+
+            template<class T>
+            void transposeRecurse(uint_type rows, uint_type cols, const T* src, uint_type lds, T* dst, uint_type ldd) {
+                /*
+                    Halves the longer side (on a leaf boundary) until the piece
+                    fits a leaf, which keeps the working set cache sized at
+                    every level without depending on the cache sizes.
+                */
+                const uint_type leaf = TransposeBlocking<T>::leaf;
+                if (rows <= leaf && cols <= leaf) {
+                    transposeLeaf(rows, cols, src, lds, dst, ldd);
+                }
+                else if (rows >= cols) {
+                    const uint_type half = std::max(leaf, ((rows / 2) / leaf) * leaf);
+                    transposeRecurse(half, cols, src, lds, dst, ldd);
+                    transposeRecurse(rows - half, cols, src + (half * lds), lds, dst + half, ldd);
+                }
+                else {
+                    const uint_type half = std::max(leaf, ((cols / 2) / leaf) * leaf);
+                    transposeRecurse(rows, half, src, lds, dst, ldd);
+                    transposeRecurse(rows, cols - half, src + half, lds, dst + (half * ldd), ldd);
+                }
+            }
+
+            template<class T>
+            void transposeStream(uint_type rows, uint_type cols, const T* src, uint_type lds, T* dst, uint_type ldd) {
+                /*
+                    Walks the source a band of leaf rows at a time. The
+                    streamed stores do not go through the cache, so the
+                    scattered destination costs nothing to keep resident.
+                */
+                const uint_type leaf = TransposeBlocking<T>::leaf;
+                for (uint_type row = 0; row < rows; row += leaf) {
+                    const uint_type band = std::min(leaf, rows - row);
+                    for (uint_type col = 0; col < cols; col += leaf) {
+                        transposeStreamLeaf(band, std::min(leaf, cols - col), src + (row * lds) + col, lds, dst + (col * ldd) + row, ldd);
+                    }
+                }
+                streamFence();
+            }
+
+            template<class T>
+            void transposeCopy(uint_type rows, uint_type cols, const T* src, uint_type lds, T* dst, uint_type ldd) {
+                /*
+                    dst = src^T, for the rows by cols matrix at src.
+
+                    Streaming only pays off when every leaf writes whole cache
+                    lines, so it is used for large outputs whose rows all
+                    share the same alignment. Source rows are peeled off until
+                    the destination reaches a line boundary.
+                */
+                const uint_type line = 64 / sizeof(T);
+                const bool streaming = (rows * cols * sizeof(T)) >= TransposeBlocking<T>::stream_bytes
+                                    && (ldd % line) == 0 && (reinterpret_cast<uintptr_t>(dst) % sizeof(T)) == 0;
+                if (!streaming) {
+                    transposeRecurse(rows, cols, src, lds, dst, ldd);
+                    return;
+                }
+                const uint_type misalign = (reinterpret_cast<uintptr_t>(dst) / sizeof(T)) % line;
+                const uint_type peel = std::min<uint_type>(rows, (line - misalign) % line);
+                if (peel > 0) transposeLeaf(peel, cols, src, lds, dst, ldd);
+                transposeStream(rows - peel, cols, src + (peel * lds), lds, dst + peel, ldd);
+            }
+
+            template<class T>
+            void transposeSquareInPlace(uint_type n, T* a, uint_type lda) {
+                /*
+                    In-place transpose of an n by n matrix by swapping pairs
+                    of leaf tiles across the diagonal. Each tile of a pair is
+                    transposed into a small buffer first, so the pair is only
+                    read and written once.
+                */
+                const uint_type leaf = TransposeBlocking<T>::leaf;
+                if (n < leaf) {
+                    /*
+                        Small matrices are already in cache, plain swaps win.
+                    */
+                    for (uint_type row = 0; row < n; row++) {
+                        for (uint_type col = row + 1; col < n; col++) std::swap(a[(row * lda) + col], a[(col * lda) + row]);
+                    }
+                    return;
+                }
+                T upper[leaf * leaf];
+                T lower[leaf * leaf];
+                for (uint_type row = 0; row < n; row += leaf) {
+                    const uint_type rows = std::min(leaf, n - row);
+                    /*
+                        Tile on the diagonal.
+                    */
+                    transposeLeaf(rows, rows, a + (row * lda) + row, lda, upper, leaf);
+                    for (uint_type sub_row = 0; sub_row < rows; sub_row++) {
+                        std::copy(upper + (sub_row * leaf), upper + (sub_row * leaf) + rows, a + ((row + sub_row) * lda) + row);
+                    }
+                    for (uint_type col = row + leaf; col < n; col += leaf) {
+                        const uint_type cols = std::min(leaf, n - col);
+                        T* above = a + (row * lda) + col;
+                        T* below = a + (col * lda) + row;
+                        transposeLeaf(rows, cols, above, lda, upper, leaf);
+                        transposeLeaf(cols, rows, below, lda, lower, leaf);
+                        for (uint_type sub_row = 0; sub_row < cols; sub_row++) {
+                            std::copy(upper + (sub_row * leaf), upper + (sub_row * leaf) + rows, below + (sub_row * lda));
+                        }
+                        for (uint_type sub_row = 0; sub_row < rows; sub_row++) {
+                            std::copy(lower + (sub_row * leaf), lower + (sub_row * leaf) + cols, above + (sub_row * lda));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef BOP_MATRIX_VECTOR_KERNELS_HPP
+#define BOP_MATRIX_VECTOR_KERNELS_HPP
+
+#include <algorithm>
+#include "../bop-defaults/types.hpp"
+#include "SIMD.hpp"
+
+/*
+    Matrix-vector products (GEMV and GEVM) on row-major buffers.
+
+    A matrix-vector product does one multiply-add per element of the
+    matrix, so it is bound by the rate the matrix streams in from memory
+    and the aim is to read every element of it exactly once. The matrix
+    is taken four rows at a time against a slice of the vectors that
+    stays in cache, so the vectors are reused from cache and only the
+    matrix comes from memory. Several vectors can share one sweep.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            template<class T>
+            struct GemvBlocking {
+                /*
+                    Columns of the matrix taken per slice. Four rows of a slice
+                    and the slice of each vector fit in L2, and a slice of the
+                    GEVM output fits in L1.
+                */
+                static const uint_type cols = 16384 / sizeof(T);
+            };
+
+            template<class T>
+            void gemvBatch(uint_type m, uint_type n, uint_type count, T alpha,
+                           const T* a, uint_type lda,
+                           const T* x, uint_type ldx,
+                           T beta, T* y, uint_type ldy) {
+                /*
+                    y_v = alpha*A*x_v + beta*y_v for the count vectors x_v at
+                    x + v*ldx (n long) and y_v at y + v*ldy (m long), with one
+                    pass over the m by n matrix A. y is not read when beta is
+                    zero.
+                */
+                const uint_type slice = GemvBlocking<T>::cols;
+                if (n == 0) {
+                    for (uint_type vec = 0; vec < count; vec++) {
+                        T* y_vec = y + (vec * ldy);
+                        for (uint_type row = 0; row < m; row++) y_vec[row] = (beta == T(0)) ? T(0) : beta * y_vec[row];
+                    }
+                    return;
+                }
+                for (uint_type col = 0; col < n; col += slice) {
+                    const uint_type width = std::min(slice, n - col);
+                    const bool first = (col == 0);
+                    uint_type row = 0;
+                    for (; row + 4 <= m; row += 4) {
+                        const T* a_rows = a + (row * lda) + col;
+                        for (uint_type vec = 0; vec < count; vec++) {
+                            T sums[4];
+                            dot4(width, a_rows, lda, x + (vec * ldx) + col, sums);
+                            T* y_rows = y + (vec * ldy) + row;
+                            for (uint_type elem = 0; elem < 4; elem++) {
+                                if (!first) y_rows[elem] += alpha * sums[elem];
+                                else if (beta == T(0)) y_rows[elem] = alpha * sums[elem];
+                                else y_rows[elem] = (alpha * sums[elem]) + (beta * y_rows[elem]);
+                            }
+                        }
+                    }
+                    for (; row < m; row++) {
+                        const T* a_row = a + (row * lda) + col;
+                        for (uint_type vec = 0; vec < count; vec++) {
+                            const T sum = dot(width, a_row, x + (vec * ldx) + col);
+                            T& y_elem = y[(vec * ldy) + row];
+                            if (!first) y_elem += alpha * sum;
+                            else if (beta == T(0)) y_elem = alpha * sum;
+                            else y_elem = (alpha * sum) + (beta * y_elem);
+                        }
+                    }
+                }
+            }
+
+            template<class T>
+            inline void gemv(uint_type m, uint_type n, T alpha, const T* a, uint_type lda, const T* x, T beta, T* y) {
+                /*
+                    y = alpha*A*x + beta*y for contiguous x and y.
+                */
+                gemvBatch(m, n, 1, alpha, a, lda, x, 0, beta, y, 0);
+            }
+
+            template<class T>
+            void gevm(uint_type m, uint_type n, T alpha, const T* x, const T* a, uint_type lda, T beta, T* y) {
+                /*
+                    y = alpha*x^T*A + beta*y, the product of a row vector with
+                    the m by n matrix A, without transposing A. Each slice of y
+                    stays in L1 while every row of A adds its multiple of x to
+                    it.
+                */
+                const uint_type slice = GemvBlocking<T>::cols;
+                if (beta == T(0)) std::fill(y, y + n, T(0));
+                else if (beta != T(1)) scal(n, beta, y);
+                for (uint_type col = 0; col < n; col += slice) {
+                    const uint_type width = std::min(slice, n - col);
+                    for (uint_type row = 0; row < m; row++) {
+                        if (x[row] != T(0)) axpy(width, alpha * x[row], a + (row * lda) + col, y + col);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef BOP_MATRIX_VIEW_HPP
+#define BOP_MATRIX_VIEW_HPP
+
+#include <algorithm>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "SIMD.hpp"
+#include "MatrixExpression.hpp"
+
+/*
+    bop::maths::MatrixView class file
+
+    A non-owning, strided window onto row-major storage: a pointer, a
+    width and height, and the stride (leading dimension) between the
+    starts of consecutive rows. Rows, columns and blocks of a Matrix can
+    be handed out as views without allocating, and written to or
+    operated on in place.
+
+    Copying a view copies the window, but assigning to a view writes
+    the assigned values into the elements it refers to, like
+    Matrix::impose. A view must not outlive the storage it refers to.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        template<class T>
+        class LUDecomposition;
+
+        template<class T>
+        class MatrixView : public MatrixExpression< MatrixView<T> > {
+            protected:
+                T* view_data;
+                uint_type view_width;
+                uint_type view_height;
+                uint_type view_stride;
+
+                template<class F>
+                inline MatrixView<T>& forEachSharedRow(const MatrixView<T>& view, F function) {
+                    /*
+                        Calls function(count, source_row, destination_row) over
+                        the region this view shares with another.
+                    */
+                    const uint_type cols = std::min(this->width(), view.width());
+                    for (uint_type row = 0; row < this->height() && row < view.height(); row++) {
+                        function(cols, view.data() + (row * view.stride()), this->view_data + (row * this->view_stride));
+                    }
+                    return *this;
+                }
+
+            public:
+                typedef T value_type;
+
+                //Constructors
+                MatrixView() : view_data(nullptr), view_width(0), view_height(0), view_stride(0) {
+                }
+
+                MatrixView(T* data, uint_type width, uint_type height, uint_type stride) :
+                    view_data(data), view_width(width), view_height(height), view_stride(stride) {
+                }
+
+                MatrixView(T* data, uint_type width, uint_type height) : MatrixView(data, width, height, width) {
+                }
+
+                MatrixView(const Matrix<T>& mat) : MatrixView(mat.rowData(0), mat.width(), mat.height(), mat.stride()) {
+                    /*
+                        The whole of a matrix.
+                    */
+                }
+
+                MatrixView(const MatrixView<T>& view) = default;
+
+                //Assignment, writes through to the viewed elements
+
+                MatrixView<T>& operator= (const MatrixView<T>& view) {
+                    /*
+                        Copies the elements of another view into the region the
+                        two share.
+                    */
+                    return this->forEachSharedRow(view, [](uint_type count, const T* source, T* destination) -> void {
+                        std::copy(source, source + count, destination);
+                    });
+                }
+
+                MatrixView<T>& operator= (const Matrix<T>& mat) {
+                    return (*this) = MatrixView<T>(mat);
+                }
+
+                template<class E>
+                MatrixView<T>& operator= (const MatrixExpression<E>& expr) {
+                    /*
+                        Evaluates an expression straight into the viewed
+                        elements. Only elements inside the expression's shape
+                        are written.
+                    */
+                    const E& expression = expr.expression();
+                    for (uint_type row = 0; row < this->height() && row < expression.height(); row++) {
+                        T* destination = this->view_data + (row * this->view_stride);
+                        for (uint_type col = 0; col < this->width() && col < expression.width(); col++) {
+                            destination[col] = static_cast<T>(expression.element(row,col));
+                        }
+                    }
+                    return *this;
+                }
+
+                MatrixView<T>& fill(const T value) {
+                    for (uint_type row = 0; row < this->height(); row++) {
+                        std::fill(this->view_data + (row * this->view_stride), this->view_data + (row * this->view_stride) + this->width(), value);
+                    }
+                    return *this;
+                }
+
+                //Arithmetic overloads, each row goes through the vector kernels
+
+                MatrixView<T>& operator+= (const MatrixView<T>& view) {
+                    return this->forEachSharedRow(view, [](uint_type count, const T* source, T* destination) -> void {
+                        kernel::axpy<T>(count, T(1), source, destination);
+                    });
+                }
+
+                MatrixView<T>& operator-= (const MatrixView<T>& view) {
+                    return this->forEachSharedRow(view, [](uint_type count, const T* source, T* destination) -> void {
+                        kernel::axpy<T>(count, T(-1), source, destination);
+                    });
+                }
+
+                MatrixView<T>& operator+= (const Matrix<T>& mat) {
+                    return (*this) += MatrixView<T>(mat);
+                }
+
+                MatrixView<T>& operator-= (const Matrix<T>& mat) {
+                    return (*this) -= MatrixView<T>(mat);
+                }
+
+                template<class E>
+                MatrixView<T>& operator+= (const MatrixExpression<E>& expr) {
+                    return (*this) = (*this) + expr.expression();
+                }
+
+                template<class E>
+                MatrixView<T>& operator-= (const MatrixExpression<E>& expr) {
+                    return (*this) = (*this) - expr.expression();
+                }
+
+                MatrixView<T>& operator*= (const T scalar) {
+                    for (uint_type row = 0; row < this->height(); row++) {
+                        kernel::scal<T>(this->width(), scalar, this->view_data + (row * this->view_stride));
+                    }
+                    return *this;
+                }
+
+                MatrixView<T>& operator/= (const T scalar) {
+                    /*
+                        Like Matrix::operator/=, dividing by zero leaves the
+                        elements unchanged.
+                    */
+                    if (scalar != 0) (*this) *= (1/scalar);
+                    return *this;
+                }
+
+                //Fused multiply-accumulate
+
+                bool multiplyAdd(const MatrixView<T>& a, const MatrixView<T>& b, T alpha = T(1), T beta = T(1),
+                                 bool transpose_a = false, bool transpose_b = false) const {
+                    /*
+                        this = alpha * op(a) * op(b) + beta * this, where op()
+                        transposes its operand if asked to. Transposes are
+                        read through the operands' strides rather than
+                        formed, and nothing is allocated unless a or b shares
+                        storage with this view. beta = 0 overwrites the view
+                        without reading it. Returns false, leaving the view
+                        untouched, if the shapes do not conform.
+                    */
+                    const uint_type m = transpose_a ? a.width() : a.height();
+                    const uint_type k = transpose_a ? a.height() : a.width();
+                    const uint_type n = transpose_b ? b.height() : b.width();
+                    if ((transpose_b ? b.width() : b.height()) != k || m != this->height() || n != this->width()) return false;
+                    const uint_type rsa = transpose_a ? 1 : a.stride();
+                    const uint_type csa = transpose_a ? a.stride() : 1;
+                    const uint_type rsb = transpose_b ? 1 : b.stride();
+                    const uint_type csb = transpose_b ? b.stride() : 1;
+                    if (!this->overlaps(a) && !this->overlaps(b)) {
+                        kernel::gemm<T>(m, n, k, alpha, a.data(), rsa, csa, b.data(), rsb, csb, beta, this->view_data, this->view_stride);
+                        return true;
+                    }
+                    /*
+                        The kernel would overwrite operands it has yet to read,
+                        so the product is formed aside first.
+                    */
+                    Matrix<T> product(n, m);
+                    kernel::gemm<T>(m, n, k, T(1), a.data(), rsa, csa, b.data(), rsb, csb, T(0), product.rowData(0), product.stride());
+                    for (uint_type row = 0; row < m; row++) {
+                        T* destination = this->view_data + (row * this->view_stride);
+                        if (beta == T(0)) std::fill(destination, destination + n, T(0));
+                        else if (beta != T(1)) kernel::scal<T>(n, beta, destination);
+                        kernel::axpy<T>(n, alpha, product.rowData(row), destination);
+                    }
+                    return true;
+                }
+
+                //Information functions
+
+                inline T& element(uint_type row, uint_type col) const {
+                    return this->view_data[(row * this->view_stride) + col];
+                }
+
+                inline T& element(uint_type elem) const {
+                    /*
+                        Flat index, only meaningful for contiguous views.
+                    */
+                    return this->view_data[elem];
+                }
+
+                inline T* data() const {
+                    return this->view_data;
+                }
+
+                inline uint_type width() const {
+                    return this->view_width;
+                }
+
+                inline uint_type height() const {
+                    return this->view_height;
+                }
+
+                inline uint_type stride() const {
+                    /*
+                        Elements between the starts of consecutive rows.
+                    */
+                    return this->view_stride;
+                }
+
+                inline bool contiguous() const {
+                    return (this->view_stride == this->view_width || this->view_height <= 1);
+                }
+
+                inline bool square() const {
+                    return (this->width() == this->height());
+                }
+
+                inline bool conformant(uint_type width, uint_type height) const {
+                    /*
+                        Expressions may only index a view flatly when its rows
+                        are packed.
+                    */
+                    return (this->width() == width && this->height() == height && this->contiguous());
+                }
+
+                inline bool valid() const {
+                    return (this->view_data != nullptr);
+                }
+
+                inline bool overlaps(const MatrixView<T>& view) const {
+                    /*
+                        True if the spans of memory the two views cover
+                        intersect, which includes views interleaved within the
+                        same rows without sharing an element.
+                    */
+                    if (this->width() == 0 || this->height() == 0 || view.width() == 0 || view.height() == 0) return false;
+                    const T* end = this->view_data + ((this->height() - 1) * this->view_stride) + this->width();
+                    const T* view_end = view.data() + ((view.height() - 1) * view.stride()) + view.width();
+                    return (this->view_data < view_end && view.data() < end);
+                }
+
+                inline Matrix<T> eval() const {
+                    return Matrix<T>(*this);
+                }
+
+                LUDecomposition<T> factorize() const {
+                    return LUDecomposition<T>(*this);
+                }
+
+                //Sub-views
+
+                inline MatrixView<T> row(uint_type index) const {
+                    return MatrixView<T>(this->view_data + (index * this->view_stride), this->width(), 1, this->view_stride);
+                }
+
+                inline MatrixView<T> column(uint_type index) const {
+                    return MatrixView<T>(this->view_data + index, 1, this->height(), this->view_stride);
+                }
+
+                inline MatrixView<T> block(uint_type row_off, uint_type col_off, uint_type width, uint_type height) const {
+                    /*
+                        The width by height block whose top left element is at
+                        (row_off, col_off), clipped to this view.
+                    */
+                    row_off = std::min(row_off, this->height());
+                    col_off = std::min(col_off, this->width());
+                    return MatrixView<T>(this->view_data + (row_off * this->view_stride) + col_off,
+                                         std::min(width, this->width() - col_off),
+                                         std::min(height, this->height() - row_off),
+                                         this->view_stride);
+                }
+        };
+
+        //Products of views go straight to the multiply kernel
+
+        template<class T>
+        Matrix<T> operator* (const MatrixView<T>& view1, const MatrixView<T>& view2) {
+            /*
+                If view2's height is not view1's width the product is
+                undefined, and a copy of view1 is returned.
+            */
+            if (view2.height() != view1.width()) return Matrix<T>(view1);
+            Matrix<T> mat_p(view2.width(), view1.height());
+            kernel::gemm<T>(view1.height(), view2.width(), view1.width(), T(1),
+                            view1.data(), view1.stride(), 1,
+                            view2.data(), view2.stride(), 1,
+                            T(0), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const Matrix<T>& mat, const MatrixView<T>& view) {
+            return MatrixView<T>(mat) * view;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const MatrixView<T>& view, const Matrix<T>& mat) {
+            return view * MatrixView<T>(mat);
+        }
+
+        template<class T>
+        bool operator== (const MatrixView<T>& view1, const MatrixView<T>& view2) {
+            if (view1.width() != view2.width() || view1.height() != view2.height()) return false;
+            for (uint_type row = 0; row < view1.height(); row++) {
+                if (!std::equal(view1.data() + (row * view1.stride()), view1.data() + (row * view1.stride()) + view1.width(), view2.data() + (row * view2.stride()))) return false;
+            }
+            return true;
+        }
+
+        template<class T>
+        bool operator!= (const MatrixView<T>& view1, const MatrixView<T>& view2) {
+            return !(view1 == view2);
+        }
+    }
+}
+
+#endif
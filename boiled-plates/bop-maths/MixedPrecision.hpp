@@ -0,0 +1,184 @@
+#ifndef BOP_MIXED_PRECISION_HPP
+#define BOP_MIXED_PRECISION_HPP
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <mutex>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "SIMD.hpp"
+#include "Matrix.hpp"
+#include "LUDecomposition.hpp"
+
+/*
+    bop::maths mixed precision file
+
+    Products of matrices stored in float but accumulated in double, and
+    linear solves that do the O(n^3) factorization in the narrow type and
+    recover full accuracy by iterative refinement in the wide one: each
+    step solves for a correction with the narrow factors against a
+    residual formed in the wide type. For matrices with a condition number
+    well below 1/epsilon of the narrow type this converges in a few O(n^2)
+    steps to the accuracy of a solve in the wide type.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T = double, class S>
+        Matrix<T> mixedMultiply(const Matrix<S>& mat1, const Matrix<S>& mat2) {
+            /*
+                The product of two matrices stored as S, accumulated and
+                returned as T.
+            */
+            Matrix<T> mat_p(mat2.width(), mat1.height());
+            kernel::gemmMixed<T,S>(mat1.height(), mat2.width(), mat1.width(), T(1),
+                                   mat1.rowData(0), mat1.stride(), 1,
+                                   mat2.rowData(0), mat2.stride(), 1,
+                                   T(0), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        struct RefinementStatistics {
+            /*
+                Refinement steps taken by one solve, and whether it converged
+                rather than falling back to factoring in the wide type.
+            */
+            uint_type iterations;
+            bool refined;
+        };
+
+        template<class T, class L = float>
+        class MixedPrecisionLU {
+            /*
+                Solves only read the factorization, so one object may be
+                shared by threads solving at the same time.
+            */
+            protected:
+                Matrix<T> system;
+                T system_norm;
+                LUDecomposition<L> factors;
+                /*
+                    Only formed, once, if refinement fails to converge.
+                */
+                mutable LUDecomposition<T> fallback;
+                mutable std::once_flag fallback_formed;
+
+                Matrix<T> refine(const Matrix<T>& b, RefinementStatistics& stats) const {
+                    /*
+                        Stops once every column's residual is below
+                        sqrt(n) * epsilon * ||A|| * ||x|| in T, the test of
+                        LAPACK's dsgesv.
+                    */
+                    const uint_type n = this->system.height();
+                    const uint_type columns = b.width();
+                    const T threshold = std::sqrt(T(n)) * std::numeric_limits<T>::epsilon() * this->system_norm;
+                    Matrix<L> low(b);
+                    this->factors.solveInPlace(low.rowData(0), columns, low.stride());
+                    Matrix<T> x(low), residual(columns, n);
+                    for (uint_type iter = 0; iter <= max_iterations; iter++) {
+                        for (uint_type row = 0; row < n; row++) std::copy(b.rowData(row), b.rowData(row) + columns, residual.rowData(row));
+                        kernel::gemm<T>(n, columns, n, T(-1),
+                                        this->system.rowData(0), this->system.stride(), 1,
+                                        x.rowData(0), x.stride(), 1,
+                                        T(1), residual.rowData(0), residual.stride());
+                        bool converged = true, finite = true;
+                        for (uint_type col = 0; col < columns; col++) {
+                            T residual_norm = T(0), x_norm = T(0);
+                            for (uint_type row = 0; row < n; row++) {
+                                residual_norm = std::max(residual_norm, std::abs(residual.element(row,col)));
+                                x_norm = std::max(x_norm, std::abs(x.element(row,col)));
+                            }
+                            converged = converged && residual_norm <= threshold * x_norm;
+                            finite = finite && std::isfinite(residual_norm);
+                        }
+                        stats.iterations = iter;
+                        if (converged) {
+                            stats.refined = true;
+                            return x;
+                        }
+                        if (!finite || iter == max_iterations) break;
+                        /*
+                            The correction is solved for in L and added in T.
+                        */
+                        for (uint_type row = 0; row < n; row++) kernel::convert<T,L>(columns, residual.rowData(row), low.rowData(row));
+                        this->factors.solveInPlace(low.rowData(0), columns, low.stride());
+                        for (uint_type row = 0; row < n; row++) {
+                            T* x_row = x.rowData(row);
+                            const L* d_row = low.rowData(row);
+                            for (uint_type col = 0; col < columns; col++) x_row[col] += T(d_row[col]);
+                        }
+                    }
+                    /*
+                        Too ill-conditioned for the narrow factors, solve in T.
+                    */
+                    stats.refined = false;
+                    std::call_once(this->fallback_formed, [this, n]() {
+                        this->fallback.factorize(this->system.rowData(0), n, this->system.stride());
+                    });
+                    return this->fallback.solve(b);
+                }
+
+            public:
+                /*
+                    Refinement steps taken before giving up on the narrow
+                    factors.
+                */
+                static const uint_type max_iterations = 30;
+
+                MixedPrecisionLU(const Matrix<T>& mat) :
+                    system(mat), system_norm(0), factors(Matrix<L>(mat)) {
+                    for (uint_type row = 0; row < mat.height(); row++) {
+                        T sum = T(0);
+                        for (uint_type col = 0; col < mat.width(); col++) sum += std::abs(mat.element(row,col));
+                        this->system_norm = std::max(this->system_norm, sum);
+                    }
+                }
+
+                inline uint_type size() const {
+                    return this->system.height();
+                }
+
+                inline bool singular() const {
+                    return this->factors.singular();
+                }
+
+                Matrix<T> solve(const Matrix<T>& b, RefinementStatistics& stats) const {
+                    /*
+                        b is returned unchanged if it does not have size()
+                        rows.
+                    */
+                    stats.iterations = 0;
+                    stats.refined = true;
+                    if (b.height() != this->size()) return b;
+                    return this->refine(b, stats);
+                }
+
+                Matrix<T> solve(const Matrix<T>& b) const {
+                    RefinementStatistics stats;
+                    return this->solve(b, stats);
+                }
+
+                Matrix<T> solve(const MatrixView<T>& b) const {
+                    RefinementStatistics stats;
+                    return this->solve(Matrix<T>(b), stats);
+                }
+        };
+
+        template<class T>
+        Matrix<T> refinedSolve(const Matrix<T>& a, const Matrix<T>& b) {
+            /*
+                X such that AX = B, factoring A in float and refining in T,
+                which halves the memory traffic of the factorization.
+            */
+            return MixedPrecisionLU<T>(a).solve(b);
+        }
+    }
+}
+
+#endif
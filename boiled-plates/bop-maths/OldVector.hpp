@@ -1,6 +1,7 @@
 #ifndef BOP_VECTOR_HPP
 #define BOP_VECTOR_HPP
 
+#include <cstdlib>
 #include <cstring>
 #include <initializer_list>
 #include <string>
@@ -92,12 +93,13 @@ namespace bop {
                     memcpy(this->data, vec.data, vec.size() * sizeof(T));
                 }
 
-                Vector(Vector<T>&& vec) : Vector() {
+                Vector(Vector<T>&& vec) noexcept : Vector() {
                     /*
-                        Move constructor.
+                        Move constructor, takes the data array of the given
+                        Vector and leaves it empty.
                     */
-                    this->width = vec.width;
-                    this->pivot_index = vec.pivot_index;
+                    std::swap(this->width, vec.width);
+                    std::swap(this->pivot_index, vec.pivot_index);
                     std::swap(this->data, vec.data);
                 }
 
@@ -114,8 +116,8 @@ namespace bop {
                 //Destructor
 
                 ~Vector() {
-                    //Manual deletion of data array.
-                    if (this->data != nullptr) delete[] this->data;
+                    //Manual deletion of data array, allocated by realloc in setData.
+                    if (this->data != nullptr) free(this->data);
                 }
 
                 //Operator Overloads
@@ -132,13 +134,24 @@ namespace bop {
                     /*
                         Copy assignment, synonymous to the copy constructor.
                     */
-
+                    if (this == &vec) return *this;
                     this->setData(vec.size());
                     memcpy(this->data, vec.data, vec.size() * sizeof(T));
                     this->pivot_index = vec.pivot_index;
                     return *this;
                 }
 
+                Vector<T>& operator= (Vector<T>&& vec) noexcept {
+                    /*
+                        Move assignment, the data arrays are swapped so the
+                        old one is freed with the moved-from Vector.
+                    */
+                    std::swap(this->width, vec.width);
+                    std::swap(this->pivot_index, vec.pivot_index);
+                    std::swap(this->data, vec.data);
+                    return *this;
+                }
+
                 template<class A>
                 Vector<T>& operator= (std::initializer_list<A> list) {
                     /*
@@ -235,7 +248,7 @@ namespace bop {
                     return *this;
                 }
 
-                Vector<T> operator- () const {
+                Vector<T> operator- () const & {
                     /*
                         Member negation operator, returns a vector identical to
                         the vector but with all elements multiplied by -1.
@@ -247,6 +260,14 @@ namespace bop {
                     return vec;
                 }
 
+                Vector<T> operator- () && {
+                    //Negates an expiring vector in its own data array.
+                    for (uint_type elem = 0; elem < this->size(); elem++) {
+                        this->data[elem] *= -1;
+                    }
+                    return std::move(*this);
+                }
+
                 //Vector information functions
 
                 int pivot(bool recalc = true) {
@@ -387,6 +408,35 @@ namespace bop {
             return vec_p;
         }
 
+        /*
+            Overloads for an expiring left operand, which is operated on
+            in place and returned instead of being copied.
+        */
+
+        template<class T>
+        Vector<T> operator* (Vector<T>&& vec, const T scalar) {
+            vec *= scalar;
+            return std::move(vec);
+        }
+
+        template<class T>
+        Vector<T> operator/ (Vector<T>&& vec, const T scalar) {
+            vec /= scalar;
+            return std::move(vec);
+        }
+
+        template<class T>
+        Vector<T> operator+ (Vector<T>&& vec1, const Vector<T>& vec2) {
+            vec1 += vec2;
+            return std::move(vec1);
+        }
+
+        template<class T>
+        Vector<T> operator- (Vector<T>&& vec1, const Vector<T>& vec2) {
+            vec1 -= vec2;
+            return std::move(vec1);
+        }
+
         template <class T>
         std::ostream& operator<< (std::ostream& stream, const Vector<T>& vec) {
             stream << vec.string();
@@ -0,0 +1,759 @@
+#ifndef BOP_PACKED_MATRIX_HPP
+#define BOP_PACKED_MATRIX_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "../bop-defaults/types.hpp"
+#include "SIMD.hpp"
+#include "MatrixExpression.hpp"
+#include "Matrix.hpp"
+
+/*
+    bop::maths packed matrix file
+
+    Triangular, symmetric and banded matrices stored without their zero
+    (or repeated) elements. A triangle is packed row by row, so row i of a
+    lower triangle is the i + 1 elements at i(i + 1)/2 and row i of an
+    upper one the n - i elements from its diagonal; a symmetric matrix
+    keeps only its lower triangle. A band keeps the kl + ku + 1 elements
+    of each row from kl left of the diagonal to ku right of it. Every
+    stored row is contiguous, so the kernels here are sums of rows with
+    the SIMD axpy and dot kernels, and read each stored element once.
+
+    Like the structured matrices they are expression leaves, converting
+    to a dense Matrix wherever one is expected.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            inline uint_type packedRow(uint_type n, uint_type row, bool upper) {
+                /*
+                    Offset of the first stored element of row in an n by n
+                    packed triangle.
+                */
+                return upper ? ((row * ((2 * n) - row + 1)) / 2) : ((row * (row + 1)) / 2);
+            }
+
+            template<class T>
+            void tpmm(uint_type n, uint_type columns, bool upper, const T* ap, const T* b, uint_type ldb, T* c, uint_type ldc) {
+                /*
+                    C = A * B for the n by n packed triangle A and n by
+                    columns B. C must not overlap B.
+                */
+                for (uint_type row = 0; row < n; row++) {
+                    const T* a_row = ap + packedRow(n, row, upper);
+                    const uint_type first = upper ? row : 0;
+                    const uint_type last = upper ? n : row + 1;
+                    T* c_row = c + (row * ldc);
+                    std::fill(c_row, c_row + columns, T(0));
+                    for (uint_type iter = first; iter < last; iter++) {
+                        const T multiplier = a_row[iter - first];
+                        if (multiplier != T(0)) axpy<T>(columns, multiplier, b + (iter * ldb), c_row);
+                    }
+                }
+            }
+
+            template<class T>
+            void tpmmRight(uint_type m, uint_type n, bool upper, const T* b, uint_type ldb, const T* ap, T* c, uint_type ldc) {
+                /*
+                    C = B * A for the m by n B and n by n packed triangle A,
+                    each row of C a sum of the packed rows of A.
+                */
+                for (uint_type row = 0; row < m; row++) {
+                    const T* b_row = b + (row * ldb);
+                    T* c_row = c + (row * ldc);
+                    std::fill(c_row, c_row + n, T(0));
+                    for (uint_type iter = 0; iter < n; iter++) {
+                        if (b_row[iter] == T(0)) continue;
+                        const T* a_row = ap + packedRow(n, iter, upper);
+                        if (upper) axpy<T>(n - iter, b_row[iter], a_row, c_row + iter);
+                        else axpy<T>(iter + 1, b_row[iter], a_row, c_row);
+                    }
+                }
+            }
+
+            template<class T>
+            void tpsm(uint_type n, uint_type columns, bool upper, bool transpose, const T* ap, T* b, uint_type ldb) {
+                /*
+                    Overwrites the n by columns B with A^-1 * B, or with
+                    A^-T * B when transpose is set, for the packed triangle
+                    A with a nonzero diagonal.
+                */
+                if (upper == transpose) {
+                    /*
+                        Forward substitution. For a lower triangle the rows
+                        already solved are subtracted from each row of B, for
+                        the transpose of an upper one each row is pushed down
+                        into the rows below once it is solved.
+                    */
+                    for (uint_type row = 0; row < n; row++) {
+                        const T* a_row = ap + packedRow(n, row, upper);
+                        T* b_row = b + (row * ldb);
+                        if (!upper) {
+                            for (uint_type iter = 0; iter < row; iter++) {
+                                if (a_row[iter] != T(0)) axpy<T>(columns, -a_row[iter], b + (iter * ldb), b_row);
+                            }
+                            scal<T>(columns, T(1) / a_row[row], b_row);
+                        }
+                        else {
+                            scal<T>(columns, T(1) / a_row[0], b_row);
+                            for (uint_type iter = row + 1; iter < n; iter++) {
+                                if (a_row[iter - row] != T(0)) axpy<T>(columns, -a_row[iter - row], b_row, b + (iter * ldb));
+                            }
+                        }
+                    }
+                }
+                else {
+                    for (uint_type row = n; row-- > 0;) {
+                        const T* a_row = ap + packedRow(n, row, upper);
+                        T* b_row = b + (row * ldb);
+                        if (upper) {
+                            for (uint_type iter = row + 1; iter < n; iter++) {
+                                if (a_row[iter - row] != T(0)) axpy<T>(columns, -a_row[iter - row], b + (iter * ldb), b_row);
+                            }
+                            scal<T>(columns, T(1) / a_row[0], b_row);
+                        }
+                        else {
+                            scal<T>(columns, T(1) / a_row[row], b_row);
+                            for (uint_type iter = 0; iter < row; iter++) {
+                                if (a_row[iter] != T(0)) axpy<T>(columns, -a_row[iter], b_row, b + (iter * ldb));
+                            }
+                        }
+                    }
+                }
+            }
+
+            template<class T>
+            void symvPacked(uint_type n, const T* ap, const T* x, T* y) {
+                /*
+                    y = A * x for the symmetric A packed as its lower
+                    triangle. Each packed row i is both row i of A, for the
+                    part left of the diagonal, and column i of it.
+                */
+                std::fill(y, y + n, T(0));
+                for (uint_type row = 0; row < n; row++) {
+                    const T* a_row = ap + packedRow(n, row, false);
+                    y[row] += dot<T>(row + 1, a_row, x);
+                    if (x[row] != T(0)) axpy<T>(row, x[row], a_row, y);
+                }
+            }
+
+            template<class T>
+            void symmPacked(uint_type n, uint_type columns, const T* ap, const T* b, uint_type ldb, T* c, uint_type ldc) {
+                /*
+                    C = A * B for the symmetric A packed as its lower triangle,
+                    every stored element used for both of its positions. C
+                    must not overlap B.
+                */
+                for (uint_type row = 0; row < n; row++) std::fill(c + (row * ldc), c + (row * ldc) + columns, T(0));
+                for (uint_type row = 0; row < n; row++) {
+                    const T* a_row = ap + packedRow(n, row, false);
+                    const T* b_row = b + (row * ldb);
+                    T* c_row = c + (row * ldc);
+                    for (uint_type iter = 0; iter < row; iter++) {
+                        if (a_row[iter] == T(0)) continue;
+                        axpy<T>(columns, a_row[iter], b + (iter * ldb), c_row);
+                        axpy<T>(columns, a_row[iter], b_row, c + (iter * ldc));
+                    }
+                    if (a_row[row] != T(0)) axpy<T>(columns, a_row[row], b_row, c_row);
+                }
+            }
+
+            template<class T>
+            bool pptrf(uint_type n, T* ap) {
+                /*
+                    Cholesky factorization of the symmetric positive
+                    definite matrix packed as its lower triangle, in place,
+                    by rows: L(i,j) = (A(i,j) - L(i,0:j).L(j,0:j)) / L(j,j),
+                    each a dot product of two packed rows. Returns false if
+                    a pivot is not positive.
+                */
+                for (uint_type row = 0; row < n; row++) {
+                    T* l_row = ap + packedRow(n, row, false);
+                    for (uint_type col = 0; col < row; col++) {
+                        const T* l_col = ap + packedRow(n, col, false);
+                        l_row[col] = (l_row[col] - dot<T>(col, l_row, l_col)) / l_col[col];
+                    }
+                    const T pivot = l_row[row] - dot<T>(row, l_row, l_row);
+                    if (!(pivot > T(0))) return false;
+                    l_row[row] = std::sqrt(pivot);
+                }
+                return true;
+            }
+
+            template<class T>
+            void gbmm(uint_type n, uint_type kl, uint_type ku, uint_type columns, const T* ab, const T* b, uint_type ldb, T* c, uint_type ldc) {
+                /*
+                    C = A * B for the n by n band A with kl subdiagonals and
+                    ku superdiagonals, stored kl + ku + 1 elements a row with
+                    A(i,j) at i * (kl + ku + 1) + j - i + kl.
+                */
+                const uint_type band = kl + ku + 1;
+                for (uint_type row = 0; row < n; row++) {
+                    const uint_type first = (row > kl) ? row - kl : 0;
+                    const uint_type last = std::min(n, row + ku + 1);
+                    const T* a_row = ab + (row * band) + kl + first - row;
+                    T* c_row = c + (row * ldc);
+                    std::fill(c_row, c_row + columns, T(0));
+                    for (uint_type iter = first; iter < last; iter++) {
+                        if (a_row[iter - first] != T(0)) axpy<T>(columns, a_row[iter - first], b + (iter * ldb), c_row);
+                    }
+                }
+            }
+
+            template<class T>
+            void gbmmRight(uint_type m, uint_type n, uint_type kl, uint_type ku, const T* b, uint_type ldb, const T* ab, T* c, uint_type ldc) {
+                /*
+                    C = B * A for the m by n B and the n by n band A.
+                */
+                const uint_type band = kl + ku + 1;
+                for (uint_type row = 0; row < m; row++) {
+                    const T* b_row = b + (row * ldb);
+                    T* c_row = c + (row * ldc);
+                    std::fill(c_row, c_row + n, T(0));
+                    for (uint_type iter = 0; iter < n; iter++) {
+                        if (b_row[iter] == T(0)) continue;
+                        const uint_type first = (iter > kl) ? iter - kl : 0;
+                        const uint_type last = std::min(n, iter + ku + 1);
+                        axpy<T>(last - first, b_row[iter], ab + (iter * band) + kl + first - iter, c_row + first);
+                    }
+                }
+            }
+
+            template<class T>
+            void gbmv(uint_type n, uint_type kl, uint_type ku, const T* ab, const T* x, T* y) {
+                const uint_type band = kl + ku + 1;
+                for (uint_type row = 0; row < n; row++) {
+                    const uint_type first = (row > kl) ? row - kl : 0;
+                    const uint_type last = std::min(n, row + ku + 1);
+                    y[row] = dot<T>(last - first, ab + (row * band) + kl + first - row, x + first);
+                }
+            }
+
+            template<class T>
+            bool gbsv(uint_type n, uint_type kl, uint_type ku, const T* ab, uint_type columns, T* b, uint_type ldb) {
+                /*
+                    Overwrites the n by columns B with A^-1 * B for the band
+                    A, by Gaussian elimination with partial pivoting. Row
+                    swaps widen the upper band to kl + ku, so the
+                    elimination works on a copy with kl more elements a
+                    row, row r holding columns r - kl to r + ku + kl. A is
+                    factored before B is touched, so B is left unchanged
+                    when false is returned for a singular A.
+                */
+                const uint_type band = kl + ku + 1;
+                const uint_type work_band = band + kl;
+                std::vector<T> work(n * work_band, T(0));
+                std::vector<uint_type> pivots(n);
+                for (uint_type row = 0; row < n; row++) std::copy(ab + (row * band), ab + ((row + 1) * band), work.data() + (row * work_band));
+                /*
+                    Element (r,j) of the working band.
+                */
+                auto at = [&work, work_band, kl](uint_type r, uint_type j) -> T& {
+                    return work[(r * work_band) + j + kl - r];
+                };
+                /*
+                    The multipliers are kept below the diagonal where they
+                    eliminated, and are applied to B in the same order.
+                */
+                for (uint_type col = 0; col < n; col++) {
+                    const uint_type last_row = std::min(n - 1, col + kl);
+                    const uint_type last_col = std::min(n - 1, col + ku + kl);
+                    uint_type pivot_row = col;
+                    for (uint_type row = col + 1; row <= last_row; row++) {
+                        if (std::abs(at(row,col)) > std::abs(at(pivot_row,col))) pivot_row = row;
+                    }
+                    if (at(pivot_row,col) == T(0)) return false;
+                    pivots[col] = pivot_row;
+                    if (pivot_row != col) {
+                        for (uint_type iter = col; iter <= last_col; iter++) std::swap(at(col,iter), at(pivot_row,iter));
+                    }
+                    const T pivot = at(col,col);
+                    for (uint_type row = col + 1; row <= last_row; row++) {
+                        const T factor = at(row,col) / pivot;
+                        at(row,col) = factor;
+                        if (factor != T(0) && last_col > col) axpy<T>(last_col - col, -factor, &at(col,col + 1), &at(row,col + 1));
+                    }
+                }
+                for (uint_type col = 0; col < n; col++) {
+                    if (pivots[col] != col) std::swap_ranges(b + (col * ldb), b + (col * ldb) + columns, b + (pivots[col] * ldb));
+                    const uint_type last_row = std::min(n - 1, col + kl);
+                    for (uint_type row = col + 1; row <= last_row; row++) {
+                        if (at(row,col) != T(0)) axpy<T>(columns, -at(row,col), b + (col * ldb), b + (row * ldb));
+                    }
+                }
+                for (uint_type row = n; row-- > 0;) {
+                    T* b_row = b + (row * ldb);
+                    const uint_type last_col = std::min(n - 1, row + ku + kl);
+                    for (uint_type iter = row + 1; iter <= last_col; iter++) {
+                        if (at(row,iter) != T(0)) axpy<T>(columns, -at(row,iter), b + (iter * ldb), b_row);
+                    }
+                    scal<T>(columns, T(1) / at(row,row), b_row);
+                }
+                return true;
+            }
+        }
+
+        template<class T>
+        class TriangularMatrix : public MatrixExpression< TriangularMatrix<T> > {
+            /*
+                An upper or lower triangular matrix, packed.
+            */
+            protected:
+                std::vector<T> packed;
+                uint_type matrix_size;
+                bool is_upper;
+
+            public:
+                typedef T value_type;
+
+                TriangularMatrix(uint_type size, bool upper = false) :
+                    packed((size * (size + 1)) / 2, T(0)), matrix_size(size), is_upper(upper) {
+                }
+
+                TriangularMatrix(const Matrix<T>& mat, bool upper = false) : TriangularMatrix(std::min(mat.width(), mat.height()), upper) {
+                    /*
+                        Takes the upper or lower triangle of the leading
+                        square of mat, ignoring the rest of it.
+                    */
+                    for (uint_type row = 0; row < this->matrix_size; row++) {
+                        const T* row_data = mat.rowData(row);
+                        const uint_type first = upper ? row : 0;
+                        const uint_type last = upper ? this->matrix_size : row + 1;
+                        std::copy(row_data + first, row_data + last, this->rowData(row));
+                    }
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->matrix_size;
+                }
+
+                inline uint_type width() const {
+                    return this->matrix_size;
+                }
+
+                inline uint_type height() const {
+                    return this->matrix_size;
+                }
+
+                inline bool upper() const {
+                    return this->is_upper;
+                }
+
+                inline uint_type storage() const {
+                    /*
+                        Elements stored, n(n + 1)/2 against n^2 dense.
+                    */
+                    return this->packed.size();
+                }
+
+                inline T* rowData(uint_type row) {
+                    /*
+                        The stored part of row, starting at the diagonal of an
+                        upper triangle or the first column of a lower one.
+                    */
+                    return this->packed.data() + kernel::packedRow(this->matrix_size, row, this->is_upper);
+                }
+
+                inline const T* rowData(uint_type row) const {
+                    return this->packed.data() + kernel::packedRow(this->matrix_size, row, this->is_upper);
+                }
+
+                inline T* packedData() {
+                    return this->packed.data();
+                }
+
+                inline const T* packedData() const {
+                    return this->packed.data();
+                }
+
+                inline bool inside(uint_type row, uint_type col) const {
+                    return this->is_upper ? (col >= row) : (col <= row);
+                }
+
+                inline T& entry(uint_type row, uint_type col) {
+                    /*
+                        A stored element, (row,col) must be inside() the
+                        triangle.
+                    */
+                    return this->rowData(row)[this->is_upper ? col - row : col];
+                }
+
+                inline bool conformant(uint_type, uint_type) const {
+                    return false;
+                }
+
+                inline T element(uint_type elem) const {
+                    return this->element(elem / this->matrix_size, elem % this->matrix_size);
+                }
+
+                inline T element(uint_type row, uint_type col) const {
+                    if (!this->inside(row,col)) return T(0);
+                    return this->rowData(row)[this->is_upper ? col - row : col];
+                }
+
+                inline Matrix<T> eval() const {
+                    return Matrix<T>(*this);
+                }
+
+                T det() const {
+                    T deter = T(1);
+                    for (uint_type elem = 0; elem < this->matrix_size; elem++) deter *= this->element(elem,elem);
+                    return deter;
+                }
+
+                //Transformations
+
+                TriangularMatrix<T> transposed() const {
+                    /*
+                        Row i of the lower triangle is column i of the upper
+                        one.
+                    */
+                    TriangularMatrix<T> trans(this->matrix_size, !this->is_upper);
+                    for (uint_type row = 0; row < this->matrix_size; row++) {
+                        const uint_type first = this->is_upper ? row : 0;
+                        const uint_type last = this->is_upper ? this->matrix_size : row + 1;
+                        for (uint_type col = first; col < last; col++) trans.entry(col,row) = this->element(row,col);
+                    }
+                    return trans;
+                }
+
+                //Solving
+
+                bool solveInPlace(Matrix<T>& b, bool transpose = false) const {
+                    /*
+                        Overwrites b with A^-1 * b (A^-T * b if transpose is
+                        set). Returns false, leaving b unchanged, if the shapes
+                        do not conform or the triangle is singular.
+                    */
+                    if (b.height() != this->matrix_size) return false;
+                    for (uint_type elem = 0; elem < this->matrix_size; elem++) {
+                        if (this->element(elem,elem) == T(0)) return false;
+                    }
+                    kernel::tpsm<T>(this->matrix_size, b.width(), this->is_upper, transpose, this->packed.data(), b.rowData(0), b.stride());
+                    return true;
+                }
+
+                Matrix<T> solve(Matrix<T> b, bool transpose = false) const {
+                    this->solveInPlace(b, transpose);
+                    return b;
+                }
+        };
+
+        template<class T>
+        class SymmetricMatrix : public MatrixExpression< SymmetricMatrix<T> > {
+            /*
+                A symmetric matrix, packed as its lower triangle.
+            */
+            protected:
+                TriangularMatrix<T> lower_triangle;
+
+            public:
+                typedef T value_type;
+
+                SymmetricMatrix(uint_type size) : lower_triangle(size, false) {
+                }
+
+                SymmetricMatrix(const Matrix<T>& mat) : lower_triangle(mat, false) {
+                    /*
+                        Only the lower triangle of mat is read, it is assumed
+                        to be symmetric.
+                    */
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->lower_triangle.size();
+                }
+
+                inline uint_type width() const {
+                    return this->size();
+                }
+
+                inline uint_type height() const {
+                    return this->size();
+                }
+
+                inline uint_type storage() const {
+                    return this->lower_triangle.storage();
+                }
+
+                inline const TriangularMatrix<T>& lower() const {
+                    return this->lower_triangle;
+                }
+
+                inline T& entry(uint_type row, uint_type col) {
+                    /*
+                        The stored element for both (row,col) and (col,row).
+                    */
+                    return (row >= col) ? this->lower_triangle.entry(row,col) : this->lower_triangle.entry(col,row);
+                }
+
+                inline bool conformant(uint_type, uint_type) const {
+                    return false;
+                }
+
+                inline T element(uint_type elem) const {
+                    return this->element(elem / this->size(), elem % this->size());
+                }
+
+                inline T element(uint_type row, uint_type col) const {
+                    return (row >= col) ? this->lower_triangle.element(row,col) : this->lower_triangle.element(col,row);
+                }
+
+                inline Matrix<T> eval() const {
+                    return Matrix<T>(*this);
+                }
+
+                inline SymmetricMatrix<T> transposed() const {
+                    return *this;
+                }
+
+                //Solving
+
+                bool cholesky(TriangularMatrix<T>& factor) const {
+                    /*
+                        Packed Cholesky factorization into the lower triangle
+                        factor, with A = L * L^T. Returns false if A is not
+                        positive definite, leaving factor incomplete.
+                    */
+                    factor = this->lower_triangle;
+                    return kernel::pptrf<T>(this->size(), factor.packedData());
+                }
+
+                bool solveInPlace(Matrix<T>& b) const {
+                    /*
+                        Overwrites b with A^-1 * b for a positive definite A,
+                        through its packed Cholesky factor. Returns false,
+                        leaving b unchanged, if A is not positive definite or
+                        the shapes do not conform.
+                    */
+                    TriangularMatrix<T> factor(0);
+                    if (b.height() != this->size() || !this->cholesky(factor)) return false;
+                    kernel::tpsm<T>(this->size(), b.width(), false, false, factor.packedData(), b.rowData(0), b.stride());
+                    kernel::tpsm<T>(this->size(), b.width(), false, true, factor.packedData(), b.rowData(0), b.stride());
+                    return true;
+                }
+
+                Matrix<T> solve(Matrix<T> b) const {
+                    this->solveInPlace(b);
+                    return b;
+                }
+        };
+
+        template<class T>
+        class BandedMatrix : public MatrixExpression< BandedMatrix<T> > {
+            /*
+                A square matrix that is zero more than kl below or ku above
+                its diagonal, such as a tridiagonal matrix with kl = ku = 1.
+            */
+            protected:
+                std::vector<T> band;
+                uint_type matrix_size;
+                uint_type lower_width;
+                uint_type upper_width;
+
+                inline uint_type bandWidth() const {
+                    return this->lower_width + this->upper_width + 1;
+                }
+
+            public:
+                typedef T value_type;
+
+                BandedMatrix(uint_type size, uint_type kl, uint_type ku) :
+                    band(size * (kl + ku + 1), T(0)), matrix_size(size), lower_width(kl), upper_width(ku) {
+                }
+
+                BandedMatrix(const Matrix<T>& mat, uint_type kl, uint_type ku) : BandedMatrix(std::min(mat.width(), mat.height()), kl, ku) {
+                    /*
+                        Takes the band of the leading square of mat, ignoring
+                        the rest of it.
+                    */
+                    for (uint_type row = 0; row < this->matrix_size; row++) {
+                        const uint_type first = (row > kl) ? row - kl : 0;
+                        const uint_type last = std::min(this->matrix_size, row + ku + 1);
+                        for (uint_type col = first; col < last; col++) this->entry(row,col) = mat.element(row,col);
+                    }
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->matrix_size;
+                }
+
+                inline uint_type width() const {
+                    return this->matrix_size;
+                }
+
+                inline uint_type height() const {
+                    return this->matrix_size;
+                }
+
+                inline uint_type subdiagonals() const {
+                    return this->lower_width;
+                }
+
+                inline uint_type superdiagonals() const {
+                    return this->upper_width;
+                }
+
+                inline uint_type storage() const {
+                    return this->band.size();
+                }
+
+                inline const T* bandData() const {
+                    return this->band.data();
+                }
+
+                inline bool inside(uint_type row, uint_type col) const {
+                    return (col + this->lower_width >= row) && (col <= row + this->upper_width);
+                }
+
+                inline T& entry(uint_type row, uint_type col) {
+                    /*
+                        A stored element, (row,col) must be inside() the band.
+                    */
+                    return this->band[(row * this->bandWidth()) + col + this->lower_width - row];
+                }
+
+                inline bool conformant(uint_type, uint_type) const {
+                    return false;
+                }
+
+                inline T element(uint_type elem) const {
+                    return this->element(elem / this->matrix_size, elem % this->matrix_size);
+                }
+
+                inline T element(uint_type row, uint_type col) const {
+                    if (!this->inside(row,col)) return T(0);
+                    return this->band[(row * this->bandWidth()) + col + this->lower_width - row];
+                }
+
+                inline Matrix<T> eval() const {
+                    return Matrix<T>(*this);
+                }
+
+                //Solving
+
+                bool solveInPlace(Matrix<T>& b) const {
+                    /*
+                        Overwrites b with A^-1 * b in O(n (kl + ku) kl) for the
+                        factorization and O(n (2kl + ku)) per column of b.
+                        Returns false, leaving b unchanged, if the shapes do
+                        not conform or A is singular.
+                    */
+                    if (b.height() != this->matrix_size) return false;
+                    return kernel::gbsv<T>(this->matrix_size, this->lower_width, this->upper_width, this->band.data(), b.width(), b.rowData(0), b.stride());
+                }
+
+                Matrix<T> solve(Matrix<T> b) const {
+                    this->solveInPlace(b);
+                    return b;
+                }
+        };
+
+        //Products with dense matrices
+
+        /*
+            The packed operand is read in place, never expanded to a full
+            matrix. If the dense matrix does not have size() rows (packed
+            operand on the left) or columns (on the right), a copy of it
+            is returned unmultiplied.
+        */
+
+        template<class T>
+        Matrix<T> operator* (const TriangularMatrix<T>& tri, const Matrix<T>& mat) {
+            if (mat.height() != tri.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            kernel::tpmm<T>(tri.size(), mat.width(), tri.upper(), tri.packedData(), mat.rowData(0), mat.stride(), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const Matrix<T>& mat, const TriangularMatrix<T>& tri) {
+            if (mat.width() != tri.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            kernel::tpmmRight<T>(mat.height(), tri.size(), tri.upper(), mat.rowData(0), mat.stride(), tri.packedData(), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const SymmetricMatrix<T>& sym, const Matrix<T>& mat) {
+            if (mat.height() != sym.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            kernel::symmPacked<T>(sym.size(), mat.width(), sym.lower().packedData(), mat.rowData(0), mat.stride(), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const Matrix<T>& mat, const SymmetricMatrix<T>& sym) {
+            /*
+                Row r of B * A is A * (row r of B), as A is symmetric.
+            */
+            if (mat.width() != sym.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            for (uint_type row = 0; row < mat.height(); row++) kernel::symvPacked<T>(sym.size(), sym.lower().packedData(), mat.rowData(row), mat_p.rowData(row));
+            return mat_p;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const BandedMatrix<T>& banded, const Matrix<T>& mat) {
+            if (mat.height() != banded.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            kernel::gbmm<T>(banded.size(), banded.subdiagonals(), banded.superdiagonals(), mat.width(), banded.bandData(),
+                            mat.rowData(0), mat.stride(), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const Matrix<T>& mat, const BandedMatrix<T>& banded) {
+            if (mat.width() != banded.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            kernel::gbmmRight<T>(mat.height(), banded.size(), banded.subdiagonals(), banded.superdiagonals(),
+                                 mat.rowData(0), mat.stride(), banded.bandData(), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        Vector<T> operator* (const TriangularMatrix<T>& tri, const Vector<T>& vec) {
+            if (vec.size() != tri.size()) return vec;
+            Vector<T> vec_p(vec.size());
+            for (uint_type row = 0; row < tri.size(); row++) {
+                const uint_type first = tri.upper() ? row : 0;
+                const uint_type last = tri.upper() ? tri.size() : row + 1;
+                vec_p[row] = kernel::dot<T>(last - first, tri.rowData(row), &vec[first]);
+            }
+            return vec_p;
+        }
+
+        template<class T>
+        Vector<T> operator* (const SymmetricMatrix<T>& sym, const Vector<T>& vec) {
+            if (vec.size() != sym.size() || vec.size() == 0) return vec;
+            Vector<T> vec_p(vec.size());
+            kernel::symvPacked<T>(sym.size(), sym.lower().packedData(), &vec[0], &vec_p[0]);
+            return vec_p;
+        }
+
+        template<class T>
+        Vector<T> operator* (const BandedMatrix<T>& banded, const Vector<T>& vec) {
+            if (vec.size() != banded.size() || vec.size() == 0) return vec;
+            Vector<T> vec_p(vec.size());
+            kernel::gbmv<T>(banded.size(), banded.subdiagonals(), banded.superdiagonals(), banded.bandData(), &vec[0], &vec_p[0]);
+            return vec_p;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef BOP_QR_DECOMPOSITION_HPP
+#define BOP_QR_DECOMPOSITION_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "SIMD.hpp"
+#include "MatrixView.hpp"
+#include "TriangularSolve.hpp"
+
+/*
+    bop::maths::QRDecomposition class file
+
+    Householder QR factorization A = QR of an m by n matrix, done in place
+    in the storage of a Matrix<T>. R is left on and above the diagonal and
+    the Householder vectors below it, with their leading ones implicit, as
+    in LAPACK's geqrf. Each panel's reflectors are also kept in the compact
+    WY form H1 H2 ... Hk = I - V T V^T, so that Q and Q^T are applied to
+    other matrices by GEMMs rather than one reflector at a time.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        template<class T>
+        class QRDecomposition {
+            protected:
+                Matrix<T> factors;
+                std::vector<T> taus;
+                /*
+                    The block_size by block_size upper triangular T of each
+                    panel, one after the other.
+                */
+                std::vector<T> triangles;
+
+                inline T& at(uint_type row, uint_type col) const {
+                    return this->factors.rowData(row)[col];
+                }
+
+                inline uint_type reflectors() const {
+                    return std::min(this->rows(), this->columns());
+                }
+
+                void factorizePanel(uint_type start, uint_type panel_width) {
+                    /*
+                        Unblocked factorization of the columns [start, start +
+                        panel_width), only applying each reflector inside the
+                        panel. The reflector is applied to the rest of the
+                        panel with row-wise axpys, w = v^T A then A -= tau v w.
+                    */
+                    const uint_type m = this->rows();
+                    std::vector<T> work(panel_width);
+                    for (uint_type col = start; col < start + panel_width; col++) {
+                        const T alpha = this->at(col,col);
+                        T sigma = T(0);
+                        for (uint_type row = col + 1; row < m; row++) sigma += this->at(row,col) * this->at(row,col);
+                        if (sigma == T(0)) {
+                            /*
+                                Nothing below the diagonal to annihilate, H = I.
+                            */
+                            this->taus[col] = T(0);
+                            continue;
+                        }
+                        const T norm = std::sqrt((alpha * alpha) + sigma);
+                        const T beta = (alpha >= T(0)) ? -norm : norm;
+                        const T tau = (beta - alpha) / beta;
+                        const T scale = T(1) / (alpha - beta);
+                        for (uint_type row = col + 1; row < m; row++) this->at(row,col) *= scale;
+                        this->at(col,col) = beta;
+                        this->taus[col] = tau;
+                        const uint_type rest = start + panel_width - col - 1;
+                        if (rest == 0) continue;
+                        std::copy(&this->at(col,col + 1), &this->at(col,col + 1) + rest, work.begin());
+                        for (uint_type row = col + 1; row < m; row++) {
+                            kernel::axpy<T>(rest, this->at(row,col), &this->at(row,col + 1), work.data());
+                        }
+                        kernel::axpy<T>(rest, -tau, work.data(), &this->at(col,col + 1));
+                        for (uint_type row = col + 1; row < m; row++) {
+                            kernel::axpy<T>(rest, -tau * this->at(row,col), work.data(), &this->at(row,col + 1));
+                        }
+                    }
+                }
+
+                void formTriangle(uint_type start, uint_type panel_width) {
+                    /*
+                        Builds T for the panel's reflectors column by column, as
+                        LAPACK's larft: T(i,i) = tau_i and
+                        T(0:i,i) = -tau_i T(0:i,0:i) V(:,0:i)^T v_i.
+                    */
+                    const uint_type m = this->rows();
+                    const uint_type nb = block_size;
+                    T* triangle = &this->triangles[(start / nb) * nb * nb];
+                    std::vector<T> dots(panel_width);
+                    for (uint_type iter = 0; iter < panel_width; iter++) {
+                        const uint_type col = start + iter;
+                        const T tau = this->taus[col];
+                        triangle[(iter * nb) + iter] = tau;
+                        if (iter == 0) continue;
+                        std::copy(&this->at(col,start), &this->at(col,col), dots.begin());
+                        for (uint_type row = col + 1; row < m; row++) {
+                            kernel::axpy<T>(iter, this->at(row,col), &this->at(row,start), dots.data());
+                        }
+                        for (uint_type row = 0; row < iter; row++) {
+                            T sum = T(0);
+                            for (uint_type inner = row; inner < iter; inner++) sum += triangle[(row * nb) + inner] * dots[inner];
+                            triangle[(row * nb) + iter] = -tau * sum;
+                        }
+                    }
+                }
+
+                void applyBlockReflector(uint_type start, uint_type panel_width, bool transpose, T* c, uint_type columns, uint_type ldc) const {
+                    /*
+                        C = (I - V T V^T) C, or with T^T when transpose is set,
+                        for the rows [start, m) of C given at c. V is copied out
+                        with its unit diagonal and zeros made explicit so both
+                        products with it go through the packed GEMM:
+
+                            W = V^T C, W = T W (or T^T W), C -= V W
+                    */
+                    const uint_type rows = this->rows() - start;
+                    const uint_type nb = block_size;
+                    const T* triangle = &this->triangles[(start / nb) * nb * nb];
+                    std::vector<T> v(rows * panel_width, T(0));
+                    for (uint_type row = 0; row < rows; row++) {
+                        const uint_type below = std::min(row, panel_width);
+                        std::copy(&this->at(start + row,start), &this->at(start + row,start) + below, v.begin() + (row * panel_width));
+                        if (row < panel_width) v[(row * panel_width) + row] = T(1);
+                    }
+                    std::vector<T> w(panel_width * columns);
+                    kernel::gemm<T>(panel_width, columns, rows, T(1),
+                                    v.data(), 1, panel_width,
+                                    c, ldc, 1,
+                                    T(0), w.data(), columns);
+                    if (transpose) {
+                        for (uint_type row = panel_width; row-- > 0;) {
+                            T* w_row = w.data() + (row * columns);
+                            kernel::scal<T>(columns, triangle[(row * nb) + row], w_row);
+                            for (uint_type iter = 0; iter < row; iter++) {
+                                kernel::axpy<T>(columns, triangle[(iter * nb) + row], w.data() + (iter * columns), w_row);
+                            }
+                        }
+                    }
+                    else {
+                        for (uint_type row = 0; row < panel_width; row++) {
+                            T* w_row = w.data() + (row * columns);
+                            kernel::scal<T>(columns, triangle[(row * nb) + row], w_row);
+                            for (uint_type iter = row + 1; iter < panel_width; iter++) {
+                                kernel::axpy<T>(columns, triangle[(row * nb) + iter], w.data() + (iter * columns), w_row);
+                            }
+                        }
+                    }
+                    kernel::gemm<T>(rows, columns, panel_width, T(-1),
+                                    v.data(), panel_width, 1,
+                                    w.data(), columns, 1,
+                                    T(1), c, ldc);
+                }
+
+                void factorize() {
+                    /*
+                        Blocked factorization: each panel of block_size columns
+                        is factored unblocked, its T is formed, and the block
+                        reflector is applied to the trailing columns in two
+                        GEMMs.
+                    */
+                    const uint_type k = this->reflectors();
+                    const uint_type n = this->columns();
+                    const uint_type nb = block_size;
+                    this->taus.assign(k, T(0));
+                    this->triangles.assign(((k + nb - 1) / nb) * nb * nb, T(0));
+                    for (uint_type start = 0; start < k; start += nb) {
+                        const uint_type panel_width = std::min(nb, k - start);
+                        this->factorizePanel(start, panel_width);
+                        this->formTriangle(start, panel_width);
+                        const uint_type right = start + panel_width;
+                        if (right < n) {
+                            this->applyBlockReflector(start, panel_width, true, &this->at(start,right), n - right, this->factors.stride());
+                        }
+                    }
+                }
+
+            public:
+                /*
+                    Width of the column panels, and so the order of each
+                    panel's T.
+                */
+                static const uint_type block_size = 32;
+
+                QRDecomposition() {
+                }
+
+                QRDecomposition(const Matrix<T>& mat) : factors(mat) {
+                    this->factorize();
+                }
+
+                QRDecomposition(Matrix<T>&& mat) : factors(std::move(mat)) {
+                    /*
+                        Factors an expiring matrix in its own storage.
+                    */
+                    this->factorize();
+                }
+
+                QRDecomposition(const MatrixView<T>& view) : factors(view) {
+                    this->factorize();
+                }
+
+                //Information functions
+
+                inline uint_type rows() const {
+                    return this->factors.height();
+                }
+
+                inline uint_type columns() const {
+                    return this->factors.width();
+                }
+
+                bool fullRank() const {
+                    /*
+                        True unless R has a zero on its diagonal. Near zeros are
+                        not detected, as QR does not pivot columns.
+                    */
+                    for (uint_type elem = 0; elem < this->reflectors(); elem++) {
+                        if (this->at(elem,elem) == T(0)) return false;
+                    }
+                    return true;
+                }
+
+                inline const T* data() const {
+                    /*
+                        The packed factors, R on and above the diagonal and the
+                        Householder vectors below it.
+                    */
+                    return this->factors.rowData(0);
+                }
+
+                inline const std::vector<T>& scalingFactors() const {
+                    return this->taus;
+                }
+
+                Matrix<T> r() const {
+                    /*
+                        The min(m,n) by n upper triangular R.
+                    */
+                    Matrix<T> mat(this->columns(), this->reflectors(), 0);
+                    for (uint_type row = 0; row < this->reflectors(); row++) {
+                        for (uint_type col = row; col < this->columns(); col++) mat.element(row,col) = this->at(row,col);
+                    }
+                    return mat;
+                }
+
+                Matrix<T> q() const {
+                    /*
+                        The m by min(m,n) Q with orthonormal columns, found by
+                        applying Q to the leading columns of the identity.
+                    */
+                    Matrix<T> mat(this->reflectors(), this->rows(), 0);
+                    for (uint_type elem = 0; elem < this->reflectors(); elem++) mat.element(elem,elem) = 1;
+                    this->applyQInPlace(mat.rowData(0), mat.width(), mat.stride());
+                    return mat;
+                }
+
+                //Applying Q
+
+                void applyQTInPlace(T* b, uint_type columns, uint_type ldb) const {
+                    /*
+                        Overwrites the m by columns matrix at b with Q^T B.
+                    */
+                    const uint_type nb = block_size;
+                    for (uint_type start = 0; start < this->reflectors(); start += nb) {
+                        const uint_type panel_width = std::min(nb, this->reflectors() - start);
+                        this->applyBlockReflector(start, panel_width, true, b + (start * ldb), columns, ldb);
+                    }
+                }
+
+                void applyQInPlace(T* b, uint_type columns, uint_type ldb) const {
+                    /*
+                        Overwrites the m by columns matrix at b with Q B.
+                    */
+                    const uint_type nb = block_size;
+                    if (this->reflectors() == 0) return;
+                    for (uint_type start = ((this->reflectors() - 1) / nb) * nb;; start -= nb) {
+                        const uint_type panel_width = std::min(nb, this->reflectors() - start);
+                        this->applyBlockReflector(start, panel_width, false, b + (start * ldb), columns, ldb);
+                        if (start == 0) break;
+                    }
+                }
+
+                //Solving
+
+                Matrix<T> solve(const Matrix<T>& b) const {
+                    /*
+                        The least squares solution X minimising ||AX - B|| for
+                        each column of B, R^-1 (Q^T B) over the first n rows.
+                        A must have at least as many rows as columns and be
+                        of full rank, see fullRank(), and B as many rows as
+                        A, otherwise B is returned unchanged.
+                    */
+                    if (b.height() != this->rows() || this->rows() < this->columns() || !this->fullRank()) return b;
+                    Matrix<T> qtb(b);
+                    this->applyQTInPlace(qtb.rowData(0), qtb.width(), qtb.stride());
+                    Matrix<T> x(qtb.block(0, 0, qtb.width(), this->columns()));
+                    kernel::trsmUpper<T>(this->columns(), x.width(), this->factors.rowData(0), this->factors.stride(), false, x.rowData(0), x.stride());
+                    return x;
+                }
+
+                Matrix<T> solve(const MatrixView<T>& b) const {
+                    return this->solve(Matrix<T>(b));
+                }
+        };
+
+        template<class T>
+        Matrix<T> solve(const QRDecomposition<T>& qr, const Matrix<T>& b) {
+            return qr.solve(b);
+        }
+
+        template<class T>
+        Matrix<T> solve(const QRDecomposition<T>& qr, const MatrixView<T>& b) {
+            return qr.solve(b);
+        }
+
+        template<class T>
+        Matrix<T> leastSquares(const Matrix<T>& a, const Matrix<T>& b) {
+            /*
+                X minimising ||AX - B|| for a tall A of full column rank, by
+                QR rather than through the normal equations, whose condition
+                number is the square of A's.
+            */
+            return QRDecomposition<T>(a).solve(b);
+        }
+
+        template<class T>
+        Matrix<T> leastSquares(const MatrixView<T>& a, const MatrixView<T>& b) {
+            return QRDecomposition<T>(a).solve(b);
+        }
+    }
+}
+
+#endif
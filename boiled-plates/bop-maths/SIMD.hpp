@@ -0,0 +1,775 @@
+#ifndef BOP_SIMD_HPP
+#define BOP_SIMD_HPP
+
+#include <type_traits>
+#include <cstdint>
+#include "../bop-defaults/types.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(BOP_SIMD_DISABLE)
+#define BOP_SIMD_X86
+#include <immintrin.h>
+#define BOP_SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+/*
+    Forces a generic helper into the target-specific function calling it,
+    so that it is compiled for that function's instruction set.
+*/
+#define BOP_SIMD_INLINE __attribute__((always_inline))
+#else
+#define BOP_SIMD_INLINE
+#endif
+
+/*
+    Runtime-dispatched SIMD element-wise kernels.
+
+    The instruction set is detected once with cpuid (through the compiler's
+    cpu builtins) and each kernel resolves to the widest implementation the
+    host supports the first time it is called, so a single binary built for
+    generic x86-64 still runs at full vector width. Defining BOP_SIMD_DISABLE
+    or building for anything other than x86 leaves only the scalar loops.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace simd {
+
+            enum Level {
+                scalar = 0,
+                sse2 = 1,
+                avx2 = 2,
+                avx512 = 3
+            };
+
+            inline Level detect() {
+                /*
+                    Queries the host for the widest supported instruction set.
+                */
+                #ifdef BOP_SIMD_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512f")) return avx512;
+                if (__builtin_cpu_supports("avx2")) return avx2;
+                if (__builtin_cpu_supports("sse2")) return sse2;
+                #endif
+                return scalar;
+            }
+
+            inline Level level() {
+                static const Level host_level = detect();
+                return host_level;
+            }
+
+            inline const char* name(Level lvl) {
+                switch (lvl) {
+                    case avx512: return "AVX-512";
+                    case avx2: return "AVX2";
+                    case sse2: return "SSE2";
+                    default: return "scalar";
+                }
+            }
+        }
+
+        namespace kernel {
+
+            /*
+                Scalar implementations, used for every type that is not float
+                or double and as the fallback when no vector unit is found.
+            */
+            template<class T>
+            void axpyScalar(uint_type n, T alpha, const T* x, T* y) {
+                for (uint_type elem = 0; elem < n; elem++) y[elem] += alpha * x[elem];
+            }
+
+            template<class T>
+            void scalScalar(uint_type n, T alpha, T* x) {
+                for (uint_type elem = 0; elem < n; elem++) x[elem] *= alpha;
+            }
+
+            template<class T>
+            void streamScalar(uint_type n, const T* x, T* y) {
+                for (uint_type elem = 0; elem < n; elem++) y[elem] = x[elem];
+            }
+
+            template<class S, class T>
+            void convertScalar(uint_type n, const S* x, T* y) {
+                for (uint_type elem = 0; elem < n; elem++) y[elem] = static_cast<T>(x[elem]);
+            }
+
+            template<class T>
+            T dotScalar(uint_type n, const T* a, const T* x) {
+                T sum = T(0);
+                for (uint_type elem = 0; elem < n; elem++) sum += a[elem] * x[elem];
+                return sum;
+            }
+
+            template<class T>
+            void dot4Scalar(uint_type n, const T* a, uint_type lda, const T* x, T* out) {
+                T sum0 = T(0), sum1 = T(0), sum2 = T(0), sum3 = T(0);
+                for (uint_type elem = 0; elem < n; elem++) {
+                    sum0 += a[elem] * x[elem];
+                    sum1 += a[lda + elem] * x[elem];
+                    sum2 += a[(2 * lda) + elem] * x[elem];
+                    sum3 += a[(3 * lda) + elem] * x[elem];
+                }
+                out[0] = sum0;
+                out[1] = sum1;
+                out[2] = sum2;
+                out[3] = sum3;
+            }
+
+            #ifdef BOP_SIMD_X86
+            /*
+                SSE2 kernels.
+            */
+            BOP_SIMD_TARGET("sse2") inline void axpySSE2(uint_type n, double alpha, const double* x, double* y) {
+                const __m128d va = _mm_set1_pd(alpha);
+                uint_type elem = 0;
+                for (; elem + 2 <= n; elem += 2) {
+                    _mm_storeu_pd(y + elem, _mm_add_pd(_mm_loadu_pd(y + elem), _mm_mul_pd(va, _mm_loadu_pd(x + elem))));
+                }
+                for (; elem < n; elem++) y[elem] += alpha * x[elem];
+            }
+
+            BOP_SIMD_TARGET("sse2") inline void axpySSE2(uint_type n, float alpha, const float* x, float* y) {
+                const __m128 va = _mm_set1_ps(alpha);
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) {
+                    _mm_storeu_ps(y + elem, _mm_add_ps(_mm_loadu_ps(y + elem), _mm_mul_ps(va, _mm_loadu_ps(x + elem))));
+                }
+                for (; elem < n; elem++) y[elem] += alpha * x[elem];
+            }
+
+            BOP_SIMD_TARGET("sse2") inline void scalSSE2(uint_type n, double alpha, double* x) {
+                const __m128d va = _mm_set1_pd(alpha);
+                uint_type elem = 0;
+                for (; elem + 2 <= n; elem += 2) _mm_storeu_pd(x + elem, _mm_mul_pd(va, _mm_loadu_pd(x + elem)));
+                for (; elem < n; elem++) x[elem] *= alpha;
+            }
+
+            BOP_SIMD_TARGET("sse2") inline void scalSSE2(uint_type n, float alpha, float* x) {
+                const __m128 va = _mm_set1_ps(alpha);
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) _mm_storeu_ps(x + elem, _mm_mul_ps(va, _mm_loadu_ps(x + elem)));
+                for (; elem < n; elem++) x[elem] *= alpha;
+            }
+
+            /*
+                Non-temporal copies, the stores bypass the cache so the
+                destination lines are not read in first. The destination
+                is stepped to 16 byte alignment with ordinary stores.
+            */
+            BOP_SIMD_TARGET("sse2") inline void streamSSE2(uint_type n, const double* x, double* y) {
+                uint_type elem = 0;
+                for (; elem < n && (reinterpret_cast<uintptr_t>(y + elem) & 15) != 0; elem++) y[elem] = x[elem];
+                for (; elem + 2 <= n; elem += 2) _mm_stream_pd(y + elem, _mm_loadu_pd(x + elem));
+                for (; elem < n; elem++) y[elem] = x[elem];
+            }
+
+            BOP_SIMD_TARGET("sse2") inline void streamSSE2(uint_type n, const float* x, float* y) {
+                uint_type elem = 0;
+                for (; elem < n && (reinterpret_cast<uintptr_t>(y + elem) & 15) != 0; elem++) y[elem] = x[elem];
+                for (; elem + 4 <= n; elem += 4) _mm_stream_ps(y + elem, _mm_loadu_ps(x + elem));
+                for (; elem < n; elem++) y[elem] = x[elem];
+            }
+
+            /*
+                Conversions between float and double, each vector of the
+                narrow type filling two of the wide one.
+            */
+            BOP_SIMD_TARGET("sse2") inline void convertSSE2(uint_type n, const float* x, double* y) {
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) {
+                    const __m128 vx = _mm_loadu_ps(x + elem);
+                    _mm_storeu_pd(y + elem, _mm_cvtps_pd(vx));
+                    _mm_storeu_pd(y + elem + 2, _mm_cvtps_pd(_mm_movehl_ps(vx, vx)));
+                }
+                for (; elem < n; elem++) y[elem] = x[elem];
+            }
+
+            BOP_SIMD_TARGET("sse2") inline void convertSSE2(uint_type n, const double* x, float* y) {
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) {
+                    const __m128 low = _mm_cvtpd_ps(_mm_loadu_pd(x + elem));
+                    const __m128 high = _mm_cvtpd_ps(_mm_loadu_pd(x + elem + 2));
+                    _mm_storeu_ps(y + elem, _mm_movelh_ps(low, high));
+                }
+                for (; elem < n; elem++) y[elem] = static_cast<float>(x[elem]);
+            }
+
+            /*
+                Dot products. dot4 takes four rows lda apart against the same
+                x, so each element of x is loaded once for four rows and the
+                four sums form independent dependency chains.
+            */
+            BOP_SIMD_TARGET("sse2") inline double hsumSSE2(__m128d v) {
+                return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+            }
+
+            BOP_SIMD_TARGET("sse2") inline float hsumSSE2(__m128 v) {
+                const __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+                return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+            }
+
+            BOP_SIMD_TARGET("sse2") inline double dotSSE2(uint_type n, const double* a, const double* x) {
+                __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) {
+                    sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + elem), _mm_loadu_pd(x + elem)));
+                    sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(a + elem + 2), _mm_loadu_pd(x + elem + 2)));
+                }
+                double sum = hsumSSE2(_mm_add_pd(sum0, sum1));
+                for (; elem < n; elem++) sum += a[elem] * x[elem];
+                return sum;
+            }
+
+            BOP_SIMD_TARGET("sse2") inline float dotSSE2(uint_type n, const float* a, const float* x) {
+                __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + elem), _mm_loadu_ps(x + elem)));
+                    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + elem + 4), _mm_loadu_ps(x + elem + 4)));
+                }
+                float sum = hsumSSE2(_mm_add_ps(sum0, sum1));
+                for (; elem < n; elem++) sum += a[elem] * x[elem];
+                return sum;
+            }
+
+            BOP_SIMD_TARGET("sse2") inline void dot4SSE2(uint_type n, const double* a, uint_type lda, const double* x, double* out) {
+                const double* a1 = a + lda;
+                const double* a2 = a1 + lda;
+                const double* a3 = a2 + lda;
+                __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd(), sum2 = _mm_setzero_pd(), sum3 = _mm_setzero_pd();
+                uint_type elem = 0;
+                for (; elem + 2 <= n; elem += 2) {
+                    const __m128d vx = _mm_loadu_pd(x + elem);
+                    sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + elem), vx));
+                    sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(a1 + elem), vx));
+                    sum2 = _mm_add_pd(sum2, _mm_mul_pd(_mm_loadu_pd(a2 + elem), vx));
+                    sum3 = _mm_add_pd(sum3, _mm_mul_pd(_mm_loadu_pd(a3 + elem), vx));
+                }
+                out[0] = hsumSSE2(sum0);
+                out[1] = hsumSSE2(sum1);
+                out[2] = hsumSSE2(sum2);
+                out[3] = hsumSSE2(sum3);
+                for (; elem < n; elem++) {
+                    out[0] += a[elem] * x[elem];
+                    out[1] += a1[elem] * x[elem];
+                    out[2] += a2[elem] * x[elem];
+                    out[3] += a3[elem] * x[elem];
+                }
+            }
+
+            BOP_SIMD_TARGET("sse2") inline void dot4SSE2(uint_type n, const float* a, uint_type lda, const float* x, float* out) {
+                const float* a1 = a + lda;
+                const float* a2 = a1 + lda;
+                const float* a3 = a2 + lda;
+                __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) {
+                    const __m128 vx = _mm_loadu_ps(x + elem);
+                    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + elem), vx));
+                    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a1 + elem), vx));
+                    sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a2 + elem), vx));
+                    sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(a3 + elem), vx));
+                }
+                out[0] = hsumSSE2(sum0);
+                out[1] = hsumSSE2(sum1);
+                out[2] = hsumSSE2(sum2);
+                out[3] = hsumSSE2(sum3);
+                for (; elem < n; elem++) {
+                    out[0] += a[elem] * x[elem];
+                    out[1] += a1[elem] * x[elem];
+                    out[2] += a2[elem] * x[elem];
+                    out[3] += a3[elem] * x[elem];
+                }
+            }
+
+            /*
+                AVX2 kernels, two vectors per iteration to cover the add latency.
+            */
+            BOP_SIMD_TARGET("avx2") inline void axpyAVX2(uint_type n, double alpha, const double* x, double* y) {
+                const __m256d va = _mm256_set1_pd(alpha);
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    __m256d y0 = _mm256_add_pd(_mm256_loadu_pd(y + elem), _mm256_mul_pd(va, _mm256_loadu_pd(x + elem)));
+                    __m256d y1 = _mm256_add_pd(_mm256_loadu_pd(y + elem + 4), _mm256_mul_pd(va, _mm256_loadu_pd(x + elem + 4)));
+                    _mm256_storeu_pd(y + elem, y0);
+                    _mm256_storeu_pd(y + elem + 4, y1);
+                }
+                for (; elem + 4 <= n; elem += 4) {
+                    _mm256_storeu_pd(y + elem, _mm256_add_pd(_mm256_loadu_pd(y + elem), _mm256_mul_pd(va, _mm256_loadu_pd(x + elem))));
+                }
+                for (; elem < n; elem++) y[elem] += alpha * x[elem];
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void axpyAVX2(uint_type n, float alpha, const float* x, float* y) {
+                const __m256 va = _mm256_set1_ps(alpha);
+                uint_type elem = 0;
+                for (; elem + 16 <= n; elem += 16) {
+                    __m256 y0 = _mm256_add_ps(_mm256_loadu_ps(y + elem), _mm256_mul_ps(va, _mm256_loadu_ps(x + elem)));
+                    __m256 y1 = _mm256_add_ps(_mm256_loadu_ps(y + elem + 8), _mm256_mul_ps(va, _mm256_loadu_ps(x + elem + 8)));
+                    _mm256_storeu_ps(y + elem, y0);
+                    _mm256_storeu_ps(y + elem + 8, y1);
+                }
+                for (; elem + 8 <= n; elem += 8) {
+                    _mm256_storeu_ps(y + elem, _mm256_add_ps(_mm256_loadu_ps(y + elem), _mm256_mul_ps(va, _mm256_loadu_ps(x + elem))));
+                }
+                for (; elem < n; elem++) y[elem] += alpha * x[elem];
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void scalAVX2(uint_type n, double alpha, double* x) {
+                const __m256d va = _mm256_set1_pd(alpha);
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) _mm256_storeu_pd(x + elem, _mm256_mul_pd(va, _mm256_loadu_pd(x + elem)));
+                for (; elem < n; elem++) x[elem] *= alpha;
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void scalAVX2(uint_type n, float alpha, float* x) {
+                const __m256 va = _mm256_set1_ps(alpha);
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) _mm256_storeu_ps(x + elem, _mm256_mul_ps(va, _mm256_loadu_ps(x + elem)));
+                for (; elem < n; elem++) x[elem] *= alpha;
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void convertAVX2(uint_type n, const float* x, double* y) {
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    _mm256_storeu_pd(y + elem, _mm256_cvtps_pd(_mm_loadu_ps(x + elem)));
+                    _mm256_storeu_pd(y + elem + 4, _mm256_cvtps_pd(_mm_loadu_ps(x + elem + 4)));
+                }
+                for (; elem < n; elem++) y[elem] = x[elem];
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void convertAVX2(uint_type n, const double* x, float* y) {
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    _mm_storeu_ps(y + elem, _mm256_cvtpd_ps(_mm256_loadu_pd(x + elem)));
+                    _mm_storeu_ps(y + elem + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(x + elem + 4)));
+                }
+                for (; elem < n; elem++) y[elem] = static_cast<float>(x[elem]);
+            }
+
+            BOP_SIMD_TARGET("avx2") inline double hsumAVX2(__m256d v) {
+                const __m128d halves = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+                return _mm_cvtsd_f64(_mm_add_sd(halves, _mm_unpackhi_pd(halves, halves)));
+            }
+
+            BOP_SIMD_TARGET("avx2") inline float hsumAVX2(__m256 v) {
+                const __m128 halves = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+                const __m128 pairs = _mm_add_ps(halves, _mm_movehl_ps(halves, halves));
+                return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+            }
+
+            BOP_SIMD_TARGET("avx2") inline double dotAVX2(uint_type n, const double* a, const double* x) {
+                __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(a + elem), _mm256_loadu_pd(x + elem)));
+                    sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(a + elem + 4), _mm256_loadu_pd(x + elem + 4)));
+                }
+                double sum = hsumAVX2(_mm256_add_pd(sum0, sum1));
+                for (; elem < n; elem++) sum += a[elem] * x[elem];
+                return sum;
+            }
+
+            BOP_SIMD_TARGET("avx2") inline float dotAVX2(uint_type n, const float* a, const float* x) {
+                __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+                uint_type elem = 0;
+                for (; elem + 16 <= n; elem += 16) {
+                    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + elem), _mm256_loadu_ps(x + elem)));
+                    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + elem + 8), _mm256_loadu_ps(x + elem + 8)));
+                }
+                float sum = hsumAVX2(_mm256_add_ps(sum0, sum1));
+                for (; elem < n; elem++) sum += a[elem] * x[elem];
+                return sum;
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void dot4AVX2(uint_type n, const double* a, uint_type lda, const double* x, double* out) {
+                const double* a1 = a + lda;
+                const double* a2 = a1 + lda;
+                const double* a3 = a2 + lda;
+                __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd(), sum2 = _mm256_setzero_pd(), sum3 = _mm256_setzero_pd();
+                uint_type elem = 0;
+                for (; elem + 4 <= n; elem += 4) {
+                    const __m256d vx = _mm256_loadu_pd(x + elem);
+                    sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(a + elem), vx));
+                    sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(a1 + elem), vx));
+                    sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(_mm256_loadu_pd(a2 + elem), vx));
+                    sum3 = _mm256_add_pd(sum3, _mm256_mul_pd(_mm256_loadu_pd(a3 + elem), vx));
+                }
+                out[0] = hsumAVX2(sum0);
+                out[1] = hsumAVX2(sum1);
+                out[2] = hsumAVX2(sum2);
+                out[3] = hsumAVX2(sum3);
+                for (; elem < n; elem++) {
+                    out[0] += a[elem] * x[elem];
+                    out[1] += a1[elem] * x[elem];
+                    out[2] += a2[elem] * x[elem];
+                    out[3] += a3[elem] * x[elem];
+                }
+            }
+
+            BOP_SIMD_TARGET("avx2") inline void dot4AVX2(uint_type n, const float* a, uint_type lda, const float* x, float* out) {
+                const float* a1 = a + lda;
+                const float* a2 = a1 + lda;
+                const float* a3 = a2 + lda;
+                __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    const __m256 vx = _mm256_loadu_ps(x + elem);
+                    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + elem), vx));
+                    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a1 + elem), vx));
+                    sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_loadu_ps(a2 + elem), vx));
+                    sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(_mm256_loadu_ps(a3 + elem), vx));
+                }
+                out[0] = hsumAVX2(sum0);
+                out[1] = hsumAVX2(sum1);
+                out[2] = hsumAVX2(sum2);
+                out[3] = hsumAVX2(sum3);
+                for (; elem < n; elem++) {
+                    out[0] += a[elem] * x[elem];
+                    out[1] += a1[elem] * x[elem];
+                    out[2] += a2[elem] * x[elem];
+                    out[3] += a3[elem] * x[elem];
+                }
+            }
+
+            /*
+                AVX-512 kernels.
+            */
+            BOP_SIMD_TARGET("avx512f") inline void axpyAVX512(uint_type n, double alpha, const double* x, double* y) {
+                const __m512d va = _mm512_set1_pd(alpha);
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    _mm512_storeu_pd(y + elem, _mm512_add_pd(_mm512_loadu_pd(y + elem), _mm512_mul_pd(va, _mm512_loadu_pd(x + elem))));
+                }
+                for (; elem < n; elem++) y[elem] += alpha * x[elem];
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline void axpyAVX512(uint_type n, float alpha, const float* x, float* y) {
+                const __m512 va = _mm512_set1_ps(alpha);
+                uint_type elem = 0;
+                for (; elem + 16 <= n; elem += 16) {
+                    _mm512_storeu_ps(y + elem, _mm512_add_ps(_mm512_loadu_ps(y + elem), _mm512_mul_ps(va, _mm512_loadu_ps(x + elem))));
+                }
+                for (; elem < n; elem++) y[elem] += alpha * x[elem];
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline void scalAVX512(uint_type n, double alpha, double* x) {
+                const __m512d va = _mm512_set1_pd(alpha);
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) _mm512_storeu_pd(x + elem, _mm512_mul_pd(va, _mm512_loadu_pd(x + elem)));
+                for (; elem < n; elem++) x[elem] *= alpha;
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline void scalAVX512(uint_type n, float alpha, float* x) {
+                const __m512 va = _mm512_set1_ps(alpha);
+                uint_type elem = 0;
+                for (; elem + 16 <= n; elem += 16) _mm512_storeu_ps(x + elem, _mm512_mul_ps(va, _mm512_loadu_ps(x + elem)));
+                for (; elem < n; elem++) x[elem] *= alpha;
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline void convertAVX512(uint_type n, const float* x, double* y) {
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) _mm512_storeu_pd(y + elem, _mm512_cvtps_pd(_mm256_loadu_ps(x + elem)));
+                for (; elem < n; elem++) y[elem] = x[elem];
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline void convertAVX512(uint_type n, const double* x, float* y) {
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) _mm256_storeu_ps(y + elem, _mm512_cvtpd_ps(_mm512_loadu_pd(x + elem)));
+                for (; elem < n; elem++) y[elem] = static_cast<float>(x[elem]);
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline double dotAVX512(uint_type n, const double* a, const double* x) {
+                __m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd();
+                uint_type elem = 0;
+                for (; elem + 16 <= n; elem += 16) {
+                    sum0 = _mm512_add_pd(sum0, _mm512_mul_pd(_mm512_loadu_pd(a + elem), _mm512_loadu_pd(x + elem)));
+                    sum1 = _mm512_add_pd(sum1, _mm512_mul_pd(_mm512_loadu_pd(a + elem + 8), _mm512_loadu_pd(x + elem + 8)));
+                }
+                double sum = _mm512_reduce_add_pd(_mm512_add_pd(sum0, sum1));
+                for (; elem < n; elem++) sum += a[elem] * x[elem];
+                return sum;
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline float dotAVX512(uint_type n, const float* a, const float* x) {
+                __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+                uint_type elem = 0;
+                for (; elem + 32 <= n; elem += 32) {
+                    sum0 = _mm512_add_ps(sum0, _mm512_mul_ps(_mm512_loadu_ps(a + elem), _mm512_loadu_ps(x + elem)));
+                    sum1 = _mm512_add_ps(sum1, _mm512_mul_ps(_mm512_loadu_ps(a + elem + 16), _mm512_loadu_ps(x + elem + 16)));
+                }
+                float sum = _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1));
+                for (; elem < n; elem++) sum += a[elem] * x[elem];
+                return sum;
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline void dot4AVX512(uint_type n, const double* a, uint_type lda, const double* x, double* out) {
+                const double* a1 = a + lda;
+                const double* a2 = a1 + lda;
+                const double* a3 = a2 + lda;
+                __m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd(), sum2 = _mm512_setzero_pd(), sum3 = _mm512_setzero_pd();
+                uint_type elem = 0;
+                for (; elem + 8 <= n; elem += 8) {
+                    const __m512d vx = _mm512_loadu_pd(x + elem);
+                    sum0 = _mm512_add_pd(sum0, _mm512_mul_pd(_mm512_loadu_pd(a + elem), vx));
+                    sum1 = _mm512_add_pd(sum1, _mm512_mul_pd(_mm512_loadu_pd(a1 + elem), vx));
+                    sum2 = _mm512_add_pd(sum2, _mm512_mul_pd(_mm512_loadu_pd(a2 + elem), vx));
+                    sum3 = _mm512_add_pd(sum3, _mm512_mul_pd(_mm512_loadu_pd(a3 + elem), vx));
+                }
+                out[0] = _mm512_reduce_add_pd(sum0);
+                out[1] = _mm512_reduce_add_pd(sum1);
+                out[2] = _mm512_reduce_add_pd(sum2);
+                out[3] = _mm512_reduce_add_pd(sum3);
+                for (; elem < n; elem++) {
+                    out[0] += a[elem] * x[elem];
+                    out[1] += a1[elem] * x[elem];
+                    out[2] += a2[elem] * x[elem];
+                    out[3] += a3[elem] * x[elem];
+                }
+            }
+
+            BOP_SIMD_TARGET("avx512f") inline void dot4AVX512(uint_type n, const float* a, uint_type lda, const float* x, float* out) {
+                const float* a1 = a + lda;
+                const float* a2 = a1 + lda;
+                const float* a3 = a2 + lda;
+                __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps(), sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+                uint_type elem = 0;
+                for (; elem + 16 <= n; elem += 16) {
+                    const __m512 vx = _mm512_loadu_ps(x + elem);
+                    sum0 = _mm512_add_ps(sum0, _mm512_mul_ps(_mm512_loadu_ps(a + elem), vx));
+                    sum1 = _mm512_add_ps(sum1, _mm512_mul_ps(_mm512_loadu_ps(a1 + elem), vx));
+                    sum2 = _mm512_add_ps(sum2, _mm512_mul_ps(_mm512_loadu_ps(a2 + elem), vx));
+                    sum3 = _mm512_add_ps(sum3, _mm512_mul_ps(_mm512_loadu_ps(a3 + elem), vx));
+                }
+                out[0] = _mm512_reduce_add_ps(sum0);
+                out[1] = _mm512_reduce_add_ps(sum1);
+                out[2] = _mm512_reduce_add_ps(sum2);
+                out[3] = _mm512_reduce_add_ps(sum3);
+                for (; elem < n; elem++) {
+                    out[0] += a[elem] * x[elem];
+                    out[1] += a1[elem] * x[elem];
+                    out[2] += a2[elem] * x[elem];
+                    out[3] += a3[elem] * x[elem];
+                }
+            }
+            #endif
+
+            template<class T>
+            struct ElementKernels {
+                /*
+                    Table of element-wise kernels for a type, resolved once
+                    against simd::level(). The resolve functions also take a
+                    lower level, to compare each level's kernels with the
+                    scalar ones.
+                */
+                typedef void (*axpy_function)(uint_type, T, const T*, T*);
+                typedef void (*scal_function)(uint_type, T, T*);
+                typedef void (*stream_function)(uint_type, const T*, T*);
+                typedef T (*dot_function)(uint_type, const T*, const T*);
+                typedef void (*dot4_function)(uint_type, const T*, uint_type, const T*, T*);
+
+                static axpy_function resolveAxpy(std::false_type, simd::Level = simd::level()) {
+                    return axpyScalar<T>;
+                }
+
+                static scal_function resolveScal(std::false_type, simd::Level = simd::level()) {
+                    return scalScalar<T>;
+                }
+
+                static stream_function resolveStream(std::false_type, simd::Level = simd::level()) {
+                    return streamScalar<T>;
+                }
+
+                static dot_function resolveDot(std::false_type, simd::Level = simd::level()) {
+                    return dotScalar<T>;
+                }
+
+                static dot4_function resolveDot4(std::false_type, simd::Level = simd::level()) {
+                    return dot4Scalar<T>;
+                }
+
+                static axpy_function resolveAxpy(std::true_type, simd::Level lvl = simd::level()) {
+                    #ifdef BOP_SIMD_X86
+                    switch (lvl) {
+                        case simd::avx512: return static_cast<axpy_function>(axpyAVX512);
+                        case simd::avx2: return static_cast<axpy_function>(axpyAVX2);
+                        case simd::sse2: return static_cast<axpy_function>(axpySSE2);
+                        default: break;
+                    }
+                    #endif
+                    return axpyScalar<T>;
+                }
+
+                static scal_function resolveScal(std::true_type, simd::Level lvl = simd::level()) {
+                    #ifdef BOP_SIMD_X86
+                    switch (lvl) {
+                        case simd::avx512: return static_cast<scal_function>(scalAVX512);
+                        case simd::avx2: return static_cast<scal_function>(scalAVX2);
+                        case simd::sse2: return static_cast<scal_function>(scalSSE2);
+                        default: break;
+                    }
+                    #endif
+                    return scalScalar<T>;
+                }
+
+                static stream_function resolveStream(std::true_type, simd::Level lvl = simd::level()) {
+                    #ifdef BOP_SIMD_X86
+                    if (lvl >= simd::sse2) return static_cast<stream_function>(streamSSE2);
+                    #endif
+                    return streamScalar<T>;
+                }
+
+                static dot_function resolveDot(std::true_type, simd::Level lvl = simd::level()) {
+                    #ifdef BOP_SIMD_X86
+                    switch (lvl) {
+                        case simd::avx512: return static_cast<dot_function>(dotAVX512);
+                        case simd::avx2: return static_cast<dot_function>(dotAVX2);
+                        case simd::sse2: return static_cast<dot_function>(dotSSE2);
+                        default: break;
+                    }
+                    #endif
+                    return dotScalar<T>;
+                }
+
+                static dot4_function resolveDot4(std::true_type, simd::Level lvl = simd::level()) {
+                    #ifdef BOP_SIMD_X86
+                    switch (lvl) {
+                        case simd::avx512: return static_cast<dot4_function>(dot4AVX512);
+                        case simd::avx2: return static_cast<dot4_function>(dot4AVX2);
+                        case simd::sse2: return static_cast<dot4_function>(dot4SSE2);
+                        default: break;
+                    }
+                    #endif
+                    return dot4Scalar<T>;
+                }
+
+                typedef std::integral_constant<bool, std::is_same<T,float>::value || std::is_same<T,double>::value> vectorised;
+
+                static axpy_function axpy() {
+                    static const axpy_function function = resolveAxpy(vectorised());
+                    return function;
+                }
+
+                static scal_function scal() {
+                    static const scal_function function = resolveScal(vectorised());
+                    return function;
+                }
+
+                static stream_function stream() {
+                    static const stream_function function = resolveStream(vectorised());
+                    return function;
+                }
+
+                static dot_function dot() {
+                    static const dot_function function = resolveDot(vectorised());
+                    return function;
+                }
+
+                static dot4_function dot4() {
+                    static const dot4_function function = resolveDot4(vectorised());
+                    return function;
+                }
+            };
+
+            template<class S, class T>
+            struct ConversionKernels {
+                /*
+                    Conversion from S to T, vectorised between float and
+                    double in either direction.
+                */
+                typedef void (*convert_function)(uint_type, const S*, T*);
+
+                static convert_function resolveConvert(std::false_type, simd::Level = simd::level()) {
+                    return convertScalar<S,T>;
+                }
+
+                static convert_function resolveConvert(std::true_type, simd::Level lvl = simd::level()) {
+                    #ifdef BOP_SIMD_X86
+                    switch (lvl) {
+                        case simd::avx512: return static_cast<convert_function>(convertAVX512);
+                        case simd::avx2: return static_cast<convert_function>(convertAVX2);
+                        case simd::sse2: return static_cast<convert_function>(convertSSE2);
+                        default: break;
+                    }
+                    #endif
+                    return convertScalar<S,T>;
+                }
+
+                typedef std::integral_constant<bool, (std::is_same<S,float>::value && std::is_same<T,double>::value)
+                                                     || (std::is_same<S,double>::value && std::is_same<T,float>::value)> vectorised;
+
+                static convert_function convert() {
+                    static const convert_function function = resolveConvert(vectorised());
+                    return function;
+                }
+            };
+
+            template<class T>
+            inline void axpy(uint_type n, T alpha, const T* x, T* y) {
+                /*
+                    y += alpha * x over n contiguous elements.
+                */
+                ElementKernels<T>::axpy()(n, alpha, x, y);
+            }
+
+            template<class T>
+            inline void scal(uint_type n, T alpha, T* x) {
+                /*
+                    x *= alpha over n contiguous elements.
+                */
+                ElementKernels<T>::scal()(n, alpha, x);
+            }
+
+            template<class T>
+            inline void stream(uint_type n, const T* x, T* y) {
+                /*
+                    y = x over n contiguous elements, without pulling y into
+                    the cache. Only worth it for output that will not be read
+                    again soon, and must be followed by streamFence() before
+                    another thread reads y.
+                */
+                ElementKernels<T>::stream()(n, x, y);
+            }
+
+            template<class T>
+            inline T dot(uint_type n, const T* a, const T* x) {
+                /*
+                    The dot product of n contiguous elements of a and x.
+                */
+                return ElementKernels<T>::dot()(n, a, x);
+            }
+
+            template<class T>
+            inline void dot4(uint_type n, const T* a, uint_type lda, const T* x, T* out) {
+                /*
+                    out[row] = the dot product of x with a + row*lda, for the
+                    four rows of a at once.
+                */
+                ElementKernels<T>::dot4()(n, a, lda, x, out);
+            }
+
+            template<class S, class T>
+            inline void convert(uint_type n, const S* x, T* y) {
+                /*
+                    y = x over n contiguous elements, converting each from S
+                    to T.
+                */
+                ConversionKernels<S,T>::convert()(n, x, y);
+            }
+
+            inline void streamFence() {
+                #ifdef BOP_SIMD_X86
+                _mm_sfence();
+                #endif
+            }
+        }
+    }
+}
+
+#endif
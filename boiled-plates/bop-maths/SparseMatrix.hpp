@@ -0,0 +1,338 @@
+#ifndef BOP_SPARSE_MATRIX_HPP
+#define BOP_SPARSE_MATRIX_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include "../bop-defaults/types.hpp"
+#include "SIMD.hpp"
+#include "Matrix.hpp"
+
+/*
+    bop::maths::SparseMatrix class file
+
+    Compressed sparse storage, either by rows (CSR) or by columns (CSC).
+    Each row (or column) is a run of nonzero values and the indices of the
+    columns (or rows) they sit in, sorted ascending, with offsets marking
+    where each run starts. Memory and the cost of products scale with the
+    number of nonzeros rather than with width times height.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            template<class T>
+            void spmmRows(uint_type row_begin, uint_type row_end, uint_type columns,
+                          const uint_type* offsets, const uint_type* indices, const T* values,
+                          const T* b, uint_type ldb, T* c, uint_type ldc) {
+                /*
+                    Rows [row_begin, row_end) of C = S*B for a CSR matrix S,
+                    overwriting those rows of C. Every row is written by one
+                    caller only, so disjoint row ranges may run concurrently.
+                */
+                if (columns == 1) {
+                    for (uint_type row = row_begin; row < row_end; row++) {
+                        T sum = T(0);
+                        for (uint_type nz = offsets[row]; nz < offsets[row + 1]; nz++) sum += values[nz] * b[indices[nz] * ldb];
+                        c[row * ldc] = sum;
+                    }
+                    return;
+                }
+                for (uint_type row = row_begin; row < row_end; row++) {
+                    T* c_row = c + (row * ldc);
+                    std::fill(c_row, c_row + columns, T(0));
+                    for (uint_type nz = offsets[row]; nz < offsets[row + 1]; nz++) {
+                        axpy<T>(columns, values[nz], b + (indices[nz] * ldb), c_row);
+                    }
+                }
+            }
+
+            template<class T>
+            void spmmColumns(uint_type col_begin, uint_type col_end, uint_type columns,
+                             const uint_type* offsets, const uint_type* indices, const T* values,
+                             const T* b, uint_type ldb, T* c, uint_type ldc) {
+                /*
+                    Accumulates the contribution of columns [col_begin, col_end)
+                    of a CSC matrix S to C = S*B. Each column scatters into
+                    arbitrary rows of C, so C must be zeroed beforehand.
+                */
+                for (uint_type col = col_begin; col < col_end; col++) {
+                    const T* b_row = b + (col * ldb);
+                    for (uint_type nz = offsets[col]; nz < offsets[col + 1]; nz++) {
+                        if (columns == 1) c[indices[nz] * ldc] += values[nz] * b_row[0];
+                        else axpy<T>(columns, values[nz], b_row, c + (indices[nz] * ldc));
+                    }
+                }
+            }
+        }
+
+        template<class T>
+        class SparseMatrix {
+            public:
+                enum Format {
+                    csr,
+                    csc
+                };
+
+                struct Entry {
+                    uint_type row;
+                    uint_type col;
+                    T value;
+                };
+
+            protected:
+                uint_type sparse_width;
+                uint_type sparse_height;
+                Format sparse_format;
+                /*
+                    offsets has one more element than there are rows (CSR) or
+                    columns (CSC), run i being [offsets[i], offsets[i + 1]) of
+                    indices and values.
+                */
+                std::vector<uint_type> offsets;
+                std::vector<uint_type> indices;
+                std::vector<T> values;
+
+                inline uint_type majorCount() const {
+                    return (this->sparse_format == csr) ? this->sparse_height : this->sparse_width;
+                }
+
+                inline uint_type minorCount() const {
+                    return (this->sparse_format == csr) ? this->sparse_width : this->sparse_height;
+                }
+
+                static void compress(uint_type major_count, uint_type minor_count,
+                                     const std::vector<uint_type>& majors, const std::vector<uint_type>& minors, const std::vector<T>& entry_values,
+                                     std::vector<uint_type>& out_offsets, std::vector<uint_type>& out_indices, std::vector<T>& out_values) {
+                    /*
+                        Sorts unordered (major, minor, value) entries into
+                        compressed runs with two stable counting sorts, first by
+                        minor then by major, then sums duplicate entries.
+                    */
+                    const uint_type count = majors.size();
+                    std::vector<uint_type> by_minor(count), order(count);
+                    std::vector<uint_type> bucket(minor_count + 1, 0);
+                    for (uint_type elem = 0; elem < count; elem++) bucket[minors[elem] + 1]++;
+                    for (uint_type elem = 0; elem < minor_count; elem++) bucket[elem + 1] += bucket[elem];
+                    for (uint_type elem = 0; elem < count; elem++) by_minor[bucket[minors[elem]]++] = elem;
+                    out_offsets.assign(major_count + 1, 0);
+                    for (uint_type elem = 0; elem < count; elem++) out_offsets[majors[elem] + 1]++;
+                    for (uint_type elem = 0; elem < major_count; elem++) out_offsets[elem + 1] += out_offsets[elem];
+                    bucket.assign(out_offsets.begin(), out_offsets.end() - 1);
+                    for (uint_type elem = 0; elem < count; elem++) order[bucket[majors[by_minor[elem]]]++] = by_minor[elem];
+                    out_indices.clear();
+                    out_values.clear();
+                    out_indices.reserve(count);
+                    out_values.reserve(count);
+                    uint_type run_start = 0;
+                    for (uint_type major = 0; major < major_count; major++) {
+                        const uint_type begin = out_offsets[major], end = out_offsets[major + 1];
+                        out_offsets[major] = run_start;
+                        for (uint_type elem = begin; elem < end; elem++) {
+                            const uint_type entry = order[elem];
+                            if (out_indices.size() > run_start && out_indices.back() == minors[entry]) out_values.back() += entry_values[entry];
+                            else {
+                                out_indices.push_back(minors[entry]);
+                                out_values.push_back(entry_values[entry]);
+                            }
+                        }
+                        run_start = out_indices.size();
+                    }
+                    out_offsets[major_count] = run_start;
+                }
+
+            public:
+                typedef T value_type;
+
+                //Constructors
+
+                SparseMatrix() : sparse_width(0), sparse_height(0), sparse_format(csr), offsets(1, 0) {
+                }
+
+                SparseMatrix(uint_type width, uint_type height, Format format = csr) :
+                    sparse_width(width), sparse_height(height), sparse_format(format) {
+                    /*
+                        A width by height matrix of zeros.
+                    */
+                    this->offsets.assign(this->majorCount() + 1, 0);
+                }
+
+                SparseMatrix(uint_type width, uint_type height, const std::vector<Entry>& entries, Format format = csr) :
+                    SparseMatrix(width, height, format) {
+                    /*
+                        Builds the matrix from (row, col, value) entries in any
+                        order, entries at the same position are summed.
+                    */
+                    std::vector<uint_type> majors(entries.size()), minors(entries.size());
+                    std::vector<T> entry_values(entries.size());
+                    for (uint_type elem = 0; elem < entries.size(); elem++) {
+                        majors[elem] = (format == csr) ? entries[elem].row : entries[elem].col;
+                        minors[elem] = (format == csr) ? entries[elem].col : entries[elem].row;
+                        entry_values[elem] = entries[elem].value;
+                    }
+                    compress(this->majorCount(), this->minorCount(), majors, minors, entry_values, this->offsets, this->indices, this->values);
+                }
+
+                SparseMatrix(uint_type width, uint_type height, std::vector<uint_type> offsets, std::vector<uint_type> indices, std::vector<T> values, Format format = csr) :
+                    sparse_width(width), sparse_height(height), sparse_format(format),
+                    offsets(std::move(offsets)), indices(std::move(indices)), values(std::move(values)) {
+                    /*
+                        Adopts already compressed arrays, whose runs must be sorted
+                        and free of duplicates.
+                    */
+                }
+
+                SparseMatrix(const Matrix<T>& mat, Format format = csr) : SparseMatrix(mat.width(), mat.height(), csr) {
+                    /*
+                        Keeps the nonzero elements of a dense matrix.
+                    */
+                    for (uint_type row = 0; row < mat.height(); row++) {
+                        const T* mat_row = mat.rowData(row);
+                        for (uint_type col = 0; col < mat.width(); col++) {
+                            if (mat_row[col] != T(0)) {
+                                this->indices.push_back(col);
+                                this->values.push_back(mat_row[col]);
+                            }
+                        }
+                        this->offsets[row + 1] = this->indices.size();
+                    }
+                    if (format == csc) (*this) = this->compressed(csc);
+                }
+
+                //Conversion
+
+                SparseMatrix<T> compressed(Format format) const {
+                    /*
+                        The same matrix stored by rows or by columns. Changing
+                        format is a counting sort over the nonzeros.
+                    */
+                    if (format == this->sparse_format) return *this;
+                    SparseMatrix<T> sparse(this->sparse_width, this->sparse_height, format);
+                    const uint_type minor_count = this->minorCount();
+                    const uint_type count = this->nonZeros();
+                    sparse.indices.resize(count);
+                    sparse.values.resize(count);
+                    for (uint_type nz = 0; nz < count; nz++) sparse.offsets[this->indices[nz] + 1]++;
+                    for (uint_type elem = 0; elem < minor_count; elem++) sparse.offsets[elem + 1] += sparse.offsets[elem];
+                    std::vector<uint_type> next(sparse.offsets.begin(), sparse.offsets.end() - 1);
+                    for (uint_type major = 0; major < this->majorCount(); major++) {
+                        for (uint_type nz = this->offsets[major]; nz < this->offsets[major + 1]; nz++) {
+                            const uint_type dest = next[this->indices[nz]]++;
+                            sparse.indices[dest] = major;
+                            sparse.values[dest] = this->values[nz];
+                        }
+                    }
+                    return sparse;
+                }
+
+                Matrix<T> dense() const {
+                    Matrix<T> mat(this->sparse_width, this->sparse_height, 0);
+                    for (uint_type major = 0; major < this->majorCount(); major++) {
+                        for (uint_type nz = this->offsets[major]; nz < this->offsets[major + 1]; nz++) {
+                            if (this->sparse_format == csr) mat.element(major, this->indices[nz]) = this->values[nz];
+                            else mat.element(this->indices[nz], major) = this->values[nz];
+                        }
+                    }
+                    return mat;
+                }
+
+                SparseMatrix<T> transposed() const {
+                    /*
+                        The rows stored by CSR are the columns of the transpose
+                        stored by CSC, so transposing only relabels the format.
+                    */
+                    return SparseMatrix<T>(this->sparse_height, this->sparse_width, this->offsets, this->indices, this->values,
+                                           (this->sparse_format == csr) ? csc : csr);
+                }
+
+                //Products
+
+                void multiply(const T* b, uint_type columns, uint_type ldb, T* c, uint_type ldc) const {
+                    /*
+                        C = S*B, where B is width by columns and C is height by
+                        columns, both row-major.
+                    */
+                    if (this->sparse_format == csr) {
+                        kernel::spmmRows<T>(0, this->sparse_height, columns, this->offsets.data(), this->indices.data(), this->values.data(), b, ldb, c, ldc);
+                        return;
+                    }
+                    for (uint_type row = 0; row < this->sparse_height; row++) std::fill(c + (row * ldc), c + (row * ldc) + columns, T(0));
+                    kernel::spmmColumns<T>(0, this->sparse_width, columns, this->offsets.data(), this->indices.data(), this->values.data(), b, ldb, c, ldc);
+                }
+
+                //Information functions
+
+                T element(uint_type row, uint_type col) const {
+                    /*
+                        The value at (row, col), found by binary search of its
+                        run, zero if it is not stored.
+                    */
+                    const uint_type major = (this->sparse_format == csr) ? row : col;
+                    const uint_type minor = (this->sparse_format == csr) ? col : row;
+                    auto begin = this->indices.begin() + this->offsets[major];
+                    auto end = this->indices.begin() + this->offsets[major + 1];
+                    auto found = std::lower_bound(begin, end, minor);
+                    if (found == end || *found != minor) return T(0);
+                    return this->values[found - this->indices.begin()];
+                }
+
+                inline uint_type width() const {
+                    return this->sparse_width;
+                }
+
+                inline uint_type height() const {
+                    return this->sparse_height;
+                }
+
+                inline uint_type nonZeros() const {
+                    return this->values.size();
+                }
+
+                inline Format format() const {
+                    return this->sparse_format;
+                }
+
+                inline const std::vector<uint_type>& offsetData() const {
+                    return this->offsets;
+                }
+
+                inline const std::vector<uint_type>& indexData() const {
+                    return this->indices;
+                }
+
+                inline const std::vector<T>& valueData() const {
+                    return this->values;
+                }
+        };
+
+        template<class T>
+        Matrix<T> operator* (const SparseMatrix<T>& sparse, const Matrix<T>& mat) {
+            Matrix<T> mat_p(mat.width(), sparse.height());
+            if (sparse.width() != mat.height()) return mat_p;
+            sparse.multiply(mat.rowData(0), mat.width(), mat.stride(), mat_p.rowData(0), mat_p.stride());
+            return mat_p;
+        }
+
+        template<class T>
+        std::ostream& operator<< (std::ostream& stream, const SparseMatrix<T>& sparse) {
+            /*
+                Lists the nonzeros as (row,col) value in row order.
+            */
+            const SparseMatrix<T> by_rows = sparse.compressed(SparseMatrix<T>::csr);
+            stream << sparse.width() << "x" << sparse.height() << " sparse matrix with " << sparse.nonZeros() << " nonzeros" << std::endl;
+            for (uint_type row = 0; row < by_rows.height(); row++) {
+                for (uint_type nz = by_rows.offsetData()[row]; nz < by_rows.offsetData()[row + 1]; nz++) {
+                    stream << "(" << row << "," << by_rows.indexData()[nz] << ") " << by_rows.valueData()[nz] << std::endl;
+                }
+            }
+            return stream;
+        }
+    }
+}
+
+#endif
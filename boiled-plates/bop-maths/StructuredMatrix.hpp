@@ -0,0 +1,556 @@
+#ifndef BOP_STRUCTURED_MATRIX_HPP
+#define BOP_STRUCTURED_MATRIX_HPP
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <initializer_list>
+#include "../bop-defaults/types.hpp"
+#include "SIMD.hpp"
+#include "MatrixExpression.hpp"
+
+/*
+    bop::maths structured matrix file
+
+    Scaled identity, diagonal and permutation matrices held implicitly, by
+    their scale, diagonal or permutation alone. A product of one with a
+    matrix only scales or reorders rows or columns, so it costs O(n^2)
+    instead of the O(n^3) of a dense product and no n by n operand is
+    ever formed, and a sum with a matrix only updates its diagonal. They
+    are expression leaves as well, so they combine with any other
+    expression and convert to a dense Matrix wherever one is expected.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        template<class T>
+        class Matrix;
+
+        template<class T>
+        class Vector;
+
+        template<class T>
+        class ScaledIdentity : public MatrixExpression< ScaledIdentity<T> > {
+            /*
+                The identity matrix multiplied by a scalar.
+            */
+            protected:
+                uint_type matrix_size;
+                T matrix_scale;
+
+            public:
+                typedef T value_type;
+
+                ScaledIdentity(uint_type size, T scale = T(1)) : matrix_size(size), matrix_scale(scale) {
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->matrix_size;
+                }
+
+                inline uint_type width() const {
+                    return this->matrix_size;
+                }
+
+                inline uint_type height() const {
+                    return this->matrix_size;
+                }
+
+                inline T scale() const {
+                    return this->matrix_scale;
+                }
+
+                inline bool conformant(uint_type, uint_type) const {
+                    return false;
+                }
+
+                inline T element(uint_type elem) const {
+                    return this->element(elem / this->matrix_size, elem % this->matrix_size);
+                }
+
+                inline T element(uint_type row, uint_type col) const {
+                    return (row == col) ? this->matrix_scale : T(0);
+                }
+
+                inline Matrix<T> eval() const {
+                    return Matrix<T>(*this);
+                }
+
+                T det() const {
+                    T deter = T(1);
+                    for (uint_type elem = 0; elem < this->matrix_size; elem++) deter *= this->matrix_scale;
+                    return deter;
+                }
+
+                //Transformations
+
+                inline ScaledIdentity<T> transposed() const {
+                    return *this;
+                }
+
+                inline ScaledIdentity<T> inverted() const {
+                    /*
+                        A zero scale is singular and is returned unchanged, as
+                        by Matrix::invert.
+                    */
+                    return (this->matrix_scale != T(0)) ? ScaledIdentity<T>(this->matrix_size, T(1) / this->matrix_scale) : *this;
+                }
+        };
+
+        template<class T>
+        class DiagonalMatrix : public MatrixExpression< DiagonalMatrix<T> > {
+            /*
+                A square matrix that is zero off its diagonal.
+            */
+            protected:
+                std::vector<T> diagonal;
+
+            public:
+                typedef T value_type;
+
+                DiagonalMatrix(uint_type size, T fill = T(0)) : diagonal(size, fill) {
+                }
+
+                DiagonalMatrix(std::vector<T> entries) : diagonal(std::move(entries)) {
+                }
+
+                DiagonalMatrix(std::initializer_list<T> list) : diagonal(list) {
+                }
+
+                DiagonalMatrix(const ScaledIdentity<T>& scaled) : diagonal(scaled.size(), scaled.scale()) {
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->diagonal.size();
+                }
+
+                inline uint_type width() const {
+                    return this->diagonal.size();
+                }
+
+                inline uint_type height() const {
+                    return this->diagonal.size();
+                }
+
+                inline T& operator[] (uint_type index) {
+                    return this->diagonal[index];
+                }
+
+                inline const T& operator[] (uint_type index) const {
+                    return this->diagonal[index];
+                }
+
+                inline const std::vector<T>& entries() const {
+                    return this->diagonal;
+                }
+
+                inline bool conformant(uint_type, uint_type) const {
+                    return false;
+                }
+
+                inline T element(uint_type elem) const {
+                    return this->element(elem / this->size(), elem % this->size());
+                }
+
+                inline T element(uint_type row, uint_type col) const {
+                    return (row == col) ? this->diagonal[row] : T(0);
+                }
+
+                inline Matrix<T> eval() const {
+                    return Matrix<T>(*this);
+                }
+
+                T det() const {
+                    T deter = T(1);
+                    for (const T& entry : this->diagonal) deter *= entry;
+                    return deter;
+                }
+
+                //Transformations
+
+                inline DiagonalMatrix<T> transposed() const {
+                    return *this;
+                }
+
+                DiagonalMatrix<T> inverted() const {
+                    /*
+                        A singular diagonal is returned unchanged, as by
+                        Matrix::invert.
+                    */
+                    for (const T& entry : this->diagonal) {
+                        if (entry == T(0)) return *this;
+                    }
+                    DiagonalMatrix<T> inverse(this->size());
+                    for (uint_type elem = 0; elem < this->size(); elem++) inverse.diagonal[elem] = T(1) / this->diagonal[elem];
+                    return inverse;
+                }
+
+                //Products written into storage the caller owns.
+
+                void scaleRows(Matrix<T>& mat) const {
+                    /*
+                        mat = D * mat, each row multiplied by its diagonal
+                        entry. Does nothing if mat does not have size() rows.
+                    */
+                    if (mat.height() != this->size()) return;
+                    for (uint_type row = 0; row < mat.height(); row++) kernel::scal<T>(mat.width(), this->diagonal[row], mat.rowData(row));
+                }
+
+                void scaleColumns(Matrix<T>& mat) const {
+                    /*
+                        mat = mat * D, each column multiplied by its diagonal
+                        entry. Does nothing if mat does not have size()
+                        columns.
+                    */
+                    if (mat.width() != this->size()) return;
+                    const T* scales = this->diagonal.data();
+                    for (uint_type row = 0; row < mat.height(); row++) {
+                        T* row_data = mat.rowData(row);
+                        for (uint_type col = 0; col < mat.width(); col++) row_data[col] *= scales[col];
+                    }
+                }
+        };
+
+        template<class T>
+        class PermutationMatrix : public MatrixExpression< PermutationMatrix<T> > {
+            /*
+                A square 0-1 matrix with a single one in each row and column,
+                stored as the column of the one in each row. Multiplying by it
+                on the left reorders rows, (P * A) row i being row
+                columnOf(i) of A, and on the right reorders columns.
+            */
+            protected:
+                std::vector<uint_type> columns;
+
+            public:
+                typedef T value_type;
+
+                PermutationMatrix(uint_type size) : columns(size) {
+                    for (uint_type row = 0; row < size; row++) this->columns[row] = row;
+                }
+
+                PermutationMatrix(std::vector<uint_type> permutation) : columns(std::move(permutation)) {
+                    /*
+                        permutation must hold each of 0 to size - 1 once.
+                    */
+                }
+
+                //Information functions
+
+                inline uint_type size() const {
+                    return this->columns.size();
+                }
+
+                inline uint_type width() const {
+                    return this->columns.size();
+                }
+
+                inline uint_type height() const {
+                    return this->columns.size();
+                }
+
+                inline uint_type columnOf(uint_type row) const {
+                    return this->columns[row];
+                }
+
+                inline const std::vector<uint_type>& permutation() const {
+                    return this->columns;
+                }
+
+                inline bool conformant(uint_type, uint_type) const {
+                    return false;
+                }
+
+                inline T element(uint_type elem) const {
+                    return this->element(elem / this->size(), elem % this->size());
+                }
+
+                inline T element(uint_type row, uint_type col) const {
+                    return (this->columns[row] == col) ? T(1) : T(0);
+                }
+
+                inline Matrix<T> eval() const {
+                    return Matrix<T>(*this);
+                }
+
+                T det() const {
+                    /*
+                        The sign of the permutation, from the parity of its
+                        cycles: a cycle of length k is k - 1 swaps.
+                    */
+                    std::vector<bool> visited(this->size(), false);
+                    bool odd = false;
+                    for (uint_type start = 0; start < this->size(); start++) {
+                        if (visited[start]) continue;
+                        visited[start] = true;
+                        for (uint_type row = this->columns[start]; row != start; row = this->columns[row]) {
+                            visited[row] = true;
+                            odd = !odd;
+                        }
+                    }
+                    return odd ? T(-1) : T(1);
+                }
+
+                //Transformations
+
+                inline PermutationMatrix<T>& swap(uint_type row1, uint_type row2) {
+                    /*
+                        Swaps two rows of the permutation matrix.
+                    */
+                    std::swap(this->columns[row1], this->columns[row2]);
+                    return *this;
+                }
+
+                PermutationMatrix<T> transposed() const {
+                    std::vector<uint_type> inverse(this->size());
+                    for (uint_type row = 0; row < this->size(); row++) inverse[this->columns[row]] = row;
+                    return PermutationMatrix<T>(std::move(inverse));
+                }
+
+                inline PermutationMatrix<T> inverted() const {
+                    return this->transposed();
+                }
+        };
+
+        //Products of structured matrices, which stay structured
+
+        template<class T>
+        inline ScaledIdentity<T> operator* (const ScaledIdentity<T>& left, const ScaledIdentity<T>& right) {
+            if (left.size() != right.size()) return left;
+            return ScaledIdentity<T>(left.size(), left.scale() * right.scale());
+        }
+
+        template<class T>
+        DiagonalMatrix<T> operator* (const DiagonalMatrix<T>& left, const DiagonalMatrix<T>& right) {
+            /*
+                If the sizes differ the left operand is returned unchanged.
+            */
+            if (left.size() != right.size()) return left;
+            DiagonalMatrix<T> diag_p(left);
+            for (uint_type elem = 0; elem < diag_p.size(); elem++) diag_p[elem] *= right[elem];
+            return diag_p;
+        }
+
+        template<class T>
+        DiagonalMatrix<T> operator* (const ScaledIdentity<T>& left, const DiagonalMatrix<T>& right) {
+            /*
+                If the sizes differ the diagonal operand is returned
+                unchanged.
+            */
+            if (left.size() != right.size()) return right;
+            DiagonalMatrix<T> diag_p(right);
+            for (uint_type elem = 0; elem < diag_p.size(); elem++) diag_p[elem] *= left.scale();
+            return diag_p;
+        }
+
+        template<class T>
+        inline DiagonalMatrix<T> operator* (const DiagonalMatrix<T>& left, const ScaledIdentity<T>& right) {
+            return right * left;
+        }
+
+        template<class T>
+        PermutationMatrix<T> operator* (const PermutationMatrix<T>& left, const PermutationMatrix<T>& right) {
+            /*
+                Row i of the product has its one where row left.columnOf(i)
+                of right does.
+            */
+            if (left.size() != right.size()) return left;
+            std::vector<uint_type> composed(left.size());
+            for (uint_type row = 0; row < left.size(); row++) composed[row] = right.columnOf(left.columnOf(row));
+            return PermutationMatrix<T>(std::move(composed));
+        }
+
+        //Products with dense matrices, which take O(n^2)
+
+        /*
+            The matrix operand is taken by value, so a temporary one is
+            scaled or reordered in its own storage. A structured operand
+            whose size() is not the matrix's matching dimension leaves the
+            matrix as it was, both here and in the *= forms below.
+        */
+
+        template<class T>
+        inline Matrix<T> operator* (Matrix<T> mat, const ScaledIdentity<T>& scaled) {
+            if (mat.width() == scaled.size()) mat *= scaled.scale();
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator* (const ScaledIdentity<T>& scaled, Matrix<T> mat) {
+            if (mat.height() == scaled.size()) mat *= scaled.scale();
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator* (Matrix<T> mat, const DiagonalMatrix<T>& diag) {
+            diag.scaleColumns(mat);
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator* (const DiagonalMatrix<T>& diag, Matrix<T> mat) {
+            diag.scaleRows(mat);
+            return mat;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const PermutationMatrix<T>& perm, const Matrix<T>& mat) {
+            if (mat.height() != perm.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            for (uint_type row = 0; row < mat.height(); row++) {
+                const T* row_data = mat.rowData(perm.columnOf(row));
+                std::copy(row_data, row_data + mat.width(), mat_p.rowData(row));
+            }
+            return mat_p;
+        }
+
+        template<class T>
+        Matrix<T> operator* (const Matrix<T>& mat, const PermutationMatrix<T>& perm) {
+            /*
+                Column k of mat becomes column perm.columnOf(k).
+            */
+            if (mat.width() != perm.size()) return mat;
+            Matrix<T> mat_p(mat.width(), mat.height());
+            for (uint_type row = 0; row < mat.height(); row++) {
+                const T* row_data = mat.rowData(row);
+                T* row_p = mat_p.rowData(row);
+                for (uint_type col = 0; col < mat.width(); col++) row_p[perm.columnOf(col)] = row_data[col];
+            }
+            return mat_p;
+        }
+
+        template<class T>
+        inline Matrix<T>& operator*= (Matrix<T>& mat, const ScaledIdentity<T>& scaled) {
+            if (mat.width() == scaled.size()) mat *= scaled.scale();
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T>& operator*= (Matrix<T>& mat, const DiagonalMatrix<T>& diag) {
+            diag.scaleColumns(mat);
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T>& operator*= (Matrix<T>& mat, const PermutationMatrix<T>& perm) {
+            mat = mat * perm;
+            return mat;
+        }
+
+        template<class T>
+        Vector<T> operator* (const DiagonalMatrix<T>& diag, const Vector<T>& vec) {
+            if (vec.size() != diag.size()) return vec;
+            Vector<T> vec_p(vec.size());
+            for (uint_type elem = 0; elem < vec.size(); elem++) vec_p[elem] = diag[elem] * vec[elem];
+            return vec_p;
+        }
+
+        template<class T>
+        Vector<T> operator* (const PermutationMatrix<T>& perm, const Vector<T>& vec) {
+            if (vec.size() != perm.size()) return vec;
+            Vector<T> vec_p(vec.size());
+            for (uint_type elem = 0; elem < vec.size(); elem++) vec_p[elem] = vec[perm.columnOf(elem)];
+            return vec_p;
+        }
+
+        //Sums with dense matrices, which only touch the diagonal
+
+        template<class T>
+        Matrix<T>& operator+= (Matrix<T>& mat, const ScaledIdentity<T>& scaled) {
+            /*
+                Like Matrix::operator+=, only the region both share is
+                added to.
+            */
+            const uint_type size = std::min(std::min(mat.width(), mat.height()), scaled.size());
+            for (uint_type elem = 0; elem < size; elem++) mat.element(elem,elem) += scaled.scale();
+            return mat;
+        }
+
+        template<class T>
+        Matrix<T>& operator-= (Matrix<T>& mat, const ScaledIdentity<T>& scaled) {
+            const uint_type size = std::min(std::min(mat.width(), mat.height()), scaled.size());
+            for (uint_type elem = 0; elem < size; elem++) mat.element(elem,elem) -= scaled.scale();
+            return mat;
+        }
+
+        template<class T>
+        Matrix<T>& operator+= (Matrix<T>& mat, const DiagonalMatrix<T>& diag) {
+            const uint_type size = std::min(std::min(mat.width(), mat.height()), diag.size());
+            for (uint_type elem = 0; elem < size; elem++) mat.element(elem,elem) += diag[elem];
+            return mat;
+        }
+
+        template<class T>
+        Matrix<T>& operator-= (Matrix<T>& mat, const DiagonalMatrix<T>& diag) {
+            const uint_type size = std::min(std::min(mat.width(), mat.height()), diag.size());
+            for (uint_type elem = 0; elem < size; elem++) mat.element(elem,elem) -= diag[elem];
+            return mat;
+        }
+
+        /*
+            The sum is the dense operand with its diagonal updated, so it is
+            copied (or reused when expiring) instead of being evaluated as an
+            expression a branch per element.
+        */
+
+        template<class T>
+        inline Matrix<T> operator+ (Matrix<T> mat, const ScaledIdentity<T>& scaled) {
+            mat += scaled;
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator+ (const ScaledIdentity<T>& scaled, Matrix<T> mat) {
+            mat += scaled;
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator- (Matrix<T> mat, const ScaledIdentity<T>& scaled) {
+            mat -= scaled;
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator- (const ScaledIdentity<T>& scaled, Matrix<T> mat) {
+            mat *= T(-1);
+            mat += scaled;
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator+ (Matrix<T> mat, const DiagonalMatrix<T>& diag) {
+            mat += diag;
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator+ (const DiagonalMatrix<T>& diag, Matrix<T> mat) {
+            mat += diag;
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator- (Matrix<T> mat, const DiagonalMatrix<T>& diag) {
+            mat -= diag;
+            return mat;
+        }
+
+        template<class T>
+        inline Matrix<T> operator- (const DiagonalMatrix<T>& diag, Matrix<T> mat) {
+            mat *= T(-1);
+            mat += diag;
+            return mat;
+        }
+    }
+}
+
+#endif
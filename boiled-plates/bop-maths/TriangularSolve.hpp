@@ -0,0 +1,113 @@
+#ifndef BOP_TRIANGULAR_SOLVE_HPP
+#define BOP_TRIANGULAR_SOLVE_HPP
+
+#include <algorithm>
+#include "../bop-defaults/types.hpp"
+#include "MatrixKernels.hpp"
+#include "SIMD.hpp"
+
+/*
+    Blocked triangular solves with many right hand sides (TRSM), the
+    substitution step behind the factorizations.
+
+    The triangle is walked in diagonal blocks. Each diagonal block is
+    solved by substitution along the rows of the right hand side, and
+    the rows not yet solved are then updated by a single GEMM with the
+    block's solution, so most of the work runs in the packed multiply.
+*/
+
+namespace bop {
+    #ifdef BOP_USE_INFERIOR_NAMESPACE
+    namespace math {
+    #else
+    namespace maths {
+    #endif
+        namespace kernel {
+
+            template<class T>
+            struct TrsmBlocking {
+                /*
+                    Rows of the triangle solved by substitution between GEMM
+                    updates.
+                */
+                static const uint_type block = 64;
+            };
+
+            template<class T>
+            void trsmLower(uint_type n, uint_type columns, const T* l, uint_type rsl, uint_type csl, bool unit_diagonal, T* b, uint_type ldb) {
+                /*
+                    Overwrites the n by columns matrix B with L^-1 * B, where L
+                    is the n by n lower triangle at l with rows rsl and columns
+                    csl elements apart, so the transpose of an upper triangle
+                    can be given by swapping them. Elements above the
+                    diagonal are never read, nor is the diagonal when
+                    unit_diagonal is set.
+                */
+                const uint_type nb = TrsmBlocking<T>::block;
+                for (uint_type start = 0; start < n; start += nb) {
+                    const uint_type end = std::min(n, start + nb);
+                    for (uint_type row = start; row < end; row++) {
+                        T* b_row = b + (row * ldb);
+                        for (uint_type iter = start; iter < row; iter++) {
+                            const T multiplier = l[(row * rsl) + (iter * csl)];
+                            if (multiplier != T(0)) axpy<T>(columns, -multiplier, b + (iter * ldb), b_row);
+                        }
+                        if (!unit_diagonal) scal<T>(columns, T(1) / l[row * (rsl + csl)], b_row);
+                    }
+                    if (end < n) {
+                        /*
+                            B2 -= L21 * X1
+                        */
+                        gemm<T>(n - end, columns, end - start, T(-1),
+                                l + (end * rsl) + (start * csl), rsl, csl,
+                                b + (start * ldb), ldb, 1,
+                                T(1), b + (end * ldb), ldb);
+                    }
+                }
+            }
+
+            template<class T>
+            void trsmUpper(uint_type n, uint_type columns, const T* u, uint_type rsu, uint_type csu, bool unit_diagonal, T* b, uint_type ldb) {
+                /*
+                    Overwrites the n by columns matrix B with U^-1 * B, where U
+                    is the n by n upper triangle at u with rows rsu and columns
+                    csu elements apart, working from the last diagonal block
+                    up.
+                */
+                const uint_type nb = TrsmBlocking<T>::block;
+                if (n == 0) return;
+                for (uint_type start = ((n - 1) / nb) * nb;; start -= nb) {
+                    const uint_type end = std::min(n, start + nb);
+                    for (uint_type row = end; row-- > start;) {
+                        T* b_row = b + (row * ldb);
+                        for (uint_type iter = row + 1; iter < end; iter++) {
+                            const T multiplier = u[(row * rsu) + (iter * csu)];
+                            if (multiplier != T(0)) axpy<T>(columns, -multiplier, b + (iter * ldb), b_row);
+                        }
+                        if (!unit_diagonal) scal<T>(columns, T(1) / u[row * (rsu + csu)], b_row);
+                    }
+                    if (start == 0) break;
+                    /*
+                        B1 -= U12 * X2
+                    */
+                    gemm<T>(start, columns, end - start, T(-1),
+                            u + (start * csu), rsu, csu,
+                            b + (start * ldb), ldb, 1,
+                            T(1), b, ldb);
+                }
+            }
+
+            template<class T>
+            inline void trsmLower(uint_type n, uint_type columns, const T* l, uint_type ldl, bool unit_diagonal, T* b, uint_type ldb) {
+                trsmLower<T>(n, columns, l, ldl, 1, unit_diagonal, b, ldb);
+            }
+
+            template<class T>
+            inline void trsmUpper(uint_type n, uint_type columns, const T* u, uint_type ldu, bool unit_diagonal, T* b, uint_type ldb) {
+                trsmUpper<T>(n, columns, u, ldu, 1, unit_diagonal, b, ldb);
+            }
+        }
+    }
+}
+
+#endif
@@ -12,5 +12,13 @@
 #include "Vector.hpp"
 #endif
 #include "Matrix.hpp"
+#include "FixedMatrix.hpp"
+#include "MatrixParallel.hpp"
+#include "SparseMatrix.hpp"
+#include "EigenSolver.hpp"
+#include "MixedPrecision.hpp"
+#include "PackedMatrix.hpp"
+#include "MatrixFunctions.hpp"
+#include "MatrixBatch.hpp"
 
 #endif
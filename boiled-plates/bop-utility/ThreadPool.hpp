@@ -4,6 +4,9 @@
 #include <utility>
 #include <algorithm>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <vector>
 #include <queue>
 #include <functional>
 #include "../bop-defaults/types.hpp"
@@ -23,58 +26,71 @@ namespace bop {
                         Code that the threads run continously.
                     */
                     std::function<void()> current_function = nullptr;
-                    while(this->active) {
-                        this->thread_activity[thread_index] = false;
-                        /*
-                            Attempt to lock the task_queue mutex so that we may
-                            take a task from it without data racing.
-                        */
-                        if (this->run_functions && this->task_queue_mutex.try_lock()) {
+                    ThreadPool::runningPool() = this;
+                    while(true) {
+                        {
                             /*
-                                If the mutex was successfully locked then we check
-                                for a task.
+                                Sleep on the task_available condition until there is a
+                                task that may be run or the pool is being destroyed,
+                                rather than spinning on the task_queue mutex.
                             */
-                            if (this->task_queue.size() > 0) {
-                                /*
-                                    If there is an available task function, move it out of the
-                                    queue and into the current_function variable, then pop the
-                                    now empty front of the queue.
-                                */
-                                current_function = std::move(this->task_queue.front());
-                                this->task_queue.pop();
-                            }
+                            std::unique_lock<std::mutex> queue_lock(this->task_queue_mutex);
+                            this->task_available.wait(queue_lock, [this]() -> bool {
+                                return !this->active || (this->run_functions && this->task_queue.size() > 0);
+                            });
+                            if (!this->active) break;
                             /*
-                                Unlock the mutex now all that can be done to the queue
-                                this iteration has been done.
+                                Move the task function out of the queue and into the
+                                current_function variable, then pop the now empty front
+                                of the queue. The activity flag is raised before the
+                                queue is unlocked so that hasRunning() never misses it.
                             */
-                            this->task_queue_mutex.unlock();
-
-                            if (current_function != nullptr) {
-                                /*
-                                    If a task function was taken from the queue then run it
-                                    and set the current_function variable to an empty function
-                                    so that the task is only run once.
-                                */
-                                this->thread_activity_mutex[thread_index].lock();
-                                this->thread_activity[thread_index] = true;
-                                this->thread_activity_mutex[thread_index].unlock();
-                                current_function();
-                                this->thread_activity_mutex[thread_index].lock();
-                                this->thread_activity[thread_index] = false;
-                                this->thread_activity_mutex[thread_index].unlock();
-                                current_function = nullptr;
-                            }
+                            current_function = std::move(this->task_queue.front());
+                            this->task_queue.pop();
+                            this->thread_activity_mutex[thread_index].lock();
+                            this->thread_activity[thread_index] = true;
+                            this->thread_activity_mutex[thread_index].unlock();
+                        }
+                        /*
+                            Run the task, then set the current_function variable to an
+                            empty function so that the task is only run once.
+                        */
+                        current_function();
+                        current_function = nullptr;
+                        this->thread_activity_mutex[thread_index].lock();
+                        this->thread_activity[thread_index] = false;
+                        this->thread_activity_mutex[thread_index].unlock();
+                        {
+                            std::lock_guard<std::mutex> queue_lock(this->task_queue_mutex);
+                            this->unfinished_tasks--;
+                            if (this->unfinished_tasks == 0) this->tasks_finished.notify_all();
                         }
-
                     }
                 }
 
+                static const ThreadPool*& runningPool() {
+                    /*
+                        The pool whose worker is the calling thread, if any.
+                    */
+                    static thread_local const ThreadPool* pool = nullptr;
+                    return pool;
+                }
+
                 /*
                     The task queue and it's related mutex
                 */
                 std::queue<std::function<void()> > task_queue;
                 std::mutex task_queue_mutex;
 
+                /*
+                    Conditions signalled when a task is queued and when the last
+                    queued or running task has finished, along with the count of
+                    such tasks.
+                */
+                std::condition_variable task_available;
+                std::condition_variable tasks_finished;
+                uint_type unfinished_tasks;
+
                 /*
                     Array of threads
                 */
@@ -93,21 +109,21 @@ namespace bop {
                     boolean flag to prevent execution of further
                     tasks until the flag is true again.
                 */
-                bool run_functions;
+                std::atomic<bool> run_functions;
 
                 /*
                     boolean flag that will break all threads after their next
                     completed task if false.
                 */
 
-                bool active;
+                std::atomic<bool> active;
 
 
 
             public:
                 ThreadPool() = delete;
 
-                ThreadPool(uint_type reserve_threads) : task_queue(), run_functions(true), active(true) {
+                ThreadPool(uint_type reserve_threads) : task_queue(), unfinished_tasks(0), run_functions(true), active(true) {
                     this->thread_activity_mutex = std::vector<std::mutex>(reserve_threads);
                     for (uint_type iter = 0; iter < reserve_threads; iter++) {
                         /*
@@ -132,7 +148,21 @@ namespace bop {
                     this->task_queue.push([&,function,arguments...]() -> void {
                         function(arguments...);
                     });
+                    this->unfinished_tasks++;
                     this->task_queue_mutex.unlock();
+                    this->task_available.notify_one();
+                }
+
+                void wait() {
+                    /*
+                        Blocks until every task added so far has been run. Must not
+                        be called from inside a task, or while running is toggled
+                        off with tasks still queued.
+                    */
+                    std::unique_lock<std::mutex> queue_lock(this->task_queue_mutex);
+                    this->tasks_finished.wait(queue_lock, [this]() -> bool {
+                        return this->unfinished_tasks == 0;
+                    });
                 }
 
                 ~ThreadPool() {
@@ -140,13 +170,15 @@ namespace bop {
                         Set the activation variables to false, closing some
                         threads as soon as possible.
                     */
+                    this->task_queue_mutex.lock();
                     this->run_functions = false;
                     this->active = false;
+                    this->task_queue_mutex.unlock();
                     /*
-                        Lock the task queue mutex, preventing any more tasks from
-                        being executed.
+                        Wake every sleeping thread so that it sees the pool is no
+                        longer active, tasks still in the queue are not run.
                     */
-                    this->task_queue_mutex.lock();
+                    this->task_available.notify_all();
                     /*
                         Finally wait for the rest of the threads by requesting them
                         to join this thread in order of construction.
@@ -166,6 +198,15 @@ namespace bop {
                     return this->threads.size();
                 }
 
+                bool onWorkerThread() const {
+                    /*
+                        Returns true when called from a task running on this
+                        pool, where waiting on further tasks of the pool could
+                        leave every worker waiting.
+                    */
+                    return ThreadPool::runningPool() == this;
+                }
+
                 bool hasRunning() {
                     /*
                         Returns true if there are any threads running a task,
@@ -191,7 +232,10 @@ namespace bop {
                 }
 
                 void toggleRunning() {
+                    this->task_queue_mutex.lock();
                     this->run_functions = !this->run_functions;
+                    this->task_queue_mutex.unlock();
+                    this->task_available.notify_all();
                 }
 
 
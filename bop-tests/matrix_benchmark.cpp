@@ -5,7 +5,10 @@
 #include <bop-defaults/types.hpp>
 #include <iostream>
 #include <complex>
+#include <chrono>
+#include <vector>
 #define TEST_COUNT 1000000
+#define SWEEP_FLOP_TARGET 50000000.0
 
 
 using namespace bop::maths;
@@ -45,6 +48,217 @@ void bop_bench_det_15x15() {
     mat.det();
 }
 
+Matrix<BENCH_TYPE> bench_dense(uint_type size) {
+    Matrix<BENCH_TYPE> mat(size, size);
+    for (uint_type elem = 0; elem < size * size; elem++) mat.element(elem) = static_cast<BENCH_TYPE>((elem * 7919) % 23) - 11;
+    return mat;
+}
+
+void bop_bench_det_int_4x4() {
+    static Matrix<int_type> mat = {{2,0,1,3},{1,4,0,2},{0,1,5,1},{3,2,1,6}};
+    static int_type sink = 0;
+    sink += mat.det();
+}
+
+void bop_bench_lu_15x15() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(15);
+    LUDecomposition<BENCH_TYPE> lu(mat);
+}
+
+void bop_bench_lu_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    LUDecomposition<BENCH_TYPE> lu(mat);
+}
+
+void bop_bench_lu_solve_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    static LUDecomposition<BENCH_TYPE> lu(mat);
+    static Matrix<BENCH_TYPE> rhs(1, 256, 1);
+    lu.solve(rhs);
+}
+
+void bop_bench_symm_dense_512x512() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(512).transposed() + bench_dense(512), rhs(16, 512, 1), mat_p;
+    mat_p = mat * rhs;
+}
+
+void bop_bench_symm_packed_512x512() {
+    static SymmetricMatrix<BENCH_TYPE> mat(bench_dense(512).transposed() + bench_dense(512));
+    static Matrix<BENCH_TYPE> rhs(16, 512, 1), mat_p;
+    mat_p = mat * rhs;
+}
+
+void bop_bench_repeated_multiply_64x64() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(64) * BENCH_TYPE(0.01), mat_p;
+    mat_p = mat;
+    for (uint_type power = 1; power < 1000; power++) mat_p *= mat;
+}
+
+void bop_bench_pow_64x64() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(64) * BENCH_TYPE(0.01), mat_p;
+    mat_p = pow(mat, 1000);
+}
+
+void bop_bench_expm_128x128() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(128) * BENCH_TYPE(0.05), mat_p;
+    mat_p = expm(mat);
+}
+
+BENCH_TYPE bench_temporaries(MatrixAllocator& allocator) {
+    /*
+        A short expression whose temporaries all die within the call.
+    */
+    static Matrix<BENCH_TYPE> a = bench_dense(4), b = bench_dense(4) * BENCH_TYPE(0.5);
+    MatrixAllocatorScope scope(allocator);
+    Matrix<BENCH_TYPE> product = a * b;
+    return ((product * a) + (product * b)).element(3,3);
+}
+
+BENCH_TYPE bench_sink = 0;
+
+void bop_bench_temporaries_heap_4x4() {
+    bench_sink += bench_temporaries(MatrixAllocator::heap());
+}
+
+void bop_bench_temporaries_recycler_4x4() {
+    static RecyclingMatrixAllocator recycling;
+    bench_sink += bench_temporaries(recycling);
+}
+
+void bop_bench_temporaries_arena_4x4() {
+    static ArenaMatrixAllocator arena(1 << 16);
+    bench_sink += bench_temporaries(arena);
+    arena.reset();
+}
+
+void bop_bench_banded_solve_100000() {
+    static BandedMatrix<BENCH_TYPE> mat = ([]() {
+        BandedMatrix<BENCH_TYPE> tridiagonal(100000, 1, 1);
+        for (uint_type row = 0; row < 100000; row++) {
+            tridiagonal.entry(row,row) = 4;
+            if (row > 0) tridiagonal.entry(row,row - 1) = -1;
+            if (row + 1 < 100000) tridiagonal.entry(row,row + 1) = -1;
+        }
+        return tridiagonal;
+    })();
+    static Matrix<BENCH_TYPE> rhs(1, 100000, 1), x;
+    x = rhs;
+    mat.solveInPlace(x);
+}
+
+void bop_bench_cholesky_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256).transposed() * bench_dense(256) + IdentityMatrix<BENCH_TYPE>::make(256);
+    CholeskyDecomposition<BENCH_TYPE> cholesky(mat);
+}
+
+void bop_bench_qr_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    QRDecomposition<BENCH_TYPE> qr(mat);
+}
+
+void bop_bench_least_squares_512x256() {
+    static Matrix<BENCH_TYPE> mat = Matrix<BENCH_TYPE>(bench_dense(512).block(0, 0, 256, 512));
+    static Matrix<BENCH_TYPE> rhs(1, 512, 1);
+    Matrix<BENCH_TYPE> x = leastSquares(mat, rhs);
+}
+
+void bop_bench_lanczos_100000() {
+    static SparseMatrix<BENCH_TYPE> sparse = ([]() -> SparseMatrix<BENCH_TYPE> {
+        std::vector<SparseMatrix<BENCH_TYPE>::Entry> entries;
+        for (uint_type row = 0; row < 100000; row++) {
+            entries.push_back({row, row, BENCH_TYPE(1) / static_cast<BENCH_TYPE>(row + 1)});
+            if (row > 0) entries.push_back({row, row - 1, BENCH_TYPE(0.1)});
+            if (row + 1 < 100000) entries.push_back({row, row + 1, BENCH_TYPE(0.1)});
+        }
+        return SparseMatrix<BENCH_TYPE>(100000, 100000, entries);
+    })();
+    lanczos(sparse, 4);
+}
+
+void bop_bench_inverse_multiply_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    static Matrix<BENCH_TYPE> rhs = bench_dense(256);
+    Matrix<BENCH_TYPE> x = mat.inverted() * rhs;
+}
+
+void bop_bench_solve_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    static Matrix<BENCH_TYPE> rhs = bench_dense(256);
+    Matrix<BENCH_TYPE> x = solve(mat, rhs);
+}
+
+void bop_bench_solve_reused_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    static LUDecomposition<BENCH_TYPE> lu(mat);
+    static Matrix<BENCH_TYPE> rhs = bench_dense(256);
+    Matrix<BENCH_TYPE> x = solve(lu, rhs);
+}
+
+void bop_bench_refined_solve_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    static Matrix<BENCH_TYPE> rhs(1, 256, 1);
+    Matrix<BENCH_TYPE> x = refinedSolve(mat, rhs);
+}
+
+void bop_bench_convert_float_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    Matrix<float> narrow(mat);
+}
+
+void bop_bench_gemv_2048x2048() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(2048);
+    static Vector<BENCH_TYPE> vec(2048, 1), out(2048);
+    mat.apply(vec, out);
+}
+
+void bop_bench_gemv_parallel_2048x2048() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(2048);
+    static Vector<BENCH_TYPE> vec(2048, 1), out(2048);
+    multiply(mat, vec, out);
+}
+
+void bop_bench_gemv_batch8_2048x2048() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(2048);
+    static Matrix<BENCH_TYPE> vecs(2048, 8, 1), out(2048, 8);
+    mat.applyBatch(vecs, out);
+}
+
+void bop_bench_accumulate_add_256x256() {
+    static Matrix<BENCH_TYPE> mat1 = bench_dense(256), mat2 = bench_dense(256), acc(256, 256);
+    acc += mat1 * mat2;
+}
+
+void bop_bench_accumulate_fused_256x256() {
+    static Matrix<BENCH_TYPE> mat1 = bench_dense(256), mat2 = bench_dense(256), acc(256, 256);
+    acc.multiplyAdd(mat1, mat2);
+}
+
+void bop_bench_accumulate_fused_transposed_256x256() {
+    static Matrix<BENCH_TYPE> mat1 = bench_dense(256), mat2 = bench_dense(256), acc(256, 256);
+    acc.multiplyAdd(mat1, mat2, BENCH_TYPE(1), BENCH_TYPE(1), true, false);
+}
+
+void bop_bench_diagonal_dense_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256), diag = Matrix<BENCH_TYPE>(DiagonalMatrix<BENCH_TYPE>(256, 2)), mat_p;
+    mat_p = diag * mat;
+}
+
+void bop_bench_diagonal_implicit_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256), mat_p;
+    static DiagonalMatrix<BENCH_TYPE> diag(256, 2);
+    mat_p = diag * mat;
+}
+
+void bop_bench_shift_identity_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256), mat_p;
+    mat_p = mat - IdentityMatrix<BENCH_TYPE>::make(256) * BENCH_TYPE(2);
+}
+
+void bop_bench_shift_implicit_256x256() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256), mat_p;
+    mat_p = mat - IdentityMatrix<BENCH_TYPE>::implicit(256, 2);
+}
+
 void bop_bench_multiply() {
     static Matrix<BENCH_TYPE> mat1 = IdentityMatrix<BENCH_TYPE>::make(3);
     static Matrix<BENCH_TYPE> mat2 = {{2,3,4},{6,1,7},{3,4,5}};
@@ -54,7 +268,7 @@ void bop_bench_multiply() {
 void bop_bench_add_make() {
     static Matrix<BENCH_TYPE> mat1 = IdentityMatrix<BENCH_TYPE>::make(3);
     static Matrix<BENCH_TYPE> mat2 = IdentityMatrix<BENCH_TYPE>::make(3);
-    mat1 + mat2;
+    Matrix<BENCH_TYPE> mat3 = mat1 + mat2;
 
 }
 
@@ -90,6 +304,25 @@ void bop_bench_add() {
     mat1 += mat2;
 }
 
+void bop_bench_add_256x256() {
+    static Matrix<BENCH_TYPE> mat1(256,256,1);
+    static Matrix<BENCH_TYPE> mat2(256,256,2);
+    mat1 += mat2;
+}
+
+void bop_bench_scalar_256x256() {
+    static Matrix<BENCH_TYPE> mat(256,256,1);
+    mat *= static_cast<BENCH_TYPE>(1.0000001);
+}
+
+void bop_bench_expression_256x256() {
+    static Matrix<BENCH_TYPE> mat1(256,256,1);
+    static Matrix<BENCH_TYPE> mat2(256,256,2);
+    static Matrix<BENCH_TYPE> mat3(256,256,3);
+    static Matrix<BENCH_TYPE> result(256,256,0);
+    result = mat1 + mat2 * static_cast<BENCH_TYPE>(2) - mat3;
+}
+
 void bop_bench_vector_add() {
     static Vector<BENCH_TYPE> vec1 = {1,2,3,4,5,6,7,8,9};
     static Vector<BENCH_TYPE> vec2 = {9,8,7,6,5,4,3,2,1};
@@ -120,6 +353,65 @@ void bop_bench_impose() {
     mat1.impose(mat2);
 }
 
+void bop_bench_block_copy_add() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    Matrix<BENCH_TYPE> tile(64,64);
+    for (uint_type row = 0; row < 64; row++) {
+        for (uint_type col = 0; col < 64; col++) tile.element(row,col) = mat.element(row + 64, col + 128);
+    }
+    tile += tile;
+    mat.impose(tile, 64, 128);
+}
+
+void bop_bench_block_view_add() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(256);
+    MatrixView<BENCH_TYPE> tile = mat.block(64, 128, 64, 64);
+    tile += tile;
+}
+
+Matrix<BENCH_TYPE> bench_sparse_pattern(uint_type size) {
+    /*
+        About 1% of the elements nonzero.
+    */
+    Matrix<BENCH_TYPE> mat(size, size, 0);
+    for (uint_type elem = 0; elem < size * size; elem += 97) mat.element(elem) = static_cast<BENCH_TYPE>((elem * 7919) % 23) - 11;
+    return mat;
+}
+
+void bop_bench_sparse_dense_512() {
+    static Matrix<BENCH_TYPE> mat = bench_sparse_pattern(512);
+    static Matrix<BENCH_TYPE> rhs = bench_dense(512);
+    Matrix<BENCH_TYPE> mat_p = mat * rhs;
+}
+
+void bop_bench_sparse_csr_512() {
+    static SparseMatrix<BENCH_TYPE> mat(bench_sparse_pattern(512));
+    static Matrix<BENCH_TYPE> rhs = bench_dense(512);
+    Matrix<BENCH_TYPE> mat_p = mat * rhs;
+}
+
+SparseMatrix<BENCH_TYPE> bench_tridiagonal(uint_type size) {
+    std::vector<SparseMatrix<BENCH_TYPE>::Entry> entries;
+    for (uint_type row = 0; row < size; row++) {
+        if (row > 0) entries.push_back({row, row - 1, -1});
+        entries.push_back({row, row, 2});
+        if (row + 1 < size) entries.push_back({row, row + 1, -1});
+    }
+    return SparseMatrix<BENCH_TYPE>(size, size, entries);
+}
+
+void bop_bench_spmv_100k() {
+    static SparseMatrix<BENCH_TYPE> mat = bench_tridiagonal(100000);
+    static Matrix<BENCH_TYPE> vec(1, 100000, 1);
+    Matrix<BENCH_TYPE> vec_p = mat * vec;
+}
+
+void bop_bench_spmv_100k_parallel() {
+    static SparseMatrix<BENCH_TYPE> mat = bench_tridiagonal(100000);
+    static Matrix<BENCH_TYPE> vec(1, 100000, 1);
+    Matrix<BENCH_TYPE> vec_p = multiply(mat, vec);
+}
+
 void bop_bench_impose_vec() {
     static Matrix<BENCH_TYPE> mat = {{2,2,2},{3,4,5},{1,1,2}};
     static Vector<BENCH_TYPE> vec = {3,3,-1};
@@ -157,8 +449,106 @@ void bop_bench_transpose_3x4() {
     mat.transpose();
 }
 
+void bop_bench_transpose_1024x1024() {
+    static Matrix<BENCH_TYPE> mat = bench_dense(1024);
+    mat.transpose();
+}
+
+void bop_bench_transpose_1024x1024_padded() {
+    static Matrix<BENCH_TYPE> mat = Matrix<BENCH_TYPE>::padded(1024,1024,1);
+    mat.transpose();
+}
+
+void bop_bench_transpose_1024x768() {
+    static Matrix<BENCH_TYPE> mat(768,1024,1);
+    mat.transpose();
+}
+
+void bop_bench_transposed_1024x768() {
+    static Matrix<BENCH_TYPE> mat(768,1024,1);
+    Matrix<BENCH_TYPE> mat_t = mat.transposed();
+}
+
+void bop_bench_fixed_multiply() {
+    static matrix3 mat1 = matrix3::identity();
+    static matrix3 mat2 = {{2,3,4},{6,1,7},{3,4,5}};
+    mat2 *= mat1;
+}
+
+void bop_bench_fixed_det() {
+    static matrix3 mat = {{3,2,4},{2,7,2},{-1,2,5}};
+    static BENCH_TYPE sink = 0;
+    sink += mat.det();
+}
+
+void bop_bench_fixed_inverse() {
+    static matrix3 mat = {{3,2,4},{2,7,2},{-1,2,5}};
+    mat.invert();
+}
+
+void bop_bench_fixed_inverse_4x4() {
+    static matrix4 mat = {{2,0,1,3},{1,4,0,2},{0,1,5,1},{3,2,1,6}};
+    mat.invert();
+}
+
+std::vector<matrix4> bench_fixed_4x4s(uint_type count) {
+    std::vector<matrix4> mats(count);
+    for (uint_type index = 0; index < count; index++) {
+        for (uint_type elem = 0; elem < 16; elem++) mats[index].element(elem) = static_cast<BENCH_TYPE>(((index * 7) + (elem * 13)) % 23) - 11;
+    }
+    return mats;
+}
+
+MatrixBatch<BENCH_TYPE,4,4> bench_batch_4x4s(uint_type count) {
+    std::vector<matrix4> mats = bench_fixed_4x4s(count);
+    MatrixBatch<BENCH_TYPE,4,4> batch(count);
+    for (uint_type index = 0; index < count; index++) batch.set(index, mats[index]);
+    return batch;
+}
+
+void bop_bench_fixed_loop_inverse_4096() {
+    static std::vector<matrix4> mats = bench_fixed_4x4s(4096);
+    for (matrix4& mat : mats) mat.invert();
+}
+
+void bop_bench_batch_inverse_4096() {
+    static MatrixBatch<BENCH_TYPE,4,4> batch = bench_batch_4x4s(4096);
+    batch.invert();
+}
+
+void bop_bench_fixed_loop_det_4096() {
+    static std::vector<matrix4> mats = bench_fixed_4x4s(4096);
+    static std::vector<BENCH_TYPE> dets(4096);
+    for (uint_type index = 0; index < 4096; index++) dets[index] = mats[index].det();
+}
+
+void bop_bench_batch_det_4096() {
+    static MatrixBatch<BENCH_TYPE,4,4> batch = bench_batch_4x4s(4096);
+    std::vector<BENCH_TYPE> dets = batch.det();
+}
+
+void bop_bench_fixed_loop_apply_4096() {
+    static std::vector<matrix4> mats = bench_fixed_4x4s(4096);
+    static std::vector< FixedMatrix<BENCH_TYPE,4,1> > vecs(4096, FixedMatrix<BENCH_TYPE,4,1>(1,2,3,1)), out(4096);
+    for (uint_type index = 0; index < 4096; index++) out[index] = mats[index] * vecs[index];
+}
+
+void bop_bench_batch_apply_4096() {
+    static MatrixBatch<BENCH_TYPE,4,4> batch = bench_batch_4x4s(4096);
+    static MatrixBatch<BENCH_TYPE,4,1> vecs(4096, FixedMatrix<BENCH_TYPE,4,1>(1,2,3,1)), out;
+    multiply(batch, vecs, out);
+}
+
 void bop_bench_access_offset_matrix() {
-    const Matrix<int_type>& mat = OffsetMatrix::make(3,3);
+    OffsetMatrix::handle mat = OffsetMatrix::shared(3,3);
+}
+
+void bop_bench_rotation_copy() {
+    Matrix<BENCH_TYPE> mat = RotationMatrix<BENCH_TYPE>::make(30);
+}
+
+void bop_bench_rotation_shared() {
+    RotationMatrix<BENCH_TYPE>::handle mat = RotationMatrix<BENCH_TYPE>::shared(30);
 }
 
 uint_type num = 0;
@@ -170,6 +560,7 @@ void bop_integer_incrementation() {
 int mat_tests() {
     std::cout << "\nAll matrix operations are performed on a 3 by 3 matrix unless otherwise specified" << std::endl << std::fixed;
     std::cout << "The result is the average operation time in nanoseconds for " << TEST_COUNT << " iterations." << std::endl;
+    std::cout << "Element-wise kernels dispatched to: " << simd::name(simd::level()) << std::endl;
     std::cout << "Matrix construction:              " << benchmark(TEST_COUNT, bop_bench_construct) << std::endl;
     std::cout << "Matrix construction (null):       " << benchmark(TEST_COUNT, bop_bench_construct_empty) << std::endl;
     std::cout << "Matrix construction by init list: " << benchmark(TEST_COUNT, bop_bench_constr_inlist) << std::endl;
@@ -178,33 +569,175 @@ int mat_tests() {
     std::cout << "Vector (9) construction:          " << benchmark(TEST_COUNT, bop_bench_construct_vec) << std::endl;
     std::cout << "Matrix multiplication:            " << benchmark(TEST_COUNT, bop_bench_multiply) << std::endl;
     std::cout << "Matrix multiplication (15x15):    " << benchmark(TEST_COUNT/10, bop_bench_largemat) << std::endl;
+    std::cout << "Temporaries, heap (4x4):          " << benchmark(TEST_COUNT, bop_bench_temporaries_heap_4x4) << std::endl;
+    std::cout << "Temporaries, recycler (4x4):      " << benchmark(TEST_COUNT, bop_bench_temporaries_recycler_4x4) << std::endl;
+    std::cout << "Temporaries, arena (4x4):         " << benchmark(TEST_COUNT, bop_bench_temporaries_arena_4x4) << std::endl;
     std::cout << "Matrix determinant:               " << benchmark(TEST_COUNT, bop_bench_det) << std::endl;
     std::cout << "Matrix determinant (15x15):       " << benchmark(TEST_COUNT, bop_bench_det_15x15) << std::endl;
+    std::cout << "Integer determinant (4x4):        " << benchmark(TEST_COUNT, bop_bench_det_int_4x4) << std::endl;
+    std::cout << "LU factorization (15x15):         " << benchmark(TEST_COUNT/10, bop_bench_lu_15x15) << std::endl;
+    std::cout << "LU factorization (256x256):       " << benchmark(TEST_COUNT/10000, bop_bench_lu_256x256) << std::endl;
+    std::cout << "LU solve, one rhs (256x256):      " << benchmark(TEST_COUNT/1000, bop_bench_lu_solve_256x256) << std::endl;
+    std::cout << "Dense symmetric * 16 (512x512):   " << benchmark(TEST_COUNT/10000, bop_bench_symm_dense_512x512) << std::endl;
+    std::cout << "Packed symmetric * 16 (512x512):  " << benchmark(TEST_COUNT/10000, bop_bench_symm_packed_512x512) << std::endl;
+    std::cout << "Tridiagonal banded solve (100000):" << benchmark(TEST_COUNT/10000, bop_bench_banded_solve_100000) << std::endl;
+    std::cout << "A^1000 by repeated *= (64x64):    " << benchmark(TEST_COUNT/100000, bop_bench_repeated_multiply_64x64) << std::endl;
+    std::cout << "pow(A, 1000) (64x64):             " << benchmark(TEST_COUNT/10000, bop_bench_pow_64x64) << std::endl;
+    std::cout << "expm(A) (128x128):                " << benchmark(TEST_COUNT/10000, bop_bench_expm_128x128) << std::endl;
+    std::cout << "Cholesky factorization (256x256): " << benchmark(TEST_COUNT/10000, bop_bench_cholesky_256x256) << std::endl;
+    std::cout << "QR factorization (256x256):       " << benchmark(TEST_COUNT/10000, bop_bench_qr_256x256) << std::endl;
+    std::cout << "Least squares (512x256):          " << benchmark(TEST_COUNT/10000, bop_bench_least_squares_512x256) << std::endl;
+    std::cout << "Lanczos, top 4 (100000 sparse):   " << benchmark(TEST_COUNT/100000, bop_bench_lanczos_100000) << std::endl;
+    std::cout << "Inverse times 256 rhs (256x256):  " << benchmark(TEST_COUNT/10000, bop_bench_inverse_multiply_256x256) << std::endl;
+    std::cout << "Solve 256 rhs (256x256):          " << benchmark(TEST_COUNT/10000, bop_bench_solve_256x256) << std::endl;
+    std::cout << "Solve 256 rhs, reused LU:         " << benchmark(TEST_COUNT/10000, bop_bench_solve_reused_256x256) << std::endl;
+    std::cout << "C += A * B (256x256):             " << benchmark(TEST_COUNT/10000, bop_bench_accumulate_add_256x256) << std::endl;
+    std::cout << "C.multiplyAdd(A, B) (256x256):    " << benchmark(TEST_COUNT/10000, bop_bench_accumulate_fused_256x256) << std::endl;
+    std::cout << "C.multiplyAdd(A^T, B) (256x256):  " << benchmark(TEST_COUNT/10000, bop_bench_accumulate_fused_transposed_256x256) << std::endl;
+    std::cout << "Dense diagonal * A (256x256):     " << benchmark(TEST_COUNT/10000, bop_bench_diagonal_dense_256x256) << std::endl;
+    std::cout << "DiagonalMatrix * A (256x256):     " << benchmark(TEST_COUNT/1000, bop_bench_diagonal_implicit_256x256) << std::endl;
+    std::cout << "A - dense 2I (256x256):           " << benchmark(TEST_COUNT/1000, bop_bench_shift_identity_256x256) << std::endl;
+    std::cout << "A - implicit 2I (256x256):        " << benchmark(TEST_COUNT/1000, bop_bench_shift_implicit_256x256) << std::endl;
+    std::cout << "Matrix * vector (2048x2048):      " << benchmark(TEST_COUNT/10000, bop_bench_gemv_2048x2048) << std::endl;
+    std::cout << "Matrix * vector, threaded:        " << benchmark(TEST_COUNT/10000, bop_bench_gemv_parallel_2048x2048) << std::endl;
+    std::cout << "Matrix * 8 vectors, one sweep:    " << benchmark(TEST_COUNT/10000, bop_bench_gemv_batch8_2048x2048) << std::endl;
+    std::cout << "Float LU refined, one rhs (256):  " << benchmark(TEST_COUNT/10000, bop_bench_refined_solve_256x256) << std::endl;
+    std::cout << "Convert to float (256x256):       " << benchmark(TEST_COUNT/1000, bop_bench_convert_float_256x256) << std::endl;
     std::cout << "Matrix inverse (2x2):             " << benchmark(TEST_COUNT, bop_bench_inverse_2x2) << std::endl;
     std::cout << "Matrix inverse (unit):            " << benchmark(TEST_COUNT, bop_bench_inverse_unit) << std::endl;
     std::cout << "Matrix inverse:                   " << benchmark(TEST_COUNT, bop_bench_inverse) << std::endl;
     std::cout << "Matrix invert self:               " << benchmark(TEST_COUNT, bop_bench_invert_self) << std::endl;
     std::cout << "Matrix addition:                  " << benchmark(TEST_COUNT, bop_bench_add) << std::endl;
     std::cout << "Matrix add for new:               " << benchmark(TEST_COUNT, bop_bench_add_make) << std::endl;
+    std::cout << "Matrix addition (256x256):        " << benchmark(TEST_COUNT/1000, bop_bench_add_256x256) << std::endl;
+    std::cout << "Matrix scalar mult. (256x256):    " << benchmark(TEST_COUNT/1000, bop_bench_scalar_256x256) << std::endl;
+    std::cout << "Matrix A + B*2 - C (256x256):     " << benchmark(TEST_COUNT/1000, bop_bench_expression_256x256) << std::endl;
     std::cout << "Vector (9) addition:              " << benchmark(TEST_COUNT, bop_bench_vector_add) << std::endl;
     std::cout << "Matrix subtraction:               " << benchmark(TEST_COUNT, bop_bench_subtract) << std::endl;
     std::cout << "Matrix scalar multiplication:     " << benchmark(TEST_COUNT, bop_bench_scalar) << std::endl;
     std::cout << "Matrix scalar division:           " << benchmark(TEST_COUNT, bop_bench_scalar_div) << std::endl;
     std::cout << "Matrix transposition:             " << benchmark(TEST_COUNT, bop_bench_transpose) << std::endl;
-    //std::cout << "Matrix transposition (3x4):       " << benchmark(TEST_COUNT, bop_bench_transpose_3x4) << std::endl;
+    std::cout << "Matrix transposition (3x4):       " << benchmark(TEST_COUNT, bop_bench_transpose_3x4) << std::endl;
+    std::cout << "Matrix transposition (1024x1024): " << benchmark(TEST_COUNT/10000, bop_bench_transpose_1024x1024) << std::endl;
+    std::cout << "Matrix transposition (padded):    " << benchmark(TEST_COUNT/10000, bop_bench_transpose_1024x1024_padded) << std::endl;
+    std::cout << "Matrix transposition (1024x768):  " << benchmark(TEST_COUNT/10000, bop_bench_transpose_1024x768) << std::endl;
+    std::cout << "Matrix transposed (1024x768):     " << benchmark(TEST_COUNT/10000, bop_bench_transposed_1024x768) << std::endl;
     std::cout << "Matrix (2x2) imposition on (3x3): " << benchmark(TEST_COUNT, bop_bench_scalar_div) << std::endl;
     std::cout << "Matrix comparison (2 units):      " << benchmark(TEST_COUNT, bop_bench_compare) << std::endl;
     std::cout << "Matrix on matrix imposition:      " << benchmark(TEST_COUNT, bop_bench_impose) << std::endl;
     std::cout << "Vector on matrix imposition:      " << benchmark(TEST_COUNT, bop_bench_impose_vec) << std::endl;
+    std::cout << "Block doubling, copied (64x64):   " << benchmark(TEST_COUNT/100, bop_bench_block_copy_add) << std::endl;
+    std::cout << "Block doubling, view (64x64):     " << benchmark(TEST_COUNT/100, bop_bench_block_view_add) << std::endl;
+    std::cout << "1% dense times dense (512x512):   " << benchmark(TEST_COUNT/10000, bop_bench_sparse_dense_512) << std::endl;
+    std::cout << "CSR times dense (512x512):        " << benchmark(TEST_COUNT/10000, bop_bench_sparse_csr_512) << std::endl;
+    std::cout << "Tridiagonal SpMV (100000):        " << benchmark(TEST_COUNT/1000, bop_bench_spmv_100k) << std::endl;
+    std::cout << "Tridiagonal SpMV, pool (100000):  " << benchmark(TEST_COUNT/1000, bop_bench_spmv_100k_parallel) << std::endl;
     std::cout << "Matrix move:                      " << benchmark(TEST_COUNT, bop_bench_swap)/3 << std::endl;
+    std::cout << "Fixed matrix multiplication:      " << benchmark(TEST_COUNT, bop_bench_fixed_multiply) << std::endl;
+    std::cout << "Fixed matrix determinant:         " << benchmark(TEST_COUNT, bop_bench_fixed_det) << std::endl;
+    std::cout << "Fixed matrix invert self:         " << benchmark(TEST_COUNT, bop_bench_fixed_inverse) << std::endl;
+    std::cout << "Fixed matrix invert self (4x4):   " << benchmark(TEST_COUNT, bop_bench_fixed_inverse_4x4) << std::endl;
+    std::cout << "4096 4x4 inverses, looped:        " << benchmark(TEST_COUNT/1000, bop_bench_fixed_loop_inverse_4096) << std::endl;
+    std::cout << "4096 4x4 inverses, batched:       " << benchmark(TEST_COUNT/1000, bop_bench_batch_inverse_4096) << std::endl;
+    std::cout << "4096 4x4 determinants, looped:    " << benchmark(TEST_COUNT/1000, bop_bench_fixed_loop_det_4096) << std::endl;
+    std::cout << "4096 4x4 determinants, batched:   " << benchmark(TEST_COUNT/1000, bop_bench_batch_det_4096) << std::endl;
+    std::cout << "4096 4x4 times vector, looped:    " << benchmark(TEST_COUNT/1000, bop_bench_fixed_loop_apply_4096) << std::endl;
+    std::cout << "4096 4x4 times vector, batched:   " << benchmark(TEST_COUNT/1000, bop_bench_batch_apply_4096) << std::endl;
     std::cout << "Get offset matrix:                " << benchmark(TEST_COUNT, bop_bench_access_offset_matrix) << std::endl;
+    std::cout << "Get rotation matrix (copy):       " << benchmark(TEST_COUNT, bop_bench_rotation_copy) << std::endl;
+    std::cout << "Get rotation matrix (shared):     " << benchmark(TEST_COUNT, bop_bench_rotation_shared) << std::endl;
     std::cout << "Increment integer:                " << benchmark<double>(TEST_COUNT * 100, bop_integer_incrementation) << std::endl;
     std::cout << num << std::endl;
     return 0;
 }
 
+double gflops(uint_type size, bool blocked) {
+    /*
+        Measures the throughput of an n by n by n product in GFLOP/s,
+        repeating the product until roughly SWEEP_FLOP_TARGET floating
+        point operations have been timed.
+    */
+    std::vector<BENCH_TYPE> a(size * size), b(size * size), c(size * size);
+    for (uint_type elem = 0; elem < size * size; elem++) {
+        a[elem] = static_cast<BENCH_TYPE>(elem % 7) - 3;
+        b[elem] = static_cast<BENCH_TYPE>(elem % 5) - 2;
+    }
+    const double flop = 2.0 * size * size * size;
+    const uint_type repeats = static_cast<uint_type>(SWEEP_FLOP_TARGET / flop) + 1;
+    auto before = std::chrono::high_resolution_clock::now();
+    for (uint_type iter = 0; iter < repeats; iter++) {
+        if (blocked) kernel::gemmBlocked<BENCH_TYPE>(size, size, size, 1, a.data(), size, 1, b.data(), size, 1, 0, c.data(), size);
+        else kernel::gemmNaive<BENCH_TYPE>(size, size, size, 1, a.data(), size, 1, b.data(), size, 1, 0, c.data(), size);
+    }
+    auto after = std::chrono::high_resolution_clock::now();
+    return (flop * repeats) / std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count();
+}
+
+int gemm_sweep() {
+    std::cout << "\nMatrix multiplication throughput in GFLOP/s (n by n by n)" << std::endl;
+    std::cout << "size      naive     blocked" << std::endl;
+    for (uint_type size = 32; size <= 512; size *= 2) {
+        std::cout.width(4);
+        std::cout << size << "   ";
+        std::cout.width(8);
+        std::cout << gflops(size, false) << "   ";
+        std::cout.width(8);
+        std::cout << gflops(size, true) << std::endl;
+    }
+    return 0;
+}
+
+double product_seconds(const Matrix<BENCH_TYPE>& mat1, const Matrix<BENCH_TYPE>& mat2, bool strassen) {
+    /*
+        Best of three runs, the first of which also warms the caches and
+        packing buffers.
+    */
+    double best = 0;
+    for (uint_type run = 0; run < 3; run++) {
+        auto before = std::chrono::high_resolution_clock::now();
+        if (strassen) strassenMultiply(mat1, mat2, mat1.width() / 2);
+        else mat1 * mat2;
+        auto after = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count() / 1e9;
+        if (run == 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+int strassen_crossover() {
+    /*
+        Finds the smallest power of two size at which one level of
+        Strassen-Winograd beats the conventional kernel on this machine.
+        Only run in optimised builds, where the comparison means something.
+    */
+    #ifdef __OPTIMIZE__
+    std::cout << "\nStrassen-Winograd (one level) against the blocked kernel, in seconds" << std::endl;
+    std::cout << "size    blocked   strassen" << std::endl;
+    uint_type crossover = 0;
+    for (uint_type size = 256; size <= 2048 && crossover == 0; size *= 2) {
+        Matrix<BENCH_TYPE> mat1(size, size), mat2(size, size);
+        for (uint_type elem = 0; elem < size * size; elem++) {
+            mat1.element(elem) = static_cast<BENCH_TYPE>(elem % 7) - 3;
+            mat2.element(elem) = static_cast<BENCH_TYPE>(elem % 5) - 2;
+        }
+        double blocked = product_seconds(mat1, mat2, false);
+        double strassen = product_seconds(mat1, mat2, true);
+        std::cout.width(4);
+        std::cout << size << "   " << blocked << "   " << strassen << std::endl;
+        if (strassen < blocked) crossover = size;
+    }
+    if (crossover != 0) std::cout << "Strassen crossover found on this machine: " << crossover << std::endl;
+    else std::cout << "Strassen crossover found on this machine: above 2048" << std::endl;
+    #else
+    std::cout << "\nStrassen crossover search skipped in unoptimised builds." << std::endl;
+    #endif
+    return 0;
+}
+
 int main() {
     OffsetMatrix::make(3,3);
     mat_tests();
+    gemm_sweep();
+    strassen_crossover();
     return 0;
 }
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <bop-maths/maths.hpp>
+#include <bop-utility/ThreadPool.hpp>
+#include <bop-defaults/types.hpp>
+
+using namespace bop::maths;
+using namespace bop;
+
+#define BENCH_TYPE double
+
+double timeProduct(const Matrix<BENCH_TYPE>& mat1, const Matrix<BENCH_TYPE>& mat2, util::ThreadPool& pool, Matrix<BENCH_TYPE>& result) {
+    auto before = std::chrono::high_resolution_clock::now();
+    result = multiply(mat1, mat2, pool);
+    auto after = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count() / 1e9;
+}
+
+int thread_sweep(uint_type size, uint_type max_threads) {
+    /*
+        Times an n by n product for every thread count up to max_threads,
+        reporting the speedup over one thread and checking the result does
+        not change with the thread count.
+    */
+    Matrix<BENCH_TYPE> mat1(size, size), mat2(size, size);
+    for (uint_type elem = 0; elem < size * size; elem++) {
+        mat1.element(elem) = static_cast<BENCH_TYPE>(elem % 7) - 3;
+        mat2.element(elem) = static_cast<BENCH_TYPE>(elem % 5) - 2;
+    }
+    const double flop = 2.0 * size * size * size;
+    Matrix<BENCH_TYPE> reference;
+    double single = 0;
+    std::cout << "\nProduct of two " << size << " by " << size << " matrices" << std::endl;
+    std::cout << "threads   seconds    GFLOP/s    speedup   identical" << std::endl;
+    for (uint_type threads = 1; threads <= max_threads; threads++) {
+        util::ThreadPool pool(threads);
+        Matrix<BENCH_TYPE> result;
+        double seconds = timeProduct(mat1, mat2, pool, result);
+        if (threads == 1) {
+            single = seconds;
+            reference = result;
+        }
+        std::cout.width(7);
+        std::cout << threads << "   ";
+        std::cout.width(7);
+        std::cout << seconds << "   ";
+        std::cout.width(8);
+        std::cout << flop / seconds / 1e9 << "   ";
+        std::cout.width(7);
+        std::cout << single / seconds << "   " << (result == reference ? "yes" : "NO") << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    uint_type max_threads = std::max<uint_type>(1, std::thread::hardware_concurrency());
+    std::cout << std::fixed;
+    std::cout << "This hardware supports " << max_threads << " threads." << std::endl;
+    if (argc > 1) {
+        for (int arg = 1; arg < argc; arg++) thread_sweep(std::atoi(argv[arg]), max_threads);
+    }
+    else {
+        thread_sweep(1024, max_threads);
+        thread_sweep(2048, max_threads);
+    }
+    return 0;
+}
@@ -1,10 +1,24 @@
 #include <iostream>
 #include <utility>
+#include <thread>
+#include <atomic>
 #define BOP_MATRIX_MULTIPLY_DISCARD_TINY
 #include <bop-maths/maths.hpp>
 
 using namespace bop::maths;
 
+double largestElement(const Matrix<double>& mat) {
+    /*
+        Largest absolute element, for checking residuals and differences
+        against a tolerance.
+    */
+    double largest = 0;
+    for (bop::uint_type row = 0; row < mat.height(); row++) {
+        for (bop::uint_type col = 0; col < mat.width(); col++) largest = std::max(largest, std::abs(mat.element(row,col)));
+    }
+    return largest;
+}
+
 int testVectors() {
     std::cout << "----\n----\nmaths::bop::Vector testing\n----\n----" << std::endl;
     /*
@@ -162,6 +176,12 @@ int testMatrices() {
     matrot_2 *= matrot_1;
     std::cout << "when applied to matrix" << std::endl << matrot_2 << "yeilds" << std::endl << (matrot_2 * matrot_1) << "and applied to vector " << vec1 << " yeilds " << (matrot_1 * vec1) << std::endl;
 
+    Matrix<double> mat_nonconform = {{1,2,3},{4,5,6}};
+    Matrix<double> mat_nonconform_product = mat_nonconform;
+    mat_nonconform_product *= mat_nonconform;
+    std::cout << "a product whose shapes do not conform leaves the left operand unchanged: "
+              << ((mat_nonconform * mat_nonconform) == mat_nonconform && mat_nonconform_product == mat_nonconform) << std::endl;
+
     Matrix<double> mat_LU = {{3,4,5},{1,7,2},{6,6,13}};
     auto LU_decomp = mat_LU.decompose();
     std::cout << "the matrix:\n" << mat_LU << "has the LU decomposition of\n" << LU_decomp.lower << "and\n" << LU_decomp.upper << std::endl;
@@ -170,6 +190,1013 @@ int testMatrices() {
     std::cout << "the determinant of the upper matrix is: " << LU_decomp.upper.det() << std::endl;
     std::cout << "the determinant of the original matrix is: " << mat_LU.det() << std::endl;
     std::cout << "the offset matrix for a 3x4 matrix is:\n" << OffsetMatrix::make(3,4) << std::endl;
+    /*
+        Expression tests
+    */
+    std::cout << "\n----\nExpression Tests\n----" << std::endl;
+    Matrix<double> expr_a = {{1,2},{3,4}};
+    Matrix<double> expr_b = {{5,6},{7,8}};
+    Matrix<double> expr_c = {{2,2},{2,2}};
+    static_assert(!MatrixExpressionOperands<Matrix<float>, Matrix<double> >::value, "Expressions should not mix element types");
+    static_assert(!MatrixExpressionOperands<Matrix<float>, decltype(expr_a + expr_b)>::value, "Expressions should not mix element types");
+    Matrix<double> expr_result = expr_a + expr_b * 2.0 - expr_c / 2.0;
+    std::cout << "A:\n" << expr_a << "B:\n" << expr_b << "C:\n" << expr_c << "A + B*2 - C/2 (expecting [+10,+13],[+16,+19]):\n" << expr_result << std::endl;
+    expr_result += expr_a - expr_b;
+    std::cout << "adding A - B to the result (expecting [+6,+9],[+12,+15]):\n" << expr_result << std::endl;
+    std::cout << "(A + B) * C evaluates the sum before the product (expecting [+28,+28],[+44,+44]):\n" << ((expr_a + expr_b) * expr_c) << std::endl;
+    return 0;
+}
+
+int testFixedMatrices() {
+    std::cout << "----\n----\nmaths::bop::FixedMatrix testing\n----\n----" << std::endl;
+    constexpr FixedMatrix<double,2,2> fixed_const(4,8,0,1);
+    static_assert(fixed_const.element(0,1) == 8, "FixedMatrix construction should be usable in constant expressions");
+    constexpr FixedMatrix<double,3,3> fixed_zero;
+    constexpr FixedMatrix<double,3,2> fixed_identity = FixedMatrix<double,3,2>::identity();
+    static_assert(fixed_zero.element(1,1) == 0 && fixed_identity.element(1,1) == 1 && fixed_identity.element(2,1) == 0 && fixed_identity.element(0,1) == 0,
+                  "FixedMatrix default construction and identity() should be usable in constant expressions");
+    static_assert(!std::is_constructible<FixedMatrix<double,2,2>, double, double, double>::value, "FixedMatrix should not be constructible from the wrong number of elements");
+    static_assert(!std::is_convertible<double, FixedMatrix<double,1,1>>::value, "FixedMatrix element construction should be explicit");
+    std::cout << "constexpr constructed 2x2:" << fixed_const << "with inverse" << fixed_const.inverted() << std::endl;
+    matrix3 fixed3 = {{3,2,4},{2,7,2},{-1,2,5}};
+    std::cout << "3x3 fixed matrix:" << fixed3 << "has determinant " << fixed3.det() << " (dynamic: " << Matrix<double>(fixed3).det() << ")" << std::endl;
+    std::cout << "multiplied by it's inverse:" << (fixed3 * fixed3.inverted()) << std::endl;
+    matrix4 fixed4 = {{2,0,1,3},{1,4,0,2},{0,1,5,1},{3,2,1,6}};
+    std::cout << "4x4 fixed matrix:" << fixed4 << "has determinant " << fixed4.det() << " (dynamic: " << Matrix<double>(fixed4).det() << ")" << std::endl;
+    matrix4 fixed4_product = fixed4 * fixed4.inverted();
+    std::cout << "multiplied by it's inverse:" << fixed4_product << std::endl;
+    FixedMatrix<double,2,3> fixed_rect = {{1,2,3},{4,5,6}};
+    std::cout << "the transpose of" << fixed_rect << "is:" << fixed_rect.transposed() << std::endl;
+    Matrix<double> from_fixed = fixed_rect * fixed_rect.transposed();
+    std::cout << "a fixed product converted to a dynamic matrix:" << from_fixed << std::endl;
+    Vector<double> fixed_vec = {1,1,1};
+    std::cout << "applied to vector " << fixed_vec << " the 3x3 fixed matrix yields " << (fixed3 * fixed_vec) << std::endl;
+    return 0;
+}
+
+int testParallelProduct() {
+    std::cout << "----\n----\nmaths::bop parallel multiplication testing\n----\n----" << std::endl;
+    Matrix<double> par_mat1(300,300), par_mat2(300,300);
+    for (bop::uint_type elem = 0; elem < 300 * 300; elem++) {
+        par_mat1.element(elem) = static_cast<double>(elem % 13) - 6;
+        par_mat2.element(elem) = static_cast<double>(elem % 11) - 5;
+    }
+    Matrix<double> serial = par_mat1 * par_mat2;
+    for (bop::uint_type threads = 1; threads <= 4; threads++) {
+        bop::util::ThreadPool pool(threads);
+        std::cout << "300x300 product on " << threads << " thread(s) matches the serial product: " << (multiply(par_mat1, par_mat2, pool) == serial) << std::endl;
+    }
+    std::cout << "300x300 product on the default pool matches the serial product: " << (multiply(par_mat1, par_mat2) == serial) << std::endl;
+    /*
+        A shared dimension deeper than one kc panel, with a last row of
+        tiles too small for the packed kernel on its own, and elements
+        that round so any change in summation order shows.
+    */
+    Matrix<double> tall(300,129), narrow(10,300);
+    for (bop::uint_type elem = 0; elem < 300 * 129; elem++) tall.element(elem) = std::sin(0.37 * elem);
+    for (bop::uint_type elem = 0; elem < 10 * 300; elem++) narrow.element(elem) = std::cos(0.91 * elem);
+    Matrix<double> ragged_serial = tall * narrow;
+    bool ragged_matches = true;
+    for (bop::uint_type threads = 2; threads <= 4; threads++) {
+        bop::util::ThreadPool pool(threads);
+        ragged_matches &= (multiply(tall, narrow, pool) == ragged_serial);
+    }
+    std::cout << "129x300 by 300x10 product matches the serial product exactly on 2 to 4 threads: " << ragged_matches << std::endl;
+    bop::util::ThreadPool nested_pool(2);
+    std::atomic<bop::uint_type> nested_matches(0);
+    for (bop::uint_type task = 0; task < 4; task++) {
+        nested_pool.addTask([&]() {
+            if (multiply(par_mat1, par_mat2, nested_pool) == serial) nested_matches++;
+        });
+    }
+    nested_pool.wait();
+    std::cout << "products called from tasks on the same pool run inline and match: " << (nested_matches == 4) << std::endl;
+    std::cout << "a non-conforming parallel product returns the left operand unchanged: " << (multiply(tall, tall, nested_pool) == tall) << std::endl;
+    return 0;
+}
+
+int testMatrixVectorProducts() {
+    std::cout << "----\n----\nmaths::bop matrix-vector product testing\n----\n----" << std::endl;
+    /*
+        Integer elements keep every sum exact, so the kernels can be
+        compared for equality with a naive loop. 5003 columns cross the
+        slices the kernels work in, and 203 rows leave a tail of three
+        below the four row blocks.
+    */
+    const bop::uint_type height = 203, width = 5003;
+    Matrix<double> gemv_mat(width, height);
+    Vector<double> gemv_vec(width), gemv_left(height);
+    for (bop::uint_type row = 0; row < height; row++) for (bop::uint_type col = 0; col < width; col++) gemv_mat.element(row,col) = static_cast<double>(((row * 7) + (col * 3)) % 17) - 8;
+    for (bop::uint_type col = 0; col < width; col++) gemv_vec[col] = static_cast<double>(col % 5) - 2;
+    for (bop::uint_type row = 0; row < height; row++) gemv_left[row] = static_cast<double>(row % 7) - 3;
+    Vector<double> expected(height), expected_left(width);
+    for (bop::uint_type row = 0; row < height; row++) {
+        for (bop::uint_type col = 0; col < width; col++) {
+            expected[row] += gemv_mat.element(row,col) * gemv_vec[col];
+            expected_left[col] += gemv_left[row] * gemv_mat.element(row,col);
+        }
+    }
+    Vector<double> gemv_out(height);
+    double* out_storage = &gemv_out[0];
+    gemv_mat.apply(gemv_vec, gemv_out);
+    std::cout << "a 203x5003 matrix times a vector matches the naive product: " << (gemv_out == expected)
+              << ", written into the given vector: " << (&gemv_out[0] == out_storage) << std::endl;
+    gemv_mat.apply(gemv_vec, gemv_out, 2.0, -1.0);
+    std::cout << "2Ax - y gives Ax again: " << (gemv_out == expected) << std::endl;
+    std::cout << "operator* matches: " << ((gemv_mat * gemv_vec) == expected) << std::endl;
+    Vector<double> gemv_left_out;
+    gemv_mat.applyTransposed(gemv_left, gemv_left_out);
+    std::cout << "a vector times the matrix matches the naive product: " << (gemv_left_out == expected_left) << std::endl;
+    Matrix<double> batch_vecs(width, 3), batch_out;
+    for (bop::uint_type vec = 0; vec < 3; vec++) for (bop::uint_type col = 0; col < width; col++) batch_vecs.element(vec,col) = gemv_vec[col] * static_cast<double>(vec + 1);
+    gemv_mat.applyBatch(batch_vecs, batch_out);
+    bool batch_matches = (batch_out.width() == height && batch_out.height() == 3);
+    for (bop::uint_type vec = 0; vec < 3 && batch_matches; vec++) {
+        for (bop::uint_type row = 0; row < height; row++) batch_matches = batch_matches && batch_out.element(vec,row) == expected[row] * static_cast<double>(vec + 1);
+    }
+    std::cout << "three vectors in one sweep match their separate products: " << batch_matches << std::endl;
+    Matrix<double> column_vec(1, width);
+    for (bop::uint_type col = 0; col < width; col++) column_vec.element(col) = gemv_vec[col];
+    Matrix<double> column_product = gemv_mat * column_vec;
+    bool column_matches = true;
+    for (bop::uint_type row = 0; row < height; row++) column_matches = column_matches && column_product.element(row) == expected[row];
+    std::cout << "a Matrix with one column multiplies the same way: " << column_matches << std::endl;
+    for (bop::uint_type threads = 1; threads <= 4; threads++) {
+        bop::util::ThreadPool pool(threads);
+        Vector<double> par_out, par_left_out;
+        Matrix<double> par_batch_out;
+        multiply(gemv_mat, gemv_vec, par_out, pool);
+        multiplyTransposed(gemv_mat, gemv_left, par_left_out, pool);
+        multiplyBatch(gemv_mat, batch_vecs, par_batch_out, pool);
+        std::cout << "on " << threads << " thread(s) the products match the serial ones: "
+                  << (par_out == expected && par_left_out == expected_left && par_batch_out == batch_out) << std::endl;
+    }
+    Matrix<double> small_mat = {{1,2,3},{4,5,6}};
+    Vector<double> small_vec = {1,0,-1};
+    small_mat *= small_vec;
+    std::cout << "Matrix *= Vector on" << small_mat << "and (1,0,-1) gives " << small_vec << std::endl;
+    return 0;
+}
+
+int testMultiplyAdd() {
+    std::cout << "----\n----\nmaths::bop fused multiply-accumulate testing\n----\n----" << std::endl;
+    /*
+        Integer elements keep every product exact. 70x90 times 90x60 is
+        large enough for the packed kernel.
+    */
+    Matrix<double> fma_a(90,70), fma_b(60,90), fma_c(60,70);
+    for (bop::uint_type elem = 0; elem < 90 * 70; elem++) fma_a.element(elem) = static_cast<double>(elem % 13) - 6;
+    for (bop::uint_type elem = 0; elem < 60 * 90; elem++) fma_b.element(elem) = static_cast<double>(elem % 11) - 5;
+    for (bop::uint_type elem = 0; elem < 60 * 70; elem++) fma_c.element(elem) = static_cast<double>(elem % 7) - 3;
+    const Matrix<double> product = fma_a * fma_b, original_c = fma_c;
+    const double* storage = fma_c.rowData(0);
+    bool accumulated = fma_c.multiplyAdd(fma_a, fma_b);
+    std::cout << "C += AB succeeds: " << accumulated << ", matches C + A*B: " << (fma_c == original_c + product)
+              << ", in C's own storage: " << (fma_c.rowData(0) == storage) << std::endl;
+    Matrix<double> a_t = fma_a.transposed(), b_t = fma_b.transposed(), scaled = original_c;
+    scaled.multiplyAdd(a_t, b_t, 2.0, -1.0, true, true);
+    std::cout << "C = 2AB - C read through stored transposes of A and B matches: " << (scaled == product * 2.0 - original_c) << std::endl;
+    Matrix<double> overwritten(60, 70, std::nan(""));
+    overwritten.multiplyAdd(fma_a, b_t, 1.0, 0.0, false, true);
+    std::cout << "beta = 0 overwrites a matrix of NaNs with AB: " << (overwritten == product) << std::endl;
+    Matrix<double> unchanged = original_c;
+    std::cout << "mismatched shapes are refused: " << !unchanged.multiplyAdd(fma_b, fma_a)
+              << ", leaving C alone: " << (unchanged == original_c) << std::endl;
+    Matrix<double> outer(80, 80, 1);
+    outer.block(5, 10, 60, 70).multiplyAdd(fma_a, fma_b, 1.0, 0.0);
+    std::cout << "writing into a block of a larger matrix matches: " << (outer.block(5, 10, 60, 70) == product.view())
+              << ", leaving the rest: " << (outer.element(4,10) == 1 && outer.element(5,9) == 1 && outer.element(75,79) == 1) << std::endl;
+    Matrix<double> square(90, 90), square_b(90, 90);
+    for (bop::uint_type elem = 0; elem < 90 * 90; elem++) {
+        square.element(elem) = static_cast<double>(elem % 5) - 2;
+        square_b.element(elem) = static_cast<double>(elem % 3) - 1;
+    }
+    const Matrix<double> aliased_expected = square + square * square_b;
+    square.multiplyAdd(square, square_b);
+    std::cout << "C += CB with C as an operand matches: " << (square == aliased_expected) << std::endl;
+    return 0;
+}
+
+int testStructuredMatrices() {
+    std::cout << "----\n----\nmaths::bop structured matrix testing\n----\n----" << std::endl;
+    Matrix<double> st_mat = {{1,2,3},{4,5,6},{7,8,10}};
+    ScaledIdentity<double> ident = IdentityMatrix<double>::implicit(3);
+    std::cout << "A * I == A: " << (st_mat * ident == st_mat) << ", I * A == A: " << (ident * st_mat == st_mat)
+              << ", I converts to the dense identity: " << (Matrix<double>(ident) == IdentityMatrix<double>::make(3)) << std::endl;
+    Matrix<double> shifted = st_mat - ScaledIdentity<double>(3, 2);
+    std::cout << "A - 2I is" << shifted << "and matches the dense difference: " << (shifted == st_mat - IdentityMatrix<double>::make(3) * 2.0) << std::endl;
+    DiagonalMatrix<double> diag = {2,-1,3};
+    Matrix<double> dense_diag(diag);
+    std::cout << "D * A == dense D * A: " << (diag * st_mat == dense_diag * st_mat)
+              << ", A * D == A * dense D: " << (st_mat * diag == st_mat * dense_diag)
+              << ", det(D) = " << diag.det() << ", D * inverse(D) == I: " << (Matrix<double>(diag * diag.inverted()) == IdentityMatrix<double>::make(3)) << std::endl;
+    Matrix<double> in_place(st_mat);
+    in_place *= diag;
+    in_place += diag;
+    std::cout << "A *= D then += D matches: " << (in_place == st_mat * dense_diag + dense_diag) << std::endl;
+    Vector<double> st_vec = {1,2,3};
+    Vector<double> diag_vec = diag * st_vec;
+    std::cout << "D * (1,2,3) = (" << diag_vec[0] << "," << diag_vec[1] << "," << diag_vec[2] << ")" << std::endl;
+    PermutationMatrix<double> perm(std::vector<bop::uint_type>{2,0,1});
+    Matrix<double> dense_perm(perm);
+    std::cout << "the permutation" << dense_perm << "has determinant " << perm.det() << " (dense: " << dense_perm.det() << ")"
+              << ", P * A matches: " << (perm * st_mat == dense_perm * st_mat)
+              << ", A * P matches: " << (st_mat * perm == st_mat * dense_perm)
+              << ", P * P^T == I: " << (Matrix<double>(perm * perm.transposed()) == IdentityMatrix<double>::make(3)) << std::endl;
+    PermutationMatrix<double> swapped(4);
+    swapped.swap(0,3);
+    std::cout << "a single swap of 4 rows has determinant " << swapped.det() << std::endl;
+    DiagonalMatrix<double> small_entries(400, 0.1);
+    std::cout << "a 400x400 diagonal of 0.1, whose determinant underflows to " << small_entries.det()
+              << ", still inverts: " << (small_entries.inverted()[0] == 10) << std::endl;
+    DiagonalMatrix<double> wider(4, 2.0);
+    std::cout << "products of mismatched sizes leave the operand unchanged: "
+              << ((ScaledIdentity<double>(3, 2) * ScaledIdentity<double>(4, 3)).size() == 3 && (ScaledIdentity<double>(3, 2) * wider)[3] == 2.0) << std::endl;
+    return 0;
+}
+
+int testMatrixCache() {
+    std::cout << "----\n----\nmaths::bop::MatrixCache testing\n----\n----" << std::endl;
+    MatrixCache<bop::uint_type,double> cache(2);
+    bop::uint_type builds = 0;
+    auto build = [&builds]() { builds++; return IdentityMatrix<double>::make(3); };
+    MatrixCache<bop::uint_type,double>::handle_type first = cache.get(1, build);
+    cache.get(2, build);
+    bool shared = (cache.get(1, build) == first);
+    cache.get(3, build);
+    MatrixCacheStatistics stats = cache.statistics();
+    std::cout << "a repeated key shares one matrix: " << shared << ", built " << builds << " times with "
+              << stats.hits << " hit, " << stats.misses << " misses and " << stats.evictions << " eviction, holding " << stats.size << " of " << stats.capacity << std::endl;
+    cache.get(2, build);
+    std::cout << "the least recently used key was evicted: " << (builds == 4) << ", its handle still reads " << first->element(1,1) << std::endl;
+    cache.setCapacity(0);
+    std::cout << "a zero capacity empties the cache: " << (cache.size() == 0) << std::endl;
+    RotationMatrix<double>::cache().resetStatistics();
+    bop::uint_type cached_rotations = RotationMatrix<double>::cache().size();
+    for (bop::uint_type iter = 0; iter < 3; iter++) RotationMatrix<double>::shared(std::numeric_limits<double>::quiet_NaN());
+    std::cout << "non-finite angles are not cached: " << (RotationMatrix<double>::cache().size() == cached_rotations && RotationMatrix<double>::cache().statistics().misses == 0) << std::endl;
+    std::cout << "RotationMatrix::shared matches make: " << (*RotationMatrix<double>::shared(45) == RotationMatrix<double>::make(45))
+              << ", OffsetMatrix::shared matches make: " << (*OffsetMatrix::shared(3,4) == OffsetMatrix::make(3,4)) << std::endl;
+    /*
+        Threads share the factory caches, each asks for a handful of angles
+        more often than the cache has room for.
+    */
+    RotationMatrix<double>::cache().setCapacity(8);
+    RotationMatrix<double>::cache().resetStatistics();
+    std::vector<std::thread> threads;
+    std::atomic<bop::uint_type> wrong(0);
+    for (bop::uint_type thread = 0; thread < 4; thread++) {
+        threads.emplace_back([thread, &wrong]() {
+            for (bop::uint_type iter = 0; iter < 2000; iter++) {
+                double angle = static_cast<double>((iter * (thread + 1)) % 12) * 30;
+                RotationMatrix<double>::handle rotation = RotationMatrix<double>::shared(angle);
+                if (std::abs(rotation->element(1,0) - std::sin(angle * pi / 180.0)) > 1e-12) wrong++;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    stats = RotationMatrix<double>::cache().statistics();
+    std::cout << "4 threads got the right rotations: " << (wrong == 0) << ", every lookup was counted: " << (stats.hits + stats.misses == 8000)
+              << ", the cache stayed within its capacity: " << (stats.size <= 8) << std::endl;
+    return 0;
+}
+
+int testPackedMatrices() {
+    std::cout << "----\n----\nmaths::bop packed storage testing\n----\n----" << std::endl;
+    Matrix<double> pk_dense(7,7), pk_rhs(3,7);
+    for (bop::uint_type row = 0; row < 7; row++) {
+        for (bop::uint_type col = 0; col < 7; col++) pk_dense.element(row,col) = static_cast<double>(((row * 5) + (col * 3)) % 9) - 4;
+        pk_dense.element(row,row) = 10 + row;
+        for (bop::uint_type col = 0; col < 3; col++) pk_rhs.element(row,col) = static_cast<double>((row + col) % 5) - 2;
+    }
+    TriangularMatrix<double> lower(pk_dense), upper(pk_dense, true);
+    Matrix<double> dense_lower(lower), dense_upper(upper);
+    std::cout << "a 7x7 triangle stores " << lower.storage() << " elements, the upper one is" << dense_upper
+              << "L * B matches: " << (lower * pk_rhs == dense_lower * pk_rhs) << ", U * B matches: " << (upper * pk_rhs == dense_upper * pk_rhs)
+              << ", B^T * L matches: " << (pk_rhs.transposed() * lower == pk_rhs.transposed() * dense_lower)
+              << ", B^T * U matches: " << (pk_rhs.transposed() * upper == pk_rhs.transposed() * dense_upper)
+              << ", the transpose of U is lower: " << (Matrix<double>(upper.transposed()) == dense_upper.transposed()) << std::endl;
+    std::cout << "solving with L leaves a residual below 1e-12: " << (largestElement(dense_lower * lower.solve(pk_rhs) - pk_rhs) < 1e-12)
+              << ", with U: " << (largestElement(dense_upper * upper.solve(pk_rhs) - pk_rhs) < 1e-12)
+              << ", with L^T: " << (largestElement(dense_lower.transposed() * lower.solve(pk_rhs, true) - pk_rhs) < 1e-12)
+              << ", with U^T: " << (largestElement(dense_upper.transposed() * upper.solve(pk_rhs, true) - pk_rhs) < 1e-12) << std::endl;
+    SymmetricMatrix<double> sym(pk_dense.transposed() * pk_dense);
+    Matrix<double> dense_sym(sym);
+    Vector<double> pk_vec = {1,-2,3,0,2,-1,1};
+    Vector<double> sym_vec = sym * pk_vec, dense_vec = dense_sym * pk_vec;
+    bool vec_match = true;
+    for (bop::uint_type elem = 0; elem < 7; elem++) vec_match = vec_match && (sym_vec[elem] == dense_vec[elem]);
+    std::cout << "the symmetric A^T A stores " << sym.storage() << " elements, is symmetric: " << (dense_sym == dense_sym.transposed())
+              << ", S * B matches: " << (sym * pk_rhs == dense_sym * pk_rhs) << ", B^T * S matches: " << (pk_rhs.transposed() * sym == pk_rhs.transposed() * dense_sym)
+              << ", S * v matches: " << vec_match << std::endl;
+    TriangularMatrix<double> factor(0);
+    bool definite = sym.cholesky(factor);
+    std::cout << "its packed Cholesky factor exists: " << definite << ", matches the dense one to 1e-10: " << (largestElement(Matrix<double>(factor) - dense_sym.cholesky().lower()) < 1e-10)
+              << ", solving leaves a residual below 1e-9: " << (largestElement(dense_sym * sym.solve(pk_rhs) - pk_rhs) < 1e-9) << std::endl;
+    BandedMatrix<double> banded(pk_dense, 2, 1);
+    Matrix<double> dense_banded(banded);
+    std::cout << "the band with 2 subdiagonals and 1 superdiagonal is" << dense_banded
+              << "A * B matches: " << (banded * pk_rhs == dense_banded * pk_rhs) << ", B^T * A matches: " << (pk_rhs.transposed() * banded == pk_rhs.transposed() * dense_banded)
+              << ", solving leaves a residual below 1e-12: " << (largestElement(dense_banded * banded.solve(pk_rhs) - pk_rhs) < 1e-12) << std::endl;
+    /*
+        A zero leading pivot needs a row swap, which the banded solve has
+        to make room for.
+    */
+    BandedMatrix<double> pivoting(5, 1, 1);
+    for (bop::uint_type row = 0; row < 5; row++) {
+        pivoting.entry(row,row) = (row % 2 == 0) ? 0 : 3;
+        if (row > 0) pivoting.entry(row,row - 1) = 2;
+        if (row < 4) pivoting.entry(row,row + 1) = 1;
+    }
+    pivoting.entry(4,4) = 1;
+    Matrix<double> pivot_rhs = {{1},{2},{3},{4},{5}};
+    Matrix<double> pivot_x = pivot_rhs;
+    bool solved = pivoting.solveInPlace(pivot_x);
+    std::cout << "a band needing row swaps is solved: " << solved << ", with a residual below 1e-12: " << (largestElement(Matrix<double>(pivoting) * pivot_x - pivot_rhs) < 1e-12) << std::endl;
+    /*
+        The first elimination step succeeds and zeroes the second pivot.
+    */
+    BandedMatrix<double> singular_band(4, 1, 1);
+    singular_band.entry(0,0) = 1;
+    singular_band.entry(0,1) = 1;
+    singular_band.entry(1,0) = 1;
+    singular_band.entry(1,1) = 1;
+    singular_band.entry(2,2) = 2;
+    singular_band.entry(2,3) = 1;
+    singular_band.entry(3,2) = 1;
+    singular_band.entry(3,3) = 2;
+    Matrix<double> singular_rhs = {{1},{2},{3},{4}};
+    Matrix<double> singular_x = singular_rhs;
+    std::cout << "a singular band is reported: " << !singular_band.solveInPlace(singular_x) << ", leaving b unchanged: " << (singular_x == singular_rhs)
+              << ", and solve returns b: " << (singular_band.solve(singular_rhs) == singular_rhs) << std::endl;
+    TriangularMatrix<double> small_diagonal(400, false);
+    for (bop::uint_type elem = 0; elem < 400; elem++) small_diagonal.entry(elem,elem) = 0.1;
+    Matrix<double> ones(1, 400, 1.0);
+    std::cout << "a 400x400 triangle with a diagonal of 0.1, whose determinant underflows, is solved: "
+              << (small_diagonal.solveInPlace(ones) && std::abs(ones.element(0,0) - 10) < 1e-12) << std::endl;
+    return 0;
+}
+
+int testMatrixFunctions() {
+    std::cout << "----\n----\nmaths::bop pow and expm testing\n----\n----" << std::endl;
+    Matrix<bop::int_type> fibonacci = {{1,1},{1,0}};
+    std::cout << "the 40th power of the Fibonacci matrix is" << pow(fibonacci, 40) << "and its zeroth power is" << pow(fibonacci, 0);
+    Matrix<double> pw_mat(6,6), repeated(6,6);
+    for (bop::uint_type elem = 0; elem < 36; elem++) pw_mat.element(elem) = static_cast<double>((elem * 7) % 5) - 2;
+    for (bop::uint_type elem = 0; elem < 6; elem++) repeated.element(elem,elem) = 1;
+    bool powers_match = true;
+    for (bop::uint_type power = 1; power <= 9; power++) {
+        repeated *= pw_mat;
+        powers_match = powers_match && (pow(pw_mat, power) == repeated);
+    }
+    std::cout << "powers 1 to 9 of a 6x6 matrix match repeated multiplication: " << powers_match << std::endl;
+    Matrix<double> transition = {{0.9,0.1},{0.5,0.5}};
+    Matrix<double> steady = pow(transition, 1000);
+    std::cout << "a two state chain after 1000 steps is in its stationary distribution (5/6, 1/6): "
+              << (std::abs(steady.element(0,0) - (5.0/6.0)) < 1e-12 && std::abs(steady.element(1,1) - (1.0/6.0)) < 1e-12) << std::endl;
+    Matrix<double> nilpotent = {{0,3,0},{0,0,2},{0,0,0}};
+    Matrix<double> nil_exp = {{1,3,3},{0,1,2},{0,0,1}};
+    std::cout << "e^0 is the identity: " << (expm(Matrix<double>(4,4)) == IdentityMatrix<double>::make(4))
+              << ", e^N of a nilpotent N is I + N + N^2/2: " << (largestElement(expm(nilpotent) - nil_exp) < 1e-14) << std::endl;
+    /*
+        e^(t J) with J = {{0,1},{-1,0}} is the rotation by -t, the norms
+        chosen to reach each degree of approximant and the scaling.
+    */
+    bool rotations = true;
+    for (double t : {0.01, 0.1, 0.5, 1.5, 4.0, 30.0}) {
+        Matrix<double> generator(2,2), rotation(2,2);
+        generator.element(0,1) = t;
+        generator.element(1,0) = -t;
+        rotation.element(0,0) = rotation.element(1,1) = std::cos(t);
+        rotation.element(0,1) = std::sin(t);
+        rotation.element(1,0) = -std::sin(t);
+        rotations = rotations && (largestElement(expm(generator) - rotation) < 1e-12 * std::max(1.0, t));
+    }
+    std::cout << "e^(tJ) is a rotation for t from 0.01 to 30: " << rotations << std::endl;
+    Matrix<double> generator(8,8);
+    for (bop::uint_type row = 0; row < 8; row++) {
+        for (bop::uint_type col = 0; col < 8; col++) generator.element(row,col) = static_cast<double>(((row * 3) + (col * 5)) % 7) - 3;
+    }
+    Matrix<double> negated = generator * -1.0, doubled = generator * 2.0;
+    std::cout << "e^A e^-A is the identity to 1e-9 for an 8x8 A of 1-norm 24: " << (largestElement(expm(generator) * expm(negated) - IdentityMatrix<double>::make(8)) < 1e-9)
+              << ", e^(2A) = (e^A)^2: " << (largestElement(expm(doubled) - pow(expm(generator), 2)) < 1e-12 * largestElement(expm(doubled))) << std::endl;
+    return 0;
+}
+
+int testMatrixAllocators() {
+    std::cout << "----\n----\nmaths::bop::MatrixAllocator testing\n----\n----" << std::endl;
+    auto aligned = [](const Matrix<double>& mat) { return (reinterpret_cast<uintptr_t>(mat.rowData(0)) % BOP_MATRIX_ALIGNMENT) == 0; };
+    Matrix<double> lhs(5,5), rhs(5,5);
+    for (bop::uint_type row = 0; row < 5; row++) {
+        for (bop::uint_type col = 0; col < 5; col++) {
+            lhs.element(row,col) = static_cast<double>((row * 3) + col) - 6;
+            rhs.element(row,col) = static_cast<double>((row + (col * 2)) % 7) - 3;
+        }
+    }
+    Matrix<double> expected = lhs * rhs;
+    std::cout << "matrices come from the default allocator: " << (lhs.allocator() == &MatrixAllocator::standard()) << std::endl;
+    RecyclingMatrixAllocator recycling;
+    ArenaMatrixAllocator arena(4096);
+    HugePageMatrixAllocator huge(1 << 16);
+    Matrix<double> kept;
+    {
+        MatrixAllocatorScope scope(arena);
+        Matrix<double> product = lhs * rhs;
+        std::cout << "inside a scope the arena is used: " << (product.allocator() == &arena) << ", aligned: " << aligned(product)
+                  << ", the product matches: " << (product == expected) << std::endl;
+        {
+            MatrixAllocatorScope inner(recycling);
+            kept = Matrix<double>(7,7);
+        }
+        std::cout << "an inner scope uses its own allocator: " << (kept.allocator() == &recycling)
+                  << ", and restores the arena after: " << (&MatrixAllocator::active() == &arena) << std::endl;
+        bop::uint_type before = arena.used();
+        Matrix<double> temporary(30,30);
+        double* first = temporary.rowData(0);
+        temporary = Matrix<double>();
+        Matrix<double> reused(30,30);
+        std::cout << "a released temporary is reused by the arena: " << (reused.rowData(0) == first)
+                  << ", blocks larger than a chunk are allowed: " << (Matrix<double>(40,40).allocator() == &arena) << std::endl;
+        reused = Matrix<double>();
+        std::cout << "the arena is back where it was: " << (arena.used() == before) << std::endl;
+        bool other_thread = false;
+        std::thread([&other_thread]() { other_thread = (Matrix<double>(2,2).allocator() == &MatrixAllocator::standard()); }).join();
+        std::cout << "other threads keep the default: " << other_thread << std::endl;
+    }
+    std::cout << "leaving the scope restores the default: " << (&MatrixAllocator::active() == &MatrixAllocator::standard()) << std::endl;
+    {
+        /*
+            Cached factory matrices outlive the scope they were first asked
+            for in, so they must not live in the arena.
+        */
+        RotationMatrix<double>::handle rotation;
+        {
+            MatrixAllocatorScope scope(arena);
+            rotation = RotationMatrix<double>::shared(37);
+        }
+        arena.reset();
+        {
+            MatrixAllocatorScope scope(arena);
+            Matrix<double> overwrite(30,30);
+            overwrite.fill(99);
+        }
+        std::cout << "cached matrices avoid the arena: " << (rotation->allocator() == &MatrixAllocator::standard())
+                  << ", and survive its reset: " << (std::abs(RotationMatrix<double>::shared(37)->element(0,0) - std::cos(37 * pi / 180.0)) < 1e-12) << std::endl;
+    }
+    double* recycled = kept.rowData(0);
+    kept = Matrix<double>();
+    {
+        MatrixAllocatorScope scope(recycling);
+        Matrix<double> again(7,7);
+        std::cout << "the recycler hands released storage out again: " << (again.rowData(0) == recycled) << ", aligned: " << aligned(again) << std::endl;
+    }
+    {
+        MatrixAllocatorScope scope(huge);
+        Matrix<double> large(128,128), small(4,4);
+        large.fill(1.5);
+        void* mapped = huge.allocate(3 << 20);
+        bool huge_aligned = (reinterpret_cast<uintptr_t>(mapped) % HugePageMatrixAllocator::page_size) == 0;
+        huge.release(mapped, 3 << 20);
+        std::cout << "huge page storage is aligned: " << aligned(large) << ", small blocks still work: " << aligned(small)
+                  << ", and holds its contents: " << (large.element(127,127) == 1.5) << ", mapped blocks start on a huge page: " << huge_aligned << std::endl;
+    }
+    return 0;
+}
+
+template<class T>
+bool simdLevelMatchesScalar(simd::Level lvl) {
+    /*
+        Every length from 0 to 40 runs each kernel's scalar tail for all
+        the vector widths. Small integers keep every result exact, so the
+        vector kernels must match the scalar ones however they reorder
+        their sums.
+    */
+    typedef kernel::ElementKernels<T> kernels;
+    typename kernels::vectorised vectorised;
+    bool matches = true;
+    for (bop::uint_type n = 0; n <= 40; n++) {
+        std::vector<T> x(n + 1), a(4 * (n + 1)), y_vector(n + 1), y_scalar(n + 1);
+        for (bop::uint_type elem = 0; elem <= n; elem++) {
+            x[elem] = static_cast<T>(static_cast<int>(elem % 7) - 3);
+            y_vector[elem] = y_scalar[elem] = static_cast<T>(static_cast<int>(elem % 5) - 2);
+        }
+        for (bop::uint_type elem = 0; elem < a.size(); elem++) a[elem] = static_cast<T>(static_cast<int>(elem % 9) - 4);
+        /*
+            The element one past n is a guard that no kernel may write.
+        */
+        kernels::resolveAxpy(vectorised, lvl)(n, T(3), x.data(), y_vector.data());
+        kernel::axpyScalar<T>(n, T(3), x.data(), y_scalar.data());
+        kernels::resolveScal(vectorised, lvl)(n, T(0.5), y_vector.data());
+        kernel::scalScalar<T>(n, T(0.5), y_scalar.data());
+        matches = matches && y_vector == y_scalar;
+        kernels::resolveStream(vectorised, lvl)(n, x.data(), y_vector.data());
+        kernel::streamFence();
+        kernel::streamScalar<T>(n, x.data(), y_scalar.data());
+        matches = matches && y_vector == y_scalar;
+        matches = matches && kernels::resolveDot(vectorised, lvl)(n, a.data(), x.data()) == kernel::dotScalar<T>(n, a.data(), x.data());
+        T out_vector[4], out_scalar[4];
+        kernels::resolveDot4(vectorised, lvl)(n, a.data(), n + 1, x.data(), out_vector);
+        kernel::dot4Scalar<T>(n, a.data(), n + 1, x.data(), out_scalar);
+        matches = matches && std::equal(out_vector, out_vector + 4, out_scalar);
+        typedef typename std::conditional<std::is_same<T,float>::value, double, float>::type other_type;
+        std::vector<other_type> converted_vector(n + 1, other_type(7)), converted_scalar(n + 1, other_type(7));
+        kernel::ConversionKernels<T,other_type>::resolveConvert(typename kernel::ConversionKernels<T,other_type>::vectorised(), lvl)(n, x.data(), converted_vector.data());
+        kernel::convertScalar<T,other_type>(n, x.data(), converted_scalar.data());
+        matches = matches && converted_vector == converted_scalar;
+    }
+    return matches;
+}
+
+int testSimdKernels() {
+    std::cout << "----\n----\nmaths::bop SIMD kernel testing\n----\n----" << std::endl;
+    std::cout << "the host supports " << simd::name(simd::level()) << std::endl;
+    for (int lvl = simd::scalar; lvl <= simd::level(); lvl++) {
+        std::cout << simd::name(static_cast<simd::Level>(lvl)) << " kernels match the scalar ones for lengths 0 to 40, double: "
+                  << simdLevelMatchesScalar<double>(static_cast<simd::Level>(lvl))
+                  << ", float: " << simdLevelMatchesScalar<float>(static_cast<simd::Level>(lvl)) << std::endl;
+    }
+    return 0;
+}
+
+int testExactElimination() {
+    std::cout << "----\n----\nmaths::bop::BareissElimination testing\n----\n----" << std::endl;
+    Matrix<bop::int_type> int4 = {{2,0,1,3},{1,4,0,2},{0,1,5,1},{3,2,1,6}};
+    std::cout << "the 4x4 integer matrix" << int4 << "has determinant " << int4.det() << " (from doubles: " << Matrix<double>(int4).det() << ")" << std::endl;
+    /*
+        L*U with unit lower L and a diagonal of 3s in U has determinant
+        3^12 exactly.
+    */
+    Matrix<bop::int_type> lower(12,12,0), upper(12,12,0);
+    for (bop::uint_type row = 0; row < 12; row++) {
+        for (bop::uint_type col = 0; col < row; col++) lower.element(row,col) = static_cast<bop::int_type>(((row * 5) + (col * 3)) % 7) - 3;
+        lower.element(row,row) = 1;
+        upper.element(row,row) = 3;
+        for (bop::uint_type col = row + 1; col < 12; col++) upper.element(row,col) = static_cast<bop::int_type>(((row * 3) + (col * 2)) % 5) - 2;
+    }
+    Matrix<bop::int_type> product = lower * upper;
+    std::cout << "a 12x12 integer matrix built from LU factors has determinant " << product.det() << " (expecting 531441)"
+              << ", its fraction-free elimination agrees: " << (product.bareiss().det() == 531441) << std::endl;
+    Matrix<bop::int_type> tridiagonal(6,6,0);
+    for (bop::uint_type row = 0; row < 6; row++) {
+        tridiagonal.element(row,row) = 2;
+        if (row > 0) tridiagonal.element(row,row - 1) = tridiagonal.element(row - 1,row) = 1;
+    }
+    std::cout << "the 6x6 tridiagonal matrix of 1,2,1 has determinant " << tridiagonal.det() << " (expecting 7)" << std::endl;
+    Matrix<bop::int_type> singular = {{1,2,3},{4,5,6},{7,8,9}};
+    BareissElimination<bop::int_type> singular_elim = singular.bareiss();
+    Matrix<bop::int_type> expected_rref = {{1,0,-1},{0,1,2},{0,0,0}};
+    std::cout << "the matrix" << singular << "has rank " << singular_elim.rank() << ", determinant " << singular.det()
+              << " and reduced row echelon form" << singular_elim.reducedEchelon() << "over " << singular_elim.denominator()
+              << ", which is right: " << (singular_elim.reducedEchelon() == expected_rref * singular_elim.denominator()) << std::endl;
+    Matrix<bop::int_type> wide = {{0,2,4,2,6},{0,1,2,1,3},{3,0,3,6,0},{1,1,3,3,2}};
+    BareissElimination<bop::int_type> wide_elim = wide.bareiss();
+    std::cout << "a 4x5 matrix of rank " << wide_elim.rank() << " has pivots in columns " << wide_elim.pivotColumns()[0] << ", " << wide_elim.pivotColumns()[1] << ", " << wide_elim.pivotColumns()[2]
+              << " and is of full rank: " << wide_elim.fullRank() << std::endl;
+    return 0;
+}
+
+int testStrassen() {
+    std::cout << "----\n----\nmaths::bop Strassen-Winograd testing\n----\n----" << std::endl;
+    for (bop::uint_type size = 99; size <= 101; size++) {
+        Matrix<double> str_mat1(size,size), str_mat2(size,size);
+        for (bop::uint_type elem = 0; elem < size * size; elem++) {
+            str_mat1.element(elem) = static_cast<double>(elem % 13) - 6;
+            str_mat2.element(elem) = static_cast<double>(elem % 11) - 5;
+        }
+        std::cout << size << "x" << size << " Strassen product (crossover 16) matches the conventional product: " << (strassenMultiply(str_mat1, str_mat2, 16) == str_mat1 * str_mat2) << std::endl;
+    }
+    Matrix<double> str_wide(40,20,1);
+    std::cout << "a non-conforming Strassen product returns the left operand unchanged: " << (strassenMultiply(str_wide, str_wide, 16) == str_wide) << std::endl;
+    return 0;
+}
+
+int testLUFactorization() {
+    std::cout << "----\n----\nmaths::bop::LUDecomposition testing\n----\n----" << std::endl;
+    Matrix<double> lu_mat = {{0,2,1,4,3,1},{1,1,3,2,0,2},{4,0,1,1,2,3},{2,3,0,1,1,4},{1,4,2,0,3,1},{3,1,4,2,1,0}};
+    LUDecomposition<double> lu = lu_mat.factorize();
+    std::cout << "the matrix:\n" << lu_mat << "factors into L:\n" << lu.lower() << "and U:\n" << lu.upper() << std::endl;
+    std::cout << "largest element of PA - LU is below 1e-12: " << (largestElement(lu.permutation() * lu_mat - lu.lower() * lu.upper()) < 1e-12) << std::endl;
+    std::cout << "the determinant from the factorization is " << lu.det() << " (Matrix::det: " << lu_mat.det() << ")" << std::endl;
+    Matrix<double> lu_rhs = {{1,0},{2,1},{3,0},{4,1},{5,0},{6,1}};
+    std::cout << "solving against two right hand sides leaves a residual below 1e-12: " << (largestElement(lu_mat * lu.solve(lu_rhs) - lu_rhs) < 1e-12) << std::endl;
+    std::cout << "the matrix multiplied by it's inverse is the identity to within 1e-12: " << (largestElement(lu_mat * lu_mat.inverted() - IdentityMatrix<double>::make(6)) < 1e-12) << std::endl;
+    return 0;
+}
+
+int testTranspose() {
+    std::cout << "----\n----\nmaths::bop transpose testing\n----\n----" << std::endl;
+    const bop::uint_type shapes[][2] = {{1,7},{5,5},{3,4},{64,64},{37,37},{100,36},{33,130},{600,520}};
+    for (auto shape : shapes) {
+        Matrix<double> tr_mat(shape[1], shape[0]);
+        Matrix<float> tr_matf(shape[1], shape[0]);
+        for (bop::uint_type elem = 0; elem < shape[0] * shape[1]; elem++) {
+            tr_mat.element(elem) = static_cast<double>(elem);
+            tr_matf.element(elem) = static_cast<float>(elem);
+        }
+        Matrix<double> tr_copy = tr_mat.transposed();
+        Matrix<float> tr_copyf = tr_matf.transposed();
+        bool matches = true;
+        for (bop::uint_type row = 0; row < shape[0]; row++) {
+            for (bop::uint_type col = 0; col < shape[1]; col++) {
+                matches = matches && tr_copy.element(col,row) == tr_mat.element(row,col);
+                matches = matches && tr_copyf.element(col,row) == tr_matf.element(row,col);
+            }
+        }
+        tr_mat.transpose();
+        tr_matf.transpose();
+        std::cout << shape[0] << "x" << shape[1] << " transposed copy is correct: " << matches
+                  << ", in-place transpose matches it: " << (tr_mat == tr_copy && tr_matf == tr_copyf) << std::endl;
+    }
+    return 0;
+}
+
+int testMatrixViews() {
+    std::cout << "----\n----\nmaths::bop::MatrixView testing\n----\n----" << std::endl;
+    Matrix<double> view_mat = {{1,2,3,4},{5,6,7,8},{9,10,11,12},{13,14,15,16}};
+    std::cout << "the matrix:" << view_mat << "has row 1:" << view_mat.row(1) << "column 2:" << view_mat.column(2)
+              << "and the 2x2 block at (1,1):" << view_mat.block(1,1,2,2) << std::endl;
+    view_mat.block(0,2,2,2) *= 10;
+    view_mat.row(3) += view_mat.row(0);
+    std::cout << "scaling the top right block by 10 and adding row 0 to row 3 gives:" << view_mat << std::endl;
+    view_mat.block(2,0,2,2) = IdentityMatrix<double>::make(2) * 2 + view_mat.block(0,0,2,2);
+    std::cout << "assigning 2I + (top left block) to the bottom left block gives:" << view_mat << std::endl;
+    Matrix<double> block_product = view_mat.block(0,0,4,2) * view_mat.block(0,2,2,4);
+    std::cout << "the product of the top two rows and the right two columns is:" << block_product
+              << "copying them out first gives the same: " << (block_product == Matrix<double>(view_mat.block(0,0,4,2)) * Matrix<double>(view_mat.block(0,2,2,4))) << std::endl;
+    std::cout << "a product of views whose shapes do not conform copies the left view: "
+              << (view_mat.block(0,0,3,2) * view_mat.block(0,0,3,2) == Matrix<double>(view_mat.block(0,0,3,2))) << std::endl;
+    Matrix<double> lu_mat = {{9,9,9,9,9},{9,4,3,2,9},{9,1,5,3,9},{9,2,1,6,9},{9,9,9,9,9}};
+    std::cout << "the determinant of the middle 3x3 block of" << lu_mat << "is " << lu_mat.block(1,1,3,3).factorize().det()
+              << " (copied out: " << Matrix<double>(lu_mat.block(1,1,3,3)).det() << ")" << std::endl;
+    return 0;
+}
+
+int testPaddedStorage() {
+    std::cout << "----\n----\nmaths::bop padded Matrix storage testing\n----\n----" << std::endl;
+    Matrix<double> packed(5,3), padded = Matrix<double>::padded(5,3);
+    for (bop::uint_type elem = 0; elem < 15; elem++) packed.element(elem) = padded.element(elem) = static_cast<double>(elem);
+    std::cout << "a packed 5x3 matrix has stride " << packed.stride() << ", a padded one " << padded.stride() << std::endl;
+    std::cout << "a padded 512 wide matrix of doubles has stride " << Matrix<double>::padded(512,2).stride() << " to avoid 4KiB aliasing" << std::endl;
+    bool aligned = true;
+    for (bop::uint_type row = 0; row < padded.height(); row++) aligned = aligned && (reinterpret_cast<uintptr_t>(padded.rowData(row)) % 64) == 0;
+    std::cout << "every padded row starts 64 byte aligned: " << aligned << std::endl;
+    std::cout << "the padded matrix is" << padded << "and equals the packed one: " << (padded == packed) << std::endl;
+    Matrix<double> padded_sum = padded + packed * 2;
+    padded *= packed.transposed();
+    std::cout << "arithmetic mixing padded and packed operands gives" << padded_sum << "and" << padded << std::endl;
+    return 0;
+}
+
+int testLinearSolve() {
+    std::cout << "----\n----\nmaths::bop linear solve testing\n----\n----" << std::endl;
+    /*
+        150 rows crosses two diagonal block boundaries of the triangular
+        solves.
+    */
+    Matrix<double> sys_mat(150,150), sys_rhs(70,150);
+    for (bop::uint_type row = 0; row < 150; row++) {
+        for (bop::uint_type col = 0; col < 150; col++) sys_mat.element(row,col) = static_cast<double>(((row * 7) + (col * 3)) % 17) - 8 + ((row == col) ? 40 : 0);
+        for (bop::uint_type col = 0; col < 70; col++) sys_rhs.element(row,col) = static_cast<double>((row + (col * 5)) % 11) - 5;
+    }
+    Matrix<double> sys_x = solve(sys_mat, sys_rhs);
+    std::cout << "solve(A, B) with 70 right hand sides leaves a residual below 1e-10: " << (largestElement(sys_mat * sys_x - sys_rhs) < 1e-10) << std::endl;
+    LUDecomposition<double> sys_lu = sys_mat.factorize();
+    std::cout << "reusing the factorization gives the same solution: " << (solve(sys_lu, sys_rhs) == sys_x) << std::endl;
+    bool columns_match = true;
+    for (bop::uint_type col = 0; col < 70; col += 23) {
+        Matrix<double> sys_col = solve(sys_lu, Matrix<double>(sys_rhs.column(col)));
+        for (bop::uint_type row = 0; row < 150; row++) columns_match = columns_match && std::abs(sys_col.element(row) - sys_x.element(row,col)) < 1e-12;
+    }
+    std::cout << "solving single columns agrees with solving them together: " << columns_match << std::endl;
+    Matrix<double> sys_view_x = solve(sys_mat.block(0,0,100,100), sys_rhs.block(0,0,70,100));
+    Matrix<double> sys_view_residual = Matrix<double>(sys_mat.block(0,0,100,100)) * sys_view_x - Matrix<double>(sys_rhs.block(0,0,70,100));
+    std::cout << "solving with a block of A and of B leaves a residual below 1e-10: " << (largestElement(sys_view_residual) < 1e-10) << std::endl;
+    Matrix<double> sys_singular = {{1,2},{2,4}};
+    Matrix<double> pair_rhs = {{1},{2}};
+    std::cout << "a singular system is reported by the factorization: " << sys_singular.factorize().singular()
+              << ", and solve returns B unchanged: " << (solve(sys_singular, pair_rhs) == pair_rhs) << std::endl;
+    Matrix<double> sys_wide(5,3,1.0);
+    std::cout << "B is returned unchanged for a non-square A: " << (solve(sys_wide, sys_rhs) == sys_rhs)
+              << ", and for a B with the wrong number of rows: " << (solve(sys_mat, pair_rhs) == pair_rhs)
+              << ", a non-square A factors as singular: " << sys_wide.factorize().singular() << std::endl;
+    return 0;
+}
+
+int testSparseMatrices() {
+    std::cout << "----\n----\nmaths::bop::SparseMatrix testing\n----\n----" << std::endl;
+    Matrix<double> sp_dense = {{4,0,0,1,0},{0,0,2,0,0},{0,0,0,0,0},{3,0,5,0,6}};
+    SparseMatrix<double> sp_csr(sp_dense), sp_csc(sp_dense, SparseMatrix<double>::csc);
+    std::cout << "the matrix:" << sp_dense << "is stored as a " << sp_csr;
+    std::cout << "converting back to dense gives the same matrix, from CSR: " << (sp_csr.dense() == sp_dense)
+              << ", from CSC: " << (sp_csc.dense() == sp_dense) << std::endl;
+    std::cout << "element (3,2) is " << sp_csc.element(3,2) << " and (2,2) is " << sp_csc.element(2,2) << std::endl;
+    std::cout << "the transpose matches the dense transpose: " << (sp_csr.transposed().dense() == sp_dense.transposed()) << std::endl;
+    SparseMatrix<double> sp_entries(5, 4, {{3,4,6},{0,0,4},{3,2,2},{1,2,2},{0,3,1},{3,0,3},{3,2,3}});
+    std::cout << "building from unordered entries, summing the repeated (3,2), gives the same matrix: " << (sp_entries.dense() == sp_dense) << std::endl;
+    Matrix<double> sp_rhs = {{1,2},{3,4},{5,6},{7,8},{9,10}};
+    std::cout << "the product with" << sp_rhs << "is" << (sp_csr * sp_rhs)
+              << "matching the dense product from CSR: " << (sp_csr * sp_rhs == sp_dense * sp_rhs)
+              << ", from CSC: " << (sp_csc * sp_rhs == sp_dense * sp_rhs) << std::endl;
+    /*
+        A 100000x100000 tridiagonal matrix holds under 300000 nonzeros.
+    */
+    const bop::uint_type sp_order = 100000;
+    std::vector<SparseMatrix<double>::Entry> sp_tridiagonal;
+    for (bop::uint_type row = 0; row < sp_order; row++) {
+        if (row > 0) sp_tridiagonal.push_back({row, row - 1, -1});
+        sp_tridiagonal.push_back({row, row, 2});
+        if (row + 1 < sp_order) sp_tridiagonal.push_back({row, row + 1, -1});
+    }
+    SparseMatrix<double> sp_large(sp_order, sp_order, sp_tridiagonal);
+    Matrix<double> sp_x(1, sp_order);
+    for (bop::uint_type row = 0; row < sp_order; row++) sp_x.element(row) = static_cast<double>(row % 7);
+    Matrix<double> sp_y = sp_large * sp_x;
+    std::cout << "a " << sp_order << "x" << sp_order << " tridiagonal matrix has " << sp_large.nonZeros() << " nonzeros" << std::endl;
+    for (bop::uint_type threads = 1; threads <= 4; threads++) {
+        bop::util::ThreadPool pool(threads);
+        std::cout << "its product with a vector on " << threads << " thread(s) matches the serial product: " << (multiply(sp_large, sp_x, pool) == sp_y) << std::endl;
+    }
+    std::cout << "stored as CSC the product matches too: " << (multiply(sp_large.compressed(SparseMatrix<double>::csc), sp_x) == sp_y) << std::endl;
+    return 0;
+}
+
+int testMatrixBatches() {
+    std::cout << "----\n----\nmaths::bop::MatrixBatch testing\n----\n----" << std::endl;
+    /*
+        1000 matrices leaves a partly filled group at the end of the batch.
+    */
+    const bop::uint_type count = 1000;
+    MatrixBatch<double,4,4> batch4(count);
+    MatrixBatch<double,4,1> batch_vec(count);
+    MatrixBatch<float,3,3> batch3(count);
+    for (bop::uint_type index = 0; index < count; index++) {
+        for (bop::uint_type elem = 0; elem < 16; elem++) batch4.plane(elem)[index] = static_cast<double>(((index * 7) + (elem * 13)) % 23) - 11;
+        for (bop::uint_type elem = 0; elem < 9; elem++) batch3.plane(elem)[index] = static_cast<float>(((index * 5) + (elem * 11)) % 19) - 9;
+        batch_vec.set(index, FixedMatrix<double,4,1>(1, static_cast<double>(index % 3), 0, -1));
+    }
+    std::cout << "matrix 3 of the 4x4 batch is" << Matrix<double>(batch4.get(3)) << std::endl;
+    MatrixBatch<double,4,4> batch_product = batch4 * batch4;
+    MatrixBatch<double,4,1> batch_applied = batch4 * batch_vec;
+    MatrixBatch<double,4,4> batch_inverse = batch4.inverted();
+    MatrixBatch<float,3,3> batch3_inverse = batch3.inverted();
+    std::vector<double> batch_dets = batch4.det();
+    std::vector<float> batch3_dets = batch3.det();
+    bool products = true, applied = true, dets = true, inverses = true;
+    bop::uint_type singular = 0;
+    for (bop::uint_type index = 0; index < count; index++) {
+        const matrix4 mat = batch4.get(index);
+        products = products && batch_product.get(index) == mat * mat;
+        applied = applied && batch_applied.get(index) == mat * batch_vec.get(index);
+        dets = dets && batch_dets[index] == mat.det() && batch3_dets[index] == batch3.get(index).det();
+        inverses = inverses && batch_inverse.get(index) == mat.inverted() && batch3_inverse.get(index) == batch3.get(index).inverted();
+        if (mat.det() == 0) singular++;
+    }
+    std::cout << "batched products match FixedMatrix: " << products << ", matrix-vector products: " << applied << std::endl;
+    std::cout << "batched determinants match FixedMatrix: " << dets << ", inverses: " << inverses << std::endl;
+    std::cout << "inverting in place reports the singular matrices: " << (batch4.invert() == singular) << std::endl;
+    MatrixBatch<double,4,4> batch_large(20000, matrix4::identity());
+    for (bop::uint_type index = 0; index < 20000; index++) batch_large.element(index, index % 4, (index + 1) % 4) = static_cast<double>(index % 5);
+    for (bop::uint_type threads = 1; threads <= 4; threads++) {
+        bop::util::ThreadPool pool(threads);
+        MatrixBatch<double,4,4> batch_pooled(batch_large);
+        batch_pooled.invert(pool);
+        bool pooled = batch_large.det(pool) == batch_large.det();
+        MatrixBatch<double,4,4> batch_serial = batch_large.inverted(), batch_pooled_product = multiply(batch_large, batch_large, pool), batch_serial_product = batch_large * batch_large;
+        for (bop::uint_type index = 0; index < 20000; index++) {
+            pooled = pooled && batch_pooled.get(index) == batch_serial.get(index) && batch_pooled_product.get(index) == batch_serial_product.get(index);
+        }
+        std::cout << "20000 matrix batch on " << threads << " thread(s) matches the serial results: " << pooled << std::endl;
+    }
+    return 0;
+}
+
+int testMoveSemantics() {
+    std::cout << "----\n----\nmaths::bop::Matrix move testing\n----\n----" << std::endl;
+    matrix mat_a = {{4, 7, 2}, {3, 6, 1}, {2, 5, 3}};
+    matrix mat_b = {{1, 0, 2}, {0, 1, 0}, {1, 1, 1}};
+    matrix mat_moved(mat_a);
+    const double* storage = mat_moved.rowData(0);
+    matrix mat_taken(std::move(mat_moved));
+    std::cout << "move construction takes the storage: " << (mat_taken.rowData(0) == storage) << ", leaves the source empty: " << (!mat_moved.valid() && mat_moved.width() == 0) << std::endl;
+    mat_taken[1][2] = 9;
+    std::cout << "indexing after a move reaches the new owner:" << mat_taken << std::endl;
+    mat_moved = std::move(mat_taken);
+    std::cout << "move assignment takes the storage: " << (mat_moved.rowData(0) == storage) << ", reassigning the source: " << ((mat_taken = mat_b) == mat_b) << std::endl;
+    mat_moved = std::move(mat_moved);
+    std::cout << "self move assignment keeps the matrix: " << (mat_moved.rowData(0) == storage) << std::endl;
+    /*
+        Operators given an expiring left operand return it, so the
+        result lives in the same storage.
+    */
+    matrix mat_sum(mat_a);
+    storage = mat_sum.rowData(0);
+    matrix mat_result = std::move(mat_sum) + mat_b * 2.0 - mat_a;
+    std::cout << "a + b * 2 - a reuses the storage of a: " << (mat_result.rowData(0) == storage) << ", gives b * 2: " << (mat_result == matrix(mat_b * 2.0)) << std::endl;
+    matrix mat_right(mat_b);
+    storage = mat_right.rowData(0);
+    mat_result = mat_a - std::move(mat_right);
+    std::cout << "a - b reuses the storage of b: " << (mat_result.rowData(0) == storage) << ", gives" << mat_result << std::endl;
+    matrix mat_scaled(mat_a);
+    storage = mat_scaled.rowData(0);
+    mat_result = -(std::move(mat_scaled) / 2.0);
+    std::cout << "-(a / 2) reuses the storage of a: " << (mat_result.rowData(0) == storage) << ", gives" << mat_result << std::endl;
+    matrix mat_tall(2, 3, 1);
+    mat_result = std::move(mat_tall).transposed();
+    std::cout << "transposing an expiring 2x3 matrix gives " << mat_result.width() << "x" << mat_result.height() << std::endl;
+    matrix mat_inverse(mat_a);
+    mat_result = std::move(mat_inverse).inverted();
+    std::cout << "inverting an expiring matrix matches inverted(): " << (mat_result == mat_a.inverted()) << std::endl;
+    vector vec_a = {1, 2, 3};
+    vector vec_b(vec_a);
+    vector vec_result = std::move(vec_b) * 2.0 + vec_a;
+    std::cout << "vector 2a + a is " << vec_result << ", the moved vector is left empty: " << !vec_b.valid() << std::endl;
+    vec_b = std::move(vec_result);
+    std::cout << "move assigned vector is " << vec_b << std::endl;
+    return 0;
+}
+
+int testOrthogonalFactorizations() {
+    std::cout << "----\n----\nmaths::bop Cholesky and QR testing\n----\n----" << std::endl;
+    /*
+        150 rows and 90 columns cross the panel boundaries of both
+        factorizations. A^T A + I is symmetric positive definite.
+    */
+    Matrix<double> tall(90,150), rhs(3,150);
+    for (bop::uint_type row = 0; row < 150; row++) {
+        for (bop::uint_type col = 0; col < 90; col++) tall.element(row,col) = static_cast<double>(((row * 5) + (col * 11)) % 19) - 9 + ((row == col) ? 20 : 0);
+        for (bop::uint_type col = 0; col < 3; col++) rhs.element(row,col) = static_cast<double>((row * (col + 2)) % 7) - 3;
+    }
+    Matrix<double> spd = tall.transposed() * tall + IdentityMatrix<double>::make(90);
+    CholeskyDecomposition<double> chol = spd.cholesky();
+    std::cout << "the 90x90 matrix is positive definite: " << chol.positiveDefinite()
+              << ", largest element of LL^T - A is below 1e-9: " << (largestElement(chol.lower() * chol.upper() - spd) < 1e-9) << std::endl;
+    Matrix<double> spd_rhs = tall.transposed() * rhs;
+    std::cout << "solving with the Cholesky factor leaves a residual below 1e-9: " << (largestElement(spd * chol.solve(spd_rhs) - spd_rhs) < 1e-9)
+              << ", one column at a time agrees: " << (largestElement(chol.solve(Matrix<double>(spd_rhs.column(1))) - Matrix<double>(chol.solve(spd_rhs).column(1))) < 1e-12) << std::endl;
+    Matrix<double> small_spd = {{4,2,2},{2,5,3},{2,3,6}};
+    std::cout << "the Cholesky factor of" << small_spd << "is" << small_spd.cholesky().lower()
+              << "with determinant " << small_spd.cholesky().det() << " (Matrix::det: " << small_spd.det() << ")" << std::endl;
+    Matrix<double> indefinite = {{1,2},{2,1}};
+    std::cout << "an indefinite matrix is reported: " << !indefinite.cholesky().positiveDefinite()
+              << ", with determinant 0: " << (indefinite.cholesky().det() == 0)
+              << " and the identity as its inverse: " << (indefinite.cholesky().inverse() == IdentityMatrix<double>::make(2)) << std::endl;
+    Matrix<double> in_place(spd);
+    const double* storage = in_place.rowData(0);
+    CholeskyDecomposition<double> chol_moved(std::move(in_place));
+    std::cout << "factoring an expiring matrix works in its storage: " << (chol_moved.lower().rowData(0) == storage) << std::endl;
+    QRDecomposition<double> qr = tall.qr();
+    Matrix<double> q = qr.q(), r = qr.r();
+    std::cout << "the 150x90 matrix has Q " << q.width() << " wide and R " << r.height() << " high, of full rank: " << qr.fullRank() << std::endl;
+    std::cout << "largest element of QR - A is below 1e-10: " << (largestElement(q * r - tall) < 1e-10)
+              << ", of Q^T Q - I: " << (largestElement(q.transposed() * q - IdentityMatrix<double>::make(90)) < 1e-12) << std::endl;
+    Matrix<double> ls_x = leastSquares(tall, rhs);
+    std::cout << "the least squares residual is orthogonal to the columns of A: " << (largestElement(tall.transposed() * (tall * ls_x - rhs)) < 1e-8)
+              << ", matches the normal equations: " << (largestElement(ls_x - (tall.transposed() * tall).cholesky().solve(spd_rhs)) < 1e-10) << std::endl;
+    Matrix<double> small_qr = {{12,-51,4},{6,167,-68},{-4,24,-41}};
+    std::cout << "the QR factorization of" << small_qr << "has R" << small_qr.qr().r() << std::endl;
+    Matrix<double> short_rhs = {{1},{2}};
+    Matrix<double> wide_qr = tall.transposed();
+    CholeskyDecomposition<double> wide_cholesky(wide_qr);
+    std::cout << "a non-square matrix is not positive definite: " << !wide_cholesky.positiveDefinite()
+              << ", Cholesky returns B unchanged for it: " << (wide_cholesky.solve(short_rhs) == short_rhs)
+              << ", and for a B with the wrong number of rows: " << (spd.cholesky().solve(short_rhs) == short_rhs) << std::endl;
+    Matrix<double> wide_rhs(1, wide_qr.height(), 1.0);
+    std::cout << "QR returns B unchanged for a wide A: " << (wide_qr.qr().solve(wide_rhs) == wide_rhs)
+              << ", and for a B with the wrong number of rows: " << (tall.qr().solve(short_rhs) == short_rhs) << std::endl;
+    return 0;
+}
+
+int testEigenSolvers() {
+    std::cout << "----\n----\nmaths::bop Lanczos and Arnoldi testing\n----\n----" << std::endl;
+    /*
+        The residual ||Ax - lambda x|| of each pair, relative to lambda.
+    */
+    auto largestResidual = [](const Matrix<double>& ax, const Matrix<double>& x, const std::vector<double>& values) -> double {
+        double largest = 0;
+        for (bop::uint_type col = 0; col < values.size(); col++) {
+            double norm = 0;
+            for (bop::uint_type row = 0; row < x.height(); row++) norm += std::pow(ax.element(row,col) - (values[col] * x.element(row,col)), 2);
+            largest = std::max(largest, std::sqrt(norm) / std::abs(values[col]));
+        }
+        return largest;
+    };
+    /*
+        A 100000 long operator given as a lambda: a diagonal of 1/(i+1)
+        with 0.1 on the off diagonals.
+    */
+    const bop::uint_type size = 100000;
+    auto op = [&](const double* x, double* y) {
+        for (bop::uint_type row = 0; row < size; row++) {
+            y[row] = x[row] / static_cast<double>(row + 1);
+            if (row > 0) y[row] += 0.1 * x[row - 1];
+            if (row + 1 < size) y[row] += 0.1 * x[row + 1];
+        }
+    };
+    SymmetricEigenPairs<double> op_pairs = lanczos<double>(op, size, 4);
+    Matrix<double> op_ax(4, size);
+    for (bop::uint_type col = 0; col < 4; col++) {
+        std::vector<double> x(size), y(size);
+        for (bop::uint_type row = 0; row < size; row++) x[row] = op_pairs.vectors.element(row,col);
+        op(x.data(), y.data());
+        for (bop::uint_type row = 0; row < size; row++) op_ax.element(row,col) = y[row];
+    }
+    std::cout << "Lanczos on a 100000 long operator converged: " << op_pairs.converged << ", largest eigenvalue " << op_pairs.values[0]
+              << ", residuals below 1e-8: " << (largestResidual(op_ax, op_pairs.vectors, op_pairs.values) < 1e-8)
+              << ", eigenvectors orthonormal: " << (std::abs((op_pairs.vectors.transposed() * op_pairs.vectors - IdentityMatrix<double>::make(4)).element(1)) < 1e-10) << std::endl;
+    std::vector<SparseMatrix<double>::Entry> entries;
+    for (bop::uint_type row = 0; row < 2000; row++) {
+        entries.push_back({row, row, -1.0 / static_cast<double>(row + 1)});
+        if (row > 0) entries.push_back({row, row - 1, 0.05});
+        if (row + 1 < 2000) entries.push_back({row, row + 1, 0.05});
+    }
+    SparseMatrix<double> sparse(2000, 2000, entries);
+    SymmetricEigenPairs<double> sparse_pairs = lanczos(sparse, 3, EigenTarget::smallest_real);
+    std::cout << "Lanczos on a 2000x2000 sparse matrix converged: " << sparse_pairs.converged << ", smallest eigenvalues in order: "
+              << (sparse_pairs.values[0] <= sparse_pairs.values[1] && sparse_pairs.values[1] <= sparse_pairs.values[2])
+              << ", residuals below 1e-8: " << (largestResidual(sparse * sparse_pairs.vectors, sparse_pairs.vectors, sparse_pairs.values) < 1e-8) << std::endl;
+    /*
+        A general matrix with a dominant complex pair near +-50i from a
+        rotation in its top left corner.
+    */
+    Matrix<double> general(300,300);
+    for (bop::uint_type row = 0; row < 300; row++) {
+        for (bop::uint_type col = 0; col < 300; col++) general.element(row,col) = (static_cast<double>(((row * 13) + (col * 7)) % 23) - 11) / 100.0;
+        general.element(row,row) += static_cast<double>(row) / 10.0;
+    }
+    general.element(0,1) = 50;
+    general.element(1,0) = -50;
+    EigenPairs<double> general_pairs = arnoldi(general, 4);
+    Matrix<double> real_ax = general * general_pairs.vectors, imaginary_ax = general * general_pairs.imaginary_vectors;
+    double general_residual = 0;
+    for (bop::uint_type col = 0; col < 4; col++) {
+        const std::complex<double> value = general_pairs.values[col];
+        for (bop::uint_type row = 0; row < 300; row++) {
+            const std::complex<double> x(general_pairs.vectors.element(row,col), general_pairs.imaginary_vectors.element(row,col));
+            const std::complex<double> ax(real_ax.element(row,col), imaginary_ax.element(row,col));
+            general_residual = std::max(general_residual, std::abs(ax - (value * x)) / std::abs(value));
+        }
+    }
+    std::cout << "Arnoldi on a 300x300 general matrix converged: " << general_pairs.converged
+              << ", dominant pair is conjugate: " << (general_pairs.values[0] == std::conj(general_pairs.values[1]) && general_pairs.values[0].imag() > 49)
+              << ", residuals below 1e-8: " << (general_residual < 1e-8) << std::endl;
+    EigenPairs<double> real_pairs = arnoldi(general, 3, EigenTarget::largest_real);
+    std::cout << "asking for the largest real parts gives" << real_pairs.values[0] << real_pairs.values[1] << real_pairs.values[2]
+              << ", in order: " << (real_pairs.values[0].real() >= real_pairs.values[1].real() && real_pairs.values[1].real() >= real_pairs.values[2].real()) << std::endl;
+    return 0;
+}
+
+int testMixedPrecision() {
+    std::cout << "----\n----\nmaths::bop mixed precision testing\n----\n----" << std::endl;
+    /*
+        Widths of 37 and 203 leave tails past every vector width.
+    */
+    Matrix<double> wide(37,5), padded_wide = Matrix<double>::padded(37,5);
+    for (bop::uint_type elem = 0; elem < 185; elem++) wide.element(elem) = padded_wide.element(elem) = static_cast<double>(elem) / 8.0 - 11;
+    Matrix<float> narrow(wide), padded_narrow(padded_wide);
+    std::cout << "converting to float and back is exact: " << (Matrix<double>(narrow) == wide)
+              << ", for padded storage too: " << (Matrix<double>(padded_narrow) == wide) << std::endl;
+    Matrix<float> left(203,150), right(90,203);
+    for (bop::uint_type row = 0; row < 150; row++) for (bop::uint_type col = 0; col < 203; col++) left.element(row,col) = static_cast<float>(((row * 7) + (col * 3)) % 17) / 3.0f - 2;
+    for (bop::uint_type row = 0; row < 203; row++) for (bop::uint_type col = 0; col < 90; col++) right.element(row,col) = static_cast<float>(((row * 5) + (col * 11)) % 13) / 7.0f - 1;
+    Matrix<double> mixed = mixedMultiply(left, right);
+    std::cout << "a float product accumulated in double matches the double product to 1e-12: "
+              << (largestElement(mixed - Matrix<double>(left) * Matrix<double>(right)) < 1e-12) << std::endl;
+    /*
+        A diagonally dominant 200x200 system refines to double accuracy.
+    */
+    Matrix<double> system(200,200), rhs(3,200);
+    for (bop::uint_type row = 0; row < 200; row++) {
+        for (bop::uint_type col = 0; col < 200; col++) system.element(row,col) = std::sin(static_cast<double>((row * 200) + col));
+        system.element(row,row) += 30;
+        for (bop::uint_type col = 0; col < 3; col++) rhs.element(row,col) = std::cos(static_cast<double>(row + (col * 7)));
+    }
+    MixedPrecisionLU<double> mixed_lu(system);
+    RefinementStatistics refinement;
+    Matrix<double> refined_x = mixed_lu.solve(rhs, refinement);
+    std::cout << "refinement converged: " << refinement.refined << " after " << refinement.iterations << " steps"
+              << ", residual below 1e-12: " << (largestElement(system * refined_x - rhs) < 1e-12)
+              << ", agrees with the double LU solve: " << (largestElement(refined_x - system.factorize().solve(rhs)) < 1e-12) << std::endl;
+    /*
+        The 10x10 Hilbert matrix is too ill-conditioned for float factors.
+    */
+    Matrix<double> hilbert(10,10), ones(1,10,1);
+    for (bop::uint_type row = 0; row < 10; row++) for (bop::uint_type col = 0; col < 10; col++) hilbert.element(row,col) = 1.0 / static_cast<double>(row + col + 1);
+    MixedPrecisionLU<double> hilbert_lu(hilbert);
+    /*
+        Threads share one factorization, racing to form the fallback.
+    */
+    std::vector<Matrix<double> > hilbert_xs(4);
+    std::vector<RefinementStatistics> hilbert_stats(4);
+    std::vector<std::thread> solvers;
+    for (bop::uint_type thread = 0; thread < 4; thread++) {
+        solvers.emplace_back([&, thread]() { hilbert_xs[thread] = hilbert_lu.solve(ones, hilbert_stats[thread]); });
+    }
+    for (std::thread& solver : solvers) solver.join();
+    bool threads_agree = true;
+    for (bop::uint_type thread = 0; thread < 4; thread++) threads_agree = threads_agree && !hilbert_stats[thread].refined && hilbert_xs[thread] == hilbert_xs[0];
+    std::cout << "the Hilbert matrix falls back to a double factorization: " << !hilbert_stats[0].refined
+              << ", residual below 1e-8: " << (largestElement(hilbert * hilbert_xs[0] - ones) < 1e-8)
+              << ", 4 threads sharing the factorization agree: " << threads_agree << std::endl;
     return 0;
 }
 
@@ -183,6 +1210,29 @@ int testMathsFunctions() {
 int main() {
     std::cout << "Vector test returned " << testVectors() << std::endl;
     std::cout << "Matrix test returned " << testMatrices() << std::endl;
+    std::cout << "Fixed matrix test returned " << testFixedMatrices() << std::endl;
+    std::cout << "Parallel product test returned " << testParallelProduct() << std::endl;
+    std::cout << "Matrix-vector product test returned " << testMatrixVectorProducts() << std::endl;
+    std::cout << "Multiply-accumulate test returned " << testMultiplyAdd() << std::endl;
+    std::cout << "SIMD kernel test returned " << testSimdKernels() << std::endl;
+    std::cout << "Exact elimination test returned " << testExactElimination() << std::endl;
+    std::cout << "Structured matrix test returned " << testStructuredMatrices() << std::endl;
+    std::cout << "Matrix cache test returned " << testMatrixCache() << std::endl;
+    std::cout << "Packed storage test returned " << testPackedMatrices() << std::endl;
+    std::cout << "Matrix functions test returned " << testMatrixFunctions() << std::endl;
+    std::cout << "Matrix allocator test returned " << testMatrixAllocators() << std::endl;
+    std::cout << "Strassen test returned " << testStrassen() << std::endl;
+    std::cout << "LU factorization test returned " << testLUFactorization() << std::endl;
+    std::cout << "Transpose test returned " << testTranspose() << std::endl;
+    std::cout << "Matrix view test returned " << testMatrixViews() << std::endl;
+    std::cout << "Padded storage test returned " << testPaddedStorage() << std::endl;
+    std::cout << "Linear solve test returned " << testLinearSolve() << std::endl;
+    std::cout << "Cholesky and QR test returned " << testOrthogonalFactorizations() << std::endl;
+    std::cout << "Eigen solver test returned " << testEigenSolvers() << std::endl;
+    std::cout << "Mixed precision test returned " << testMixedPrecision() << std::endl;
+    std::cout << "Sparse matrix test returned " << testSparseMatrices() << std::endl;
+    std::cout << "Matrix batch test returned " << testMatrixBatches() << std::endl;
+    std::cout << "Move semantics test returned " << testMoveSemantics() << std::endl;
     std::cout << "Functions test returned " << testMathsFunctions() << std::endl;
     return 0;
 }